@@ -0,0 +1,37 @@
+# cmake [-DCXX=<compiler>] [-DFLAGS=<flags>] [-DRUNS=<runs>] -P cmake/CommandParserBuildTime.cmake
+#
+# Compares how long example_main.cpp takes to compile with the header-only parser and with the parts that do not
+# depend on the commands compiled separately (COMMAND_PARSER_SEPARATE_COMPILATION), as the mean of <runs> builds.
+# The one-off cost of compiling src/CommandParser.cpp is reported too.
+cmake_minimum_required(VERSION 3.23)
+
+if (NOT CXX)
+    set(CXX c++)
+endif ()
+if (NOT RUNS)
+    set(RUNS 5)
+endif ()
+separate_arguments(FLAGS)
+get_filename_component(ROOT ${CMAKE_CURRENT_LIST_DIR} DIRECTORY)
+set(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/command_parser_build_time.o)
+
+function(measure name source)
+    set(total 0)
+    foreach (run RANGE 1 ${RUNS})
+        string(TIMESTAMP start "%s%f")
+        execute_process(COMMAND ${CXX} -std=c++17 ${FLAGS} ${ARGN} -I${ROOT}/include -c ${source} -o ${OUTPUT}
+                        RESULT_VARIABLE result)
+        string(TIMESTAMP end "%s%f")
+        if (NOT result EQUAL 0)
+            message(FATAL_ERROR "Cannot compile ${source}")
+        endif ()
+        math(EXPR total "${total} + (${end} - ${start}) / 1000")
+    endforeach ()
+    math(EXPR mean "${total} / ${RUNS}")
+    message(STATUS "${name}: ${mean} ms")
+endfunction()
+
+measure("Header-only" ${ROOT}/example_main.cpp)
+measure("Separate compilation" ${ROOT}/example_main.cpp -DCOMMAND_PARSER_SEPARATE_COMPILATION)
+measure("src/CommandParser.cpp, compiled once" ${ROOT}/src/CommandParser.cpp -DCOMMAND_PARSER_SEPARATE_COMPILATION)
+file(REMOVE ${OUTPUT})
@@ -0,0 +1,41 @@
+# command_parser_add_completions(<generator> PROGRAM <name> [DESTINATION <directory>] [SHELLS <shell>...])
+#
+# Generates static completion scripts for the program <name> with the <generator> executable, a small program whose
+# main returns UnparsedCommand::completionMain(argc, argv, "<name>", commands) for the commands of <name>.
+# The scripts are regenerated whenever <generator> is rebuilt and written to <directory>, by default
+# ${CMAKE_CURRENT_BINARY_DIR}/completions, as <name>.bash, _<name> (zsh) and <name>.fish for the supplied shells,
+# by default bash, zsh and fish.
+function(command_parser_add_completions generator)
+    cmake_parse_arguments(COMPLETION "" "PROGRAM;DESTINATION" "SHELLS" ${ARGN})
+    if (NOT COMPLETION_PROGRAM)
+        message(FATAL_ERROR "command_parser_add_completions: PROGRAM is required")
+    endif ()
+    if (NOT COMPLETION_DESTINATION)
+        set(COMPLETION_DESTINATION ${CMAKE_CURRENT_BINARY_DIR}/completions)
+    endif ()
+    if (NOT COMPLETION_SHELLS)
+        set(COMPLETION_SHELLS bash zsh fish)
+    endif ()
+
+    set(scripts)
+    foreach (shell IN LISTS COMPLETION_SHELLS)
+        if (shell STREQUAL "bash")
+            set(script ${COMPLETION_DESTINATION}/${COMPLETION_PROGRAM}.bash)
+        elseif (shell STREQUAL "zsh")
+            set(script ${COMPLETION_DESTINATION}/_${COMPLETION_PROGRAM})
+        elseif (shell STREQUAL "fish")
+            set(script ${COMPLETION_DESTINATION}/${COMPLETION_PROGRAM}.fish)
+        else ()
+            message(FATAL_ERROR "command_parser_add_completions: unsupported shell ${shell}")
+        endif ()
+        add_custom_command(
+                OUTPUT ${script}
+                COMMAND ${CMAKE_COMMAND} -E make_directory ${COMPLETION_DESTINATION}
+                COMMAND $<TARGET_FILE:${generator}> ${shell} ${script}
+                DEPENDS ${generator}
+                COMMENT "Generating ${shell} completion for ${COMPLETION_PROGRAM}"
+                VERBATIM)
+        list(APPEND scripts ${script})
+    endforeach ()
+    add_custom_target(${generator}_completions ALL DEPENDS ${scripts})
+endfunction()
@@ -1,253 +1,326 @@
 #pragma once
 
+#include "CommandParserCore.h"
+
 #include <algorithm>
+#include <array>
 #include <cassert>
-#include <iomanip>
-#include <iostream>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <variant>
 #include <vector>
 
-namespace details {
-// Adapted from
-// https://github.com/heavyeyelid/virthttp/blob/master/include/virt_wrap/utility.hpp#L42-L46
-template <typename T, typename V, size_t... I>
-constexpr void tupleVisitImpl(T&& t, V&& v, std::index_sequence<I...>)
-{
-    (..., v(std::get<I>(t)));
-}
-
-template <typename T, typename V>
-constexpr void visitTuple(T&& t, V&& v)
-{
-    tupleVisitImpl(
-        std::forward<T>(t),
-        std::forward<V>(v),
-        std::make_index_sequence<std::tuple_size<typename std::decay<T>::type>::value>());
-}
-
-template <typename T, typename Valid = void>
-struct isOptional : std::false_type {
-};
-
-template <typename T>
-struct isOptional<std::optional<T>> : std::true_type {
-};
-
-template <typename T, typename Valid = void>
-struct isVector : std::false_type {
-};
-
-template <typename T>
-struct isVector<std::vector<T>> : std::true_type {
-};
-
-template <typename T, typename Valid = void>
-struct isAllowedCustomType : std::false_type {
-};
-
-template <typename T>
-struct isAllowedCustomType<
-    T,
-    std::enable_if_t<std::is_default_constructible<T>::value && std::is_constructible<T, std::string>::value>>
-    : std::true_type {
+// With COMMAND_PARSER_SEPARATE_COMPILATION, the code that does not depend on the commands is only declared here and
+// compiled once in src/CommandParser.cpp, see the `command_parser_compiled` CMake target. It must be defined for the
+// whole program or not at all, since a translation unit without it defines the same functions inline
+#ifdef COMMAND_PARSER_SEPARATE_COMPILATION
+#define COMMAND_PARSER_INLINE
+#else
+#define COMMAND_PARSER_INLINE inline
+#endif
+#if !defined(COMMAND_PARSER_SEPARATE_COMPILATION) || defined(COMMAND_PARSER_IMPLEMENTATION)
+#define COMMAND_PARSER_DEFINITIONS 1
+#else
+#define COMMAND_PARSER_DEFINITIONS 0
+#endif
+#if COMMAND_PARSER_DEFINITIONS
+// Only the definitions write to the standard error, so that separately compiled users do not include the streams
+#include <iostream>
+// For `environ`, which only the definitions read
+#include <unistd.h>
+#endif
+
+// The prefix of the variables `details::EnvironmentIndex::process` indexes, e.g. -DCOMMAND_PARSER_ENV_PREFIX=\"TOOL_\"
+// when all environment fallbacks start with it, so that a large process environment is not indexed as a whole. Like
+// COMMAND_PARSER_SEPARATE_COMPILATION, it must be the same for the whole program
+#ifndef COMMAND_PARSER_ENV_PREFIX
+#define COMMAND_PARSER_ENV_PREFIX ""
+#endif
+
+/// @brief The kinds of constraints between the options of a command
+enum class OptionConstraint {
+    conflicting, ///< At most one of the options may be supplied
+    requiring, ///< If the first option is supplied, so must all the others
+    exactlyOne, ///< Exactly one of the options must be supplied
+    atLeastOne, ///< At least one of the options must be supplied
 };
 
-template <typename T>
-struct isAllowedType : isAllowedCustomType<T> {
+/// @brief A constraint between options that a parsed command did not satisfy
+struct OptionViolation {
+    OptionConstraint constraint {};
+    /// @brief The options of the constraint, in the order they were declared
+    std::vector<std::string> options {};
 };
 
-template <typename... Ts>
-struct isAllowedType<std::tuple<Ts...>> : std::conjunction<isAllowedType<Ts>...> {
+/// @brief A problem found when parsing with errors collected
+struct ParseError {
+    ParseErrorKind kind {};
+    /// @brief The index of the offending word in the command line (i.e. in argv, or in the words of a command line
+    ///        split into words), one past the last word for missing arguments, or std::nullopt for problems outside
+    ///        the command line, such as an invalid environment variable
+    std::optional<std::size_t> position {};
+    std::string message {};
 };
 
-template <>
-struct isAllowedType<std::string> : std::true_type {
-};
+namespace details {
+/**
+ * @brief How often an option occurred in a command line and where, in a fixed size so that recording an occurrence
+ *        never allocates. Iterating it yields the positions, of which only the first `maxPositions` are kept
+ */
+class OptionOccurrences
+{
+public:
+    static constexpr std::size_t maxPositions { 8 };
+    using value_type = std::uint32_t;
+    using const_iterator = const std::uint32_t*;
 
-template <>
-struct isAllowedType<int> : std::true_type {
-};
+    /// @brief Record an occurrence at an index of the command line
+    constexpr void add(std::size_t position)
+    {
+        if (positionCount_ < maxPositions) {
+            positions_[positionCount_++] = static_cast<std::uint32_t>(position);
+        }
+        ++count_;
+    }
 
-template <>
-struct isAllowedType<long> : std::true_type {
-};
+    /// @brief Record an occurrence outside the command line, e.g. through an environment variable
+    constexpr void add() { ++count_; }
 
-template <>
-struct isAllowedType<long long> : std::true_type {
-};
+    /// @brief Get the number of occurrences, including the ones whose position was not kept
+    [[nodiscard]] constexpr std::size_t count() const { return count_; }
 
-template <>
-struct isAllowedType<unsigned long> : std::true_type {
-};
+    [[nodiscard]] constexpr std::size_t size() const { return positionCount_; }
+    [[nodiscard]] constexpr bool empty() const { return positionCount_ == 0; }
+    [[nodiscard]] constexpr std::uint32_t operator[](std::size_t index) const { return positions_[index]; }
+    [[nodiscard]] constexpr const std::uint32_t* begin() const { return positions_.data(); }
+    [[nodiscard]] constexpr const std::uint32_t* end() const { return positions_.data() + positionCount_; }
 
-template <>
-struct isAllowedType<unsigned long long> : std::true_type {
+private:
+    std::array<std::uint32_t, maxPositions> positions_ {};
+    std::size_t positionCount_ {};
+    std::size_t count_ {};
 };
 
-template <>
-struct isAllowedType<float> : std::true_type {
-};
+/**
+ * @brief Find the index of an option, i.e. its position among the sorted options of a command
+ * @param sortedOptions The sorted options of the command
+ * @param option The option without leading dashes
+ * @return The index or std::nullopt if the command has no such option
+ */
+inline std::optional<std::size_t>
+findOptionIndex(const std::vector<std::string>& sortedOptions, std::string_view option)
+{
+    const auto search = std::lower_bound(sortedOptions.begin(), sortedOptions.end(), option);
+    if (search == sortedOptions.end() || *search != option) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(search - sortedOptions.begin());
+}
 
-template <>
-struct isAllowedType<double> : std::true_type {
+/// @brief An option as found in the command line, before it is matched against the options of the command
+struct UnparsedOption {
+    /// @brief A view into the command line, which outlives the parse, so that long names are not copied
+    std::string_view name {};
+    /// @brief The index of the option in the command line
+    std::size_t position {};
+    /// @brief The value attached to a long option, e.g. `no` for `--force=no`
+    std::optional<std::string_view> value {};
 };
 
-template <>
-struct isAllowedType<long double> : std::true_type {
-};
+/**
+ * @brief A sorted index of environment variables built from an `environ`-like array
+ *        Names and values are views into the environment block, so nothing is copied
+ */
+class EnvironmentIndex
+{
+public:
+    /**
+     * @brief Index the supplied environment
+     * @param environment A null-terminated array of "NAME=value" strings, e.g. `environ`
+     * @param prefix Only variables whose name starts with this prefix are indexed
+     * @warning The environment must outlive the index and not be modified while the index is in use
+     */
+    explicit EnvironmentIndex(const char* const* environment, std::string_view prefix = {});
 
-template <>
-struct isAllowedType<bool> : std::true_type {
-};
+    /**
+     * @brief Look up an environment variable
+     * @param name The variable name
+     * @return The value of the variable or std::nullopt if it is not set
+     */
+    [[nodiscard]] std::optional<std::string_view> find(std::string_view name) const;
 
-template <typename T>
-struct isAllowedType<std::vector<T>> : isAllowedType<T> {
-};
+    /**
+     * @brief Get the index of the process environment, which is built the first time it is requested
+     *        It is a snapshot: variables set, changed or removed afterwards (e.g. with `setenv` or `putenv`) are not
+     *        seen, and as `setenv` may free replaced values, a program that changes its environment after parsing
+     *        should index `environ` itself once it is done, see the `UnparsedCommand::parse` overloads.
+     *        Only the variables starting with `COMMAND_PARSER_ENV_PREFIX` are indexed, all of them by default
+     * @return The process environment index
+     */
+    static const EnvironmentIndex& process();
 
-template <typename T>
-struct isAllowedType<std::optional<T>> : isAllowedType<T> {
+private:
+    std::vector<std::pair<std::string_view, std::string_view>> entries_ {};
 };
 
-// Adapted from cppreference:
-// https://en.cppreference.com/w/cpp/algorithm/is_partitioned
-template <class InputIt, class UnaryPredicate>
-constexpr bool isPartitioned(InputIt first, InputIt last, UnaryPredicate p)
+#if COMMAND_PARSER_DEFINITIONS
+COMMAND_PARSER_INLINE EnvironmentIndex::EnvironmentIndex(const char* const* environment, std::string_view prefix)
 {
-    for (; first != last; ++first) {
-        if (!p(*first)) {
-            break;
-        }
-    }
-    for (; first != last; ++first) {
-        if (p(*first)) {
-            return false;
+    for (auto variable = environment; variable != nullptr && *variable != nullptr; ++variable) {
+        const std::string_view entry { *variable };
+        const auto separator = entry.find('=');
+        if (separator == std::string_view::npos || entry.compare(0, prefix.size(), prefix) != 0) {
+            continue;
         }
+        entries_.emplace_back(entry.substr(0, separator), entry.substr(separator + 1));
     }
-    return true;
+    // Stable so that, just like getenv, the first definition of a duplicated variable wins
+    std::stable_sort(entries_.begin(), entries_.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
 }
 
-// constexpr std::count since it's not available in C++17
-// Adapted from: https://en.cppreference.com/w/cpp/algorithm/count
-template <class InputIt, class T>
-constexpr auto count(InputIt first, InputIt last, const T& value)
+COMMAND_PARSER_INLINE std::optional<std::string_view> EnvironmentIndex::find(std::string_view name) const
 {
-    typename std::iterator_traits<InputIt>::difference_type n = 0;
-    for (; first != last; ++first) {
-        if (*first == value) {
-            ++n;
-        }
+    const auto entry = std::lower_bound(
+        entries_.begin(), entries_.end(), name, [](const auto& a, std::string_view b) { return a.first < b; });
+    if (entry == entries_.end() || entry->first != name) {
+        return std::nullopt;
     }
-    return n;
+    return entry->second;
+}
+
+COMMAND_PARSER_INLINE const EnvironmentIndex& EnvironmentIndex::process()
+{
+    static const EnvironmentIndex processEnvironment { environ, COMMAND_PARSER_ENV_PREFIX };
+    return processEnvironment;
 }
+#endif
 
-template <class... Ts>
-class ArrayWrapper
+/**
+ * @brief The default of an optional argument, either a constant or a callable that is only called once the default is
+ *        read, see `UnparsedCommandImpl::withArgDefault`
+ * @tparam T The type of the argument within its std::optional
+ */
+template <typename T>
+class ArgumentDefault
 {
 public:
-    explicit constexpr ArrayWrapper(Ts... ts)
-        : data_ { ts... }
+    ArgumentDefault() = default;
+
+    // Not a candidate for copies, which the copy constructor makes even from a non-const ArgumentDefault
+    template <
+        typename Default,
+        typename = std::enable_if_t<!std::is_same_v<std::decay_t<Default>, ArgumentDefault>>>
+    explicit ArgumentDefault(Default&& value)
     {
+        if constexpr (std::is_invocable_r_v<T, Default>) {
+            default_.template emplace<Provider>(std::forward<Default>(value));
+        } else {
+            default_.template emplace<T>(std::forward<Default>(value));
+        }
     }
 
-    using value_type = std::tuple_element_t<0, std::tuple<Ts...>>;
-
-    [[nodiscard]] constexpr const value_type* begin() const { return static_cast<const value_type*>(data_); }
+    [[nodiscard]] explicit operator bool() const { return !std::holds_alternative<std::monostate>(default_); }
 
-    [[nodiscard]] constexpr const value_type* end() const
+    /// @brief Get the default, calling its provider if it is not a constant
+    [[nodiscard]] T get() const
     {
-        return static_cast<const value_type*>(data_) + sizeof...(Ts);
+        if (const auto* constant = std::get_if<T>(&default_)) {
+            return *constant;
+        }
+        return (*std::get_if<Provider>(&default_))();
     }
 
 private:
-    value_type data_[sizeof...(Ts)];
+    using Provider = std::function<T()>;
+    // A constant is kept on its own rather than beside an empty provider
+    std::variant<std::monostate, T, Provider> default_ {};
 };
 
-/// @brief Check that arguments which are mandatory are always expected before optional ones
-template <class... Types>
-constexpr bool hasNoPrecedingOptionalArguments()
-{
-    // TODO(dimitris): Remove ArrayWrapper and replace with constexpr std::array<bool, sizeof...(Types)>
-    //  once we can use a newer clang version, since clang-8 does not think std::array is a literal type
-    constexpr ArrayWrapper r { !isOptional<Types>::value && !isVector<Types>::value... };
-    return isPartitioned(r.begin(), r.end(), [](auto v) { return v; });
-}
-
-/// @brief Check that if we have vector arguments they are always the last ones
-template <class... Types>
-constexpr bool hasNoPrecedingVector()
-{
-    constexpr ArrayWrapper r { !isVector<Types>::value... };
-    return isPartitioned(r.begin(), r.end(), [](auto v) { return v; });
-}
-
-template <class... Types>
-constexpr bool doesNotContainBothOptionalAndVector()
-{
-    constexpr ArrayWrapper optionals { isOptional<Types>::value... };
-    constexpr auto optionalArguments = count(optionals.begin(), optionals.end(), true);
-    constexpr ArrayWrapper vectors { isVector<Types>::value... };
-    constexpr auto vectorArguments = count(vectors.begin(), vectors.end(), true);
+/// @brief The placeholder for the default of an argument that is not optional
+struct NoArgumentDefault {
+};
 
-    return optionalArguments == 0 || vectorArguments == 0;
-}
+/// @brief A typed default once read through a parsed command, so that it is computed at most once per parse
+template <typename T>
+struct ResolvedDefault {
+    std::once_flag once {};
+    std::optional<T> value {};
+};
 
-template <class... Types>
-constexpr bool containsAtMostOneVector()
-{
-    constexpr ArrayWrapper vectors { isVector<Types>::value... };
+template <typename T>
+struct resolvedDefaultType {
+    using type = NoArgumentDefault;
+};
 
-    return count(vectors.begin(), vectors.end(), true) <= 1;
-}
+template <typename T>
+struct resolvedDefaultType<std::optional<T>> {
+    using type = ResolvedDefault<T>;
+};
 
-constexpr void removeAllLeading(std::string_view& view, char charToRemove)
-{
-    view.remove_prefix(std::min(view.find_first_not_of(charToRemove), view.size()));
-}
+/// @brief The typed defaults of the arguments of a parsed command, one slot per argument
+template <typename ArgumentsType>
+struct ResolvedDefaults;
 
-constexpr bool isAnOption(std::string_view argument)
-{
-    // Too small to be an option
-    if (argument.size() < 2) {
-        return false;
-    }
-    // It's a negative number
-    if (argument[0] == '-' && std::isdigit(argument[1], std::locale::classic())) {
-        return false;
-    }
-    // Does not start with one or two dashes
-    const auto startsWithSingleDash = argument[0] == '-';
-    const auto startsWithDoubleDash = argument[0] == '-' && argument[1] == '-';
-    if (!startsWithSingleDash && !startsWithDoubleDash) {
-        return false;
-    }
-    // Contains spaces (we will eventually have to rethink this when doing #7)
-    if (argument.find(' ') != std::string_view::npos) {
-        return false;
-    }
-    // If we start with two dashes, then there should be at least one more character
-    if (startsWithDoubleDash && argument.size() < 3) {
-        return false;
-    }
-    // If we start with two dashes, then the following character should be alphanumeric
-    if (startsWithDoubleDash && !std::isalnum(argument[2], std::locale::classic())) {
-        return false;
-    }
+template <typename... Ts>
+struct ResolvedDefaults<std::tuple<Ts...>> {
+    std::tuple<typename resolvedDefaultType<Ts>::type...> slots {};
+};
 
-    return true;
-}
+template <typename T>
+struct argumentDefaultType {
+    using type = NoArgumentDefault;
+};
 
-template <typename T, typename Tuple>
-struct typeInTuple;
+template <typename T>
+struct argumentDefaultType<std::optional<T>> {
+    using type = ArgumentDefault<T>;
+};
 
-template <typename T, typename... Types>
-struct typeInTuple<T, std::tuple<Types...>> : std::disjunction<std::is_same<T, Types>...> {
+template <typename... Ts>
+std::tuple<typename argumentDefaultType<Ts>::type...> argumentDefaultsOf(std::tuple<Ts...>);
+
+/// @brief A constraint between options, compiled to masks of their indices
+struct CompiledOptionConstraint {
+    OptionConstraint constraint {};
+    std::vector<std::string> options {};
+    /// @brief The options of the constraint, or only the first option of a `requiring` constraint
+    OptionMask mask {};
+    /// @brief The options a `requiring` constraint requires
+    OptionMask required {};
+
+    [[nodiscard]] constexpr bool isSatisfiedBy(OptionMask parsedOptions) const
+    {
+        const auto supplied = parsedOptions & mask;
+        const auto atMostOne = (supplied & (supplied - 1)) == 0;
+        switch (constraint) {
+        case OptionConstraint::conflicting:
+            return atMostOne;
+        case OptionConstraint::requiring:
+            return supplied == 0 || (parsedOptions & required) == required;
+        case OptionConstraint::exactlyOne:
+            return supplied != 0 && atMostOne;
+        case OptionConstraint::atLeastOne:
+            return supplied != 0;
+        }
+        return true;
+    }
 };
 
 template <typename CommandTypes>
@@ -304,6 +377,9 @@ public:
                 shortOptions_.emplace(option);
             }
         }
+        std::vector<std::string> sortedOptions { options_.begin(), options_.end() };
+        std::sort(sortedOptions.begin(), sortedOptions.end());
+        sortedOptions_ = std::make_shared<const std::vector<std::string>>(std::move(sortedOptions));
     }
 
     /**
@@ -349,7 +425,7 @@ public:
      * @brief Get the command ID
      * @return The command ID
      */
-    std::string id() const { return id_; };
+    const std::string& id() const { return id_; };
 
     /**
      * @brief Check if the supplied command ID matches the ID or the aliases of this command
@@ -362,27 +438,126 @@ public:
      * @brief Get the command description
      * @return The command description
      */
-    std::string usage() const { return usage_; };
+    const std::string& usage() const { return usage_; };
 
     /**
      * @brief Get the command usage
      * @return The command usage
      */
-    std::string description() const { return description_; };
+    const std::string& description() const { return description_; };
+
+    /**
+     * @brief Get the command aliases
+     * @return The command aliases
+     * @warning This function is to be used mostly internally
+     */
+    const std::unordered_set<std::string>& aliases() const { return aliases_; };
 
     /**
      * @brief Get all the command options
      * @return The command options
      * @warning This function is to be used mostly internally
      */
-    std::unordered_set<std::string> options() const { return options_; };
+    const std::unordered_set<std::string>& options() const { return options_; };
 
     /**
      * @brief Get the command short options
      * @return The command short options
      * @warning This function is to be used mostly internally
      */
-    std::unordered_set<std::string> shortOptions() const { return shortOptions_; };
+    const std::unordered_set<std::string>& shortOptions() const { return shortOptions_; };
+
+    /**
+     * @brief Get the index of an option, i.e. its position among the sorted options, which does not depend on the
+     *        order options were added in
+     * @param option The option without leading dashes
+     * @return The index or std::nullopt if the command has no such option
+     * @warning This function is to be used mostly internally
+     */
+    std::optional<std::size_t> optionIndex(std::string_view option) const
+    {
+        return sortedOptions_ ? findOptionIndex(*sortedOptions_, option) : std::nullopt;
+    }
+
+    /**
+     * @brief Get the sorted options, shared so that a parsed command can look its options up after the command is gone
+     * @return The sorted options, nullptr for a default constructed command
+     * @warning This function is to be used mostly internally
+     */
+    const std::shared_ptr<const std::vector<std::string>>& sortedOptions() const { return sortedOptions_; }
+
+    /**
+     * @brief Get the constraints between options, compiled to masks of option indices
+     * @return The constraints
+     * @warning This function is to be used mostly internally
+     */
+    const std::vector<CompiledOptionConstraint>& optionConstraints() const { return optionConstraints_; };
+
+    /**
+     * @brief Check if the constraints between options can be checked, which needs every option to fit in a mask
+     * @return Whether the command has no constraints or at most `details::maxConstrainedOptions` options
+     * @warning This function is to be used mostly internally
+     */
+    bool optionConstraintsSupported() const
+    {
+        return optionConstraints_.empty() || !sortedOptions_ || sortedOptions_->size() <= maxConstrainedOptions;
+    }
+
+    /**
+     * @brief Get the environment variable an optional argument falls back to
+     * @param index The argument index
+     * @return The environment variable name or std::nullopt if the argument has no fallback
+     * @warning This function is to be used mostly internally
+     */
+    std::optional<std::string_view> argEnvironment(std::size_t index) const
+    {
+        const auto search = argumentEnvironment_.find(index);
+        if (search == argumentEnvironment_.end()) {
+            return std::nullopt;
+        }
+        return search->second;
+    }
+
+    /**
+     * @brief Get the environment variables options fall back to
+     * @return A map of option to environment variable name
+     * @warning This function is to be used mostly internally
+     */
+    const std::unordered_map<std::string, std::string>& optionEnvironment() const { return optionEnvironment_; };
+
+    /**
+     * @brief Get the default value of an optional argument, in its command line form
+     * @param index The argument index
+     * @return The default value or std::nullopt if the argument has no default
+     * @warning This function is to be used mostly internally
+     */
+    std::optional<std::string_view> argDefault(std::size_t index) const
+    {
+        const auto search = argumentDefaults_.find(index);
+        if (search == argumentDefaults_.end()) {
+            return std::nullopt;
+        }
+        return search->second;
+    }
+
+    /**
+     * @brief Get the typed default of an optional argument
+     * @tparam Index The argument index
+     * @return The default, which is false if the argument has none
+     * @warning This function is to be used mostly internally
+     */
+    template <std::size_t Index>
+    const auto& argTypedDefault() const
+    {
+        return std::get<Index>(argumentTypedDefaults_);
+    }
+
+    /**
+     * @brief Get the default values of options, in their command line form (e.g. "on" or "off")
+     * @return A map of option to default value
+     * @warning This function is to be used mostly internally
+     */
+    const std::unordered_map<std::string, std::string_view>& optionDefaults() const { return optionDefaults_; };
 
     /**
      * @brief Construct a new command with the specified argument types
@@ -393,7 +568,7 @@ public:
     auto withArgs() const
     {
         using ConcatinatedTypes = decltype(std::tuple_cat(std::declval<CommandTypes>(), std::tuple<T...> {}));
-        return UnparsedCommandImpl<ConcatinatedTypes> { id_, aliases_, description_, usage_, options_ };
+        return copyWith<ConcatinatedTypes>(aliases_, options_);
     }
 
     /**
@@ -410,7 +585,7 @@ public:
             sanitizedOptions.emplace(view);
         }
         sanitizedOptions.insert(options_.begin(), options_.end());
-        return UnparsedCommandImpl<CommandTypes> { id_, aliases_, description_, usage_, std::move(sanitizedOptions) };
+        return copyWith<CommandTypes>(aliases_, std::move(sanitizedOptions));
     }
 
     /**
@@ -420,202 +595,779 @@ public:
     UnparsedCommandImpl<CommandTypes> withAliases(std::unordered_set<std::string> aliases) const
     {
         aliases.insert(aliases_.begin(), aliases_.end());
-        return UnparsedCommandImpl<CommandTypes> { id_, std::move(aliases), description_, usage_, options_ };
+        return copyWith<CommandTypes>(std::move(aliases), options_);
     }
 
-private:
-    std::string id_ {};
-    std::unordered_set<std::string> aliases_ {};
-    std::string description_ {};
-    std::string usage_ {};
-    std::unordered_set<std::string> options_ {};
-    std::unordered_set<std::string> shortOptions_ {};
-};
-
-/**
- * @brief Given a tuple of UnparsedCommandImpl
- * create a tuple of UnparsedCommandImpl::ArgumentsType
- * @tparam T
- * @return A tuple of tuples with the argument types
- */
-template <typename... T>
-constexpr auto transformUnparsedArgumentsType(std::tuple<T...>)
-{
-    return std::tuple<typename T::ArgumentsType...> {};
-}
-} // namespace details
-
-template <typename T>
-class ParsedCommandImpl
-{
-public:
     /**
-     * @brief Constructs a parsed command
-     * @param argc The argument count
-     * @param argv The argument values
-     * @param commands A tuple with the unparsed commands
-     * @warning Users should probably use the helper function `UnparsedCommand::parse`
+     * @brief Construct a new command where an optional argument falls back to an environment variable
+     *        The variable is only used when the argument is not supplied in the command line
+     * @tparam Index The index of the optional argument
+     * @param variable The environment variable name (e.g. "TOOL_THREADS")
+     * @return A new command with the environment fallback
      */
-    ParsedCommandImpl(int argc, char* argv[], const T& commands)
-        : helpPrompt_ { createHelpPrompt(commands) }
+    template <std::size_t Index>
+    UnparsedCommandImpl<CommandTypes> withEnvArg(std::string variable) const
     {
-        if (argc < 2) {
-            std::cerr << "No command passed" << std::endl;
-            return;
-        }
-        const std::string commandId { argv[1] };
-        std::vector<std::string> unparsedArgs {};
-        std::vector<std::string> unparsedOptions {};
-        for (int i = 2; i < argc; ++i) {
-            std::string_view argument { argv[i] };
-            if (details::isAnOption(argument)) {
-                details::removeAllLeading(argument, '-');
-                unparsedOptions.emplace_back(argument.data());
-            } else {
-                details::removeAllLeading(argument, '\\');
-                unparsedArgs.emplace_back(argument.data());
-            }
-        }
-
-        // Find if the commandId exists in the supplied commands
-        bool commandFound {};
-        bool commandHasCorrectArguments {};
-        details::visitTuple(
-            commands,
-            [&commandId, &commandFound, &unparsedArgs, &commandHasCorrectArguments, &unparsedOptions, this, index = 0U](
-                auto&& command) mutable {
-                if (command.matches(commandId)) {
-                    commandFound = true;
-                    const auto expectedMaxNumberOfArguments = command.getMaxArgCount();
-                    const auto expectedMinNumberOfArguments = command.getRequiredArgCount();
-                    if (unparsedArgs.size() < expectedMinNumberOfArguments
-                        || unparsedArgs.size() > expectedMaxNumberOfArguments) {
-                        std::cerr << "Wrong number of arguments for command: " << commandId << std::endl;
-                        std::cerr << command.id() << " " << command.usage() << " " << command.description()
-                                  << std::endl;
-                        std::cerr << "Expected ";
-                        const auto atLeastOrAtMost
-                            = unparsedArgs.size() < expectedMinNumberOfArguments ? "at least " : "at most ";
-                        std::cerr << atLeastOrAtMost << expectedMaxNumberOfArguments << " arguments, got "
-                                  << unparsedArgs.size() << " instead: ";
-                        for (const auto& arg : unparsedArgs) {
-                            std::cerr << "\"" << arg << "\""
-                                      << " ";
-                        }
-                        std::cerr << std::endl;
-                    } else {
-                        commandHasCorrectArguments = true;
-                        commandIndex_ = index;
-                        commandId_ = command.id();
-                        // Match options
-                        for (const auto& unparsedOption : unparsedOptions) {
-                            // Match stand-alone options
-                            const auto availableOptions = command.options();
-                            const auto search = availableOptions.find(unparsedOption);
-                            if (search != availableOptions.end()) {
-                                parsedOptions_.emplace(unparsedOption);
-                            } else { // Match compound options (e.g. -abc instead of -a -b -c)
-                                const auto allCharactersAreShortOptions
-                                    = std::all_of(unparsedOption.begin(), unparsedOption.end(), [&command](auto c) {
-                                          return command.shortOptions().find(std::string { c })
-                                              != command.shortOptions().end();
-                                      });
-                                if (allCharactersAreShortOptions) {
-                                    for (const auto c : unparsedOption) {
-                                        parsedOptions_.emplace(std::string { c });
-                                    }
-                                } else {
-                                    unknownOptions_.emplace(unparsedOption);
-                                }
-                            }
-                        }
-                    }
-                }
-                ++index;
-            });
-
-        if (!commandFound) {
-            std::cerr << "Unrecognized command: " << commandId << std::endl;
-            return;
-        }
-
-        if (!commandHasCorrectArguments) {
-            return;
-        }
+        static_assert(Index < std::tuple_size_v<CommandTypes>, "Argument index out of range");
+        static_assert(
+            isOptional<std::tuple_element_t<Index, CommandTypes>>::value,
+            "Only std::optional arguments can fall back to an environment variable");
+        auto command = copyWith<CommandTypes>(aliases_, options_);
+        command.argumentEnvironment_[Index] = std::move(variable);
+        return command;
+    }
 
-        // Parse the unparsed arguments
-        details::visitTuple(
-            parsedArguments_,
-            [&unparsedArgs, this, argumentIndex = 0U](auto&& argumentsToParse) mutable {
-                if (argumentIndex == commandIndex_.value()) {
-                    details::visitTuple(
-                        argumentsToParse,
-                        [&unparsedArgs, this, parsedArgumentIndex = 0U](auto&& arg) mutable {
-                            if (parsedArgumentIndex >= unparsedArgs.size()) {
-                                // We end up here when we are out of unparsed arguments. This can happen when:
-                                // We expected an optional argument that was not passed by the user in which case we
-                                // want to leave the argument in the error state that it is, i.e. nullopt
-                                return;
-                            }
-                            this->parseArgument(arg, unparsedArgs, parsedArgumentIndex);
-                            ++parsedArgumentIndex;
-                        });
-                }
-                ++argumentIndex;
-            });
+    /**
+     * @brief Construct a new command where an option falls back to an environment variable
+     *        The option is set if it is not supplied in the command line and the variable is a "true" boolean
+     * @param option The option, which is added to the command options if not already there
+     * @param variable The environment variable name (e.g. "TOOL_VERBOSE")
+     * @return A new command with the option and its environment fallback
+     */
+    UnparsedCommandImpl<CommandTypes> withEnvOption(const std::string& option, std::string variable) const
+    {
+        auto view = std::string_view { option };
+        removeAllLeading(view, '-');
+        auto command = withOptions({ std::string { view } });
+        command.optionEnvironment_[std::string { view }] = std::move(variable);
+        return command;
     }
 
     /**
-     * @brief Check if the parsed command is the supplied (unparsed) command
-     * @tparam CommandType The unparsed command
-     * @param command
-     * @return Whether the parsed command matches the unparsed command
+     * @brief Construct a new command where an optional argument has a default value
+     *        The default is only converted if the argument is supplied neither in the command line
+     *        nor through its environment fallback
+     * @tparam Index The index of the optional argument
+     * @param value The default value in its command line form, which is not copied
+     * @return A new command with the default value
+     * @warning The memory `value` refers to must outlive the command, see `UnparsedCommand::ConfigFile`
      */
-    template <typename CommandType>
-    [[nodiscard]] bool is(const CommandType& command) const
+    template <std::size_t Index>
+    UnparsedCommandImpl<CommandTypes> withArgDefault(std::string_view value) const
     {
+        static_assert(Index < std::tuple_size_v<CommandTypes>, "Argument index out of range");
         static_assert(
-            details::typeInTuple<CommandType, T>::value,
-            "The specified command was not included in the tuple of commands passed when calling "
-            "UnparsedCommand::parse");
-        return command.id() == commandId_;
+            isOptional<std::tuple_element_t<Index, CommandTypes>>::value,
+            "Only std::optional arguments can have a default value");
+        auto command = copyWith<CommandTypes>(aliases_, options_);
+        command.argumentDefaults_[Index] = value;
+        return command;
     }
 
     /**
-     * @brief Get the parsed arguments for the supplied command
-     * @tparam CommandType The unparsed command
-     * @param command
-     * @return  A command-specific tuple with the parsed arguments
+     * @brief Construct a new command where an optional argument has a typed default, which is only computed when read
+     *        through `ParsedCommandImpl::getArg`, `ParsedCommandImpl::getArgs` or `ParsedCommandImpl::dispatch`, if
+     *        the argument is supplied neither in the command line nor through its environment fallback or default
+     *        value. It is computed at most once per parsed command, even when read from many threads
+     * @tparam Index The index of the optional argument
+     * @param value Either a value of the argument type or a callable returning one (e.g. reading a file), which is
+     *        not called unless the default is read
+     * @return A new command with the default
      */
-    template <typename CommandType>
-    [[nodiscard]] auto getArgs(const CommandType& command) const
+    template <
+        std::size_t Index,
+        typename Default,
+        typename = std::enable_if_t<!std::is_convertible_v<Default, std::string_view>>>
+    UnparsedCommandImpl<CommandTypes> withArgDefault(Default&& value) const
     {
-        assert((is(command)) && "Command not found"); // NOLINT (cppcoreguidelines-pro-bounds-array-to-pointer-decay)
-        static_cast<void>(command); // Avoid unused parameter warning in non-debug builds
-        typename CommandType::ArgumentsType argsToReturn {};
-        details::visitTuple(parsedArguments_, [&argsToReturn, this, index = 0U](auto&& arg) mutable {
-            if (index == commandIndex_.value()) {
-                if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, std::decay_t<decltype(argsToReturn)>>) {
-                    argsToReturn = arg;
-                }
-            }
-            ++index;
-        });
-
-        return argsToReturn;
+        static_assert(Index < std::tuple_size_v<CommandTypes>, "Argument index out of range");
+        using Argument = std::tuple_element_t<Index, CommandTypes>;
+        static_assert(isOptional<Argument>::value, "Only std::optional arguments can have a default value");
+        using Value = typename Argument::value_type;
+        static_assert(
+            std::is_invocable_r_v<Value, Default> || std::is_constructible_v<Value, Default>,
+            "The default must be either a value of the argument type or a callable returning one");
+        auto command = copyWith<CommandTypes>(aliases_, options_);
+        std::get<Index>(command.argumentTypedDefaults_) = ArgumentDefault<Value> { std::forward<Default>(value) };
+        return command;
     }
 
     /**
-     * @brief Check if the supplied option was encountered for the parsed command
-     * @param option
-     * @return true if the option was encountered, false otherwise
+     * @brief Construct a new command where an option has a default value
+     *        The default is only used if the option is supplied neither in the command line
+     *        nor through its environment fallback
+     * @param option The option, which is added to the command options if not already there
+     * @param value The default value as a boolean string (e.g. "on"), which is not copied
+     * @return A new command with the option and its default value
+     * @warning The memory `value` refers to must outlive the command, see `UnparsedCommand::ConfigFile`
      */
-    [[nodiscard]] bool hasOption(const std::string& option) const
+    UnparsedCommandImpl<CommandTypes> withOptionDefault(const std::string& option, std::string_view value) const
     {
-        // Let's be forgiving if someone looks for "--option" instead of "option"
-        std::string_view view { option };
-        details::removeAllLeading(view, '-');
-        return parsedOptions_.find(std::string { view }) != parsedOptions_.end();
+        auto view = std::string_view { option };
+        removeAllLeading(view, '-');
+        auto command = withOptions({ std::string { view } });
+        command.optionDefaults_[std::string { view }] = value;
+        return command;
+    }
+
+    /**
+     * @brief Construct a new command with several defaults at once, copying the command only once,
+     *        e.g. for all the defaults of a `UnparsedCommand::ConfigFile`
+     * @param argumentDefaults Default values by the index of their optional argument, see `withArgDefault`
+     * @param optionDefaults Default values by option, see `withOptionDefault`. The options are added to the command
+     *        options if not already there
+     * @return A new command with the default values
+     * @warning The memory the values refer to must outlive the command
+     */
+    UnparsedCommandImpl<CommandTypes> withDefaults(
+        const std::unordered_map<std::size_t, std::string_view>& argumentDefaults,
+        const std::unordered_map<std::string, std::string_view>& optionDefaults) const
+    {
+        auto options = options_;
+        for (const auto& optionDefault : optionDefaults) {
+            auto view = std::string_view { optionDefault.first };
+            removeAllLeading(view, '-');
+            options.emplace(view);
+        }
+        auto command = copyWith<CommandTypes>(aliases_, std::move(options));
+        for (const auto& [index, value] : argumentDefaults) {
+            assert(index < std::tuple_size_v<CommandTypes> && "Argument index out of range");
+            command.argumentDefaults_[index] = value;
+        }
+        for (const auto& [option, value] : optionDefaults) {
+            auto view = std::string_view { option };
+            removeAllLeading(view, '-');
+            command.optionDefaults_[std::string { view }] = value;
+        }
+        return command;
+    }
+
+    /**
+     * @brief Construct a new command where at most one of the supplied options may be given
+     *        (e.g. "--force" conflicts with "--dry-run")
+     * @param options The options, which are added to the command options if not already there
+     * @return A new command with the constraint
+     */
+    UnparsedCommandImpl<CommandTypes> withConflictingOptions(std::vector<std::string> options) const
+    {
+        return withConstraint(OptionConstraint::conflicting, std::move(options));
+    }
+
+    /**
+     * @brief Construct a new command where an option may only be given along with all the supplied options
+     *        (e.g. "-x" requires "-y")
+     * @param option The option, which is added to the command options if not already there, as are the others
+     * @param requiredOptions The options required by `option`
+     * @return A new command with the constraint
+     */
+    UnparsedCommandImpl<CommandTypes>
+    withRequiredOptions(std::string option, std::vector<std::string> requiredOptions) const
+    {
+        requiredOptions.insert(requiredOptions.begin(), std::move(option));
+        return withConstraint(OptionConstraint::requiring, std::move(requiredOptions));
+    }
+
+    /**
+     * @brief Construct a new command where exactly one of the supplied options must be given
+     *        (e.g. one of "--json" and "--yaml")
+     * @param options The options, which are added to the command options if not already there
+     * @return A new command with the constraint
+     */
+    UnparsedCommandImpl<CommandTypes> withExactlyOneOption(std::vector<std::string> options) const
+    {
+        return withConstraint(OptionConstraint::exactlyOne, std::move(options));
+    }
+
+    /**
+     * @brief Construct a new command where at least one of the supplied options must be given
+     * @param options The options, which are added to the command options if not already there
+     * @return A new command with the constraint
+     */
+    UnparsedCommandImpl<CommandTypes> withAtLeastOneOption(std::vector<std::string> options) const
+    {
+        return withConstraint(OptionConstraint::atLeastOne, std::move(options));
+    }
+
+private:
+    template <typename>
+    friend class UnparsedCommandImpl;
+
+    UnparsedCommandImpl<CommandTypes>
+    withConstraint(OptionConstraint constraint, std::vector<std::string> options) const
+    {
+        std::unordered_set<std::string> sanitizedOptions {};
+        for (auto& option : options) {
+            auto view = std::string_view { option };
+            removeAllLeading(view, '-');
+            option = std::string { view };
+            sanitizedOptions.emplace(option);
+        }
+        auto command = withOptions(std::move(sanitizedOptions));
+        command.optionConstraints_.push_back({ constraint, std::move(options) });
+        command.compileOptionConstraints();
+        return command;
+    }
+
+    /**
+     * @brief Compute the masks of the constraints, whose option indices change as options are added
+     *        Options past the mask are left out, a command with them is rejected when parsed,
+     *        see `optionConstraintsSupported`
+     */
+    void compileOptionConstraints()
+    {
+        for (auto& constraint : optionConstraints_) {
+            constraint.mask = 0;
+            constraint.required = 0;
+            for (std::size_t i = 0; i < constraint.options.size(); ++i) {
+                const auto index = optionIndex(constraint.options[i]).value_or(0);
+                if (index >= maxConstrainedOptions) {
+                    continue;
+                }
+                const auto bit = OptionMask { 1 } << index;
+                const auto isRequired = constraint.constraint == OptionConstraint::requiring && i > 0;
+                (isRequired ? constraint.required : constraint.mask) |= bit;
+            }
+        }
+    }
+
+    /**
+     * @brief Copy this command, including any fallbacks, with possibly different argument types, aliases and options
+     */
+    template <typename Other>
+    UnparsedCommandImpl<Other>
+    copyWith(std::unordered_set<std::string> aliases, std::unordered_set<std::string> options) const
+    {
+        UnparsedCommandImpl<Other> command { id_, std::move(aliases), description_, usage_, std::move(options) };
+        command.argumentEnvironment_ = argumentEnvironment_;
+        command.optionEnvironment_ = optionEnvironment_;
+        command.argumentDefaults_ = argumentDefaults_;
+        command.optionDefaults_ = optionDefaults_;
+        command.optionConstraints_ = optionConstraints_;
+        command.compileOptionConstraints();
+        // The argument types of the copy start with the ones of this command
+        copyTypedDefaults(command, std::make_index_sequence<std::tuple_size_v<CommandTypes>> {});
+        return command;
+    }
+
+    template <typename Other, std::size_t... Indices>
+    void copyTypedDefaults([[maybe_unused]] UnparsedCommandImpl<Other>& command, std::index_sequence<Indices...>) const
+    {
+        ((std::get<Indices>(command.argumentTypedDefaults_) = std::get<Indices>(argumentTypedDefaults_)), ...);
+    }
+
+    std::string id_ {};
+    std::unordered_set<std::string> aliases_ {};
+    std::string description_ {};
+    std::string usage_ {};
+    std::unordered_set<std::string> options_ {};
+    std::unordered_set<std::string> shortOptions_ {};
+    std::shared_ptr<const std::vector<std::string>> sortedOptions_ {};
+    std::vector<CompiledOptionConstraint> optionConstraints_ {};
+    std::unordered_map<std::size_t, std::string> argumentEnvironment_ {};
+    std::unordered_map<std::string, std::string> optionEnvironment_ {};
+    std::unordered_map<std::size_t, std::string_view> argumentDefaults_ {};
+    decltype(argumentDefaultsOf(CommandTypes {})) argumentTypedDefaults_ {};
+    std::unordered_map<std::string, std::string_view> optionDefaults_ {};
+};
+
+/**
+ * @brief Given a tuple of UnparsedCommandImpl
+ * create a tuple of UnparsedCommandImpl::ArgumentsType
+ * @tparam T
+ * @return A tuple of tuples with the argument types
+ */
+template <typename... T>
+constexpr auto transformUnparsedArgumentsType(std::tuple<T...>)
+{
+    return std::tuple<typename T::ArgumentsType...> {};
+}
+} // namespace details
+
+/// @brief The phases of parsing a command, as reported to an instrumentation policy
+enum class ParsePhase {
+    tokenization,
+    commandLookup,
+    optionMatching,
+    argumentConversion,
+    helpGeneration,
+};
+
+/// @brief The counts reported to an instrumentation policy once per parse
+enum class ParseCounter {
+    tokens,
+    options,
+    arguments,
+    allocations,
+};
+
+/**
+ * @brief The default instrumentation policy which compiles away completely
+ *
+ * An enabled policy is default constructed for every parse and should provide:
+ * - `static constexpr bool enabled { true };`
+ * - `void onPhase(ParsePhase, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)`
+ * - `void onCount(ParseCounter, std::size_t)`
+ * - Optionally `static std::size_t allocationCount()` returning a running allocation count, in which case the
+ *   allocations made during the parse are reported as `ParseCounter::allocations`
+ */
+struct NoInstrumentation {
+    static constexpr bool enabled { false };
+};
+
+namespace details {
+template <typename Instrumentation, typename Valid = void>
+struct hasAllocationCount : std::false_type {
+};
+
+template <typename Instrumentation>
+struct hasAllocationCount<Instrumentation, std::void_t<decltype(Instrumentation::allocationCount())>>
+    : std::true_type {
+};
+
+/**
+ * @brief Forwards timestamps and counts to an instrumentation policy or does nothing if the policy is disabled
+ *        The allocations made during the lifetime of the probe are reported on destruction
+ */
+template <typename Instrumentation>
+class ParseProbe
+{
+public:
+    ParseProbe()
+    {
+        if constexpr (Instrumentation::enabled && hasAllocationCount<Instrumentation>::value) {
+            allocationsBefore_ = Instrumentation::allocationCount();
+        }
+    }
+
+    ParseProbe(const ParseProbe&) = delete;
+    ParseProbe& operator=(const ParseProbe&) = delete;
+
+    ~ParseProbe()
+    {
+        if constexpr (Instrumentation::enabled && hasAllocationCount<Instrumentation>::value) {
+            const auto allocations = Instrumentation::allocationCount() - allocationsBefore_;
+            instrumentation_.onCount(ParseCounter::allocations, allocations);
+        }
+    }
+
+    /**
+     * @brief Run the supplied function and report how long it took as the supplied phase
+     * @param phase The phase the function belongs to
+     * @param function The function to run
+     * @return The return value of the function
+     */
+    template <typename Function>
+    auto measure(ParsePhase phase, Function&& function)
+    {
+        if constexpr (Instrumentation::enabled) {
+            const auto begin = std::chrono::steady_clock::now();
+            if constexpr (std::is_void_v<decltype(function())>) {
+                function();
+                instrumentation_.onPhase(phase, begin, std::chrono::steady_clock::now());
+            } else {
+                auto result = function();
+                instrumentation_.onPhase(phase, begin, std::chrono::steady_clock::now());
+                return result;
+            }
+        } else {
+            static_cast<void>(phase);
+            return function();
+        }
+    }
+
+    void count(ParseCounter counter, std::size_t value)
+    {
+        if constexpr (Instrumentation::enabled) {
+            instrumentation_.onCount(counter, value);
+        } else {
+            static_cast<void>(counter);
+            static_cast<void>(value);
+        }
+    }
+
+private:
+    struct Disabled {
+    };
+    std::conditional_t<Instrumentation::enabled, Instrumentation, Disabled> instrumentation_ {};
+    std::size_t allocationsBefore_ {};
+};
+
+/**
+ * @brief Append the help line of a command, padded so that the descriptions of all commands are aligned
+ * @param longestCommandIdAndUsage The longest ID and usage of all commands, including a separating space
+ */
+COMMAND_PARSER_INLINE void appendHelpLine(
+    std::string& helpPrompt,
+    std::string_view id,
+    std::string_view usage,
+    std::string_view description,
+    std::size_t longestCommandIdAndUsage);
+
+#if COMMAND_PARSER_DEFINITIONS
+COMMAND_PARSER_INLINE void appendHelpLine(
+    std::string& helpPrompt,
+    std::string_view id,
+    std::string_view usage,
+    std::string_view description,
+    std::size_t longestCommandIdAndUsage)
+{
+    helpPrompt.append(" ").append(id).append(" ").append(usage);
+    helpPrompt.append(longestCommandIdAndUsage - (id.size() + usage.size()), ' ');
+    helpPrompt.append(description).append("\n");
+}
+#endif
+
+/**
+ * @brief Create the help prompt by finding the longest command id and usage so the description is nicely aligned
+ * @param commands
+ */
+template <typename T>
+std::string createHelpPrompt(const T& commands)
+{
+    std::size_t longestCommandIdAndUsage { 0 };
+    visitTuple(commands, [&longestCommandIdAndUsage](auto&& command) {
+        constexpr std::size_t separatorSize { 1 };
+        const auto commandIdAndUsage = command.id().size() + command.usage().size() + separatorSize;
+        if (commandIdAndUsage > longestCommandIdAndUsage) {
+            longestCommandIdAndUsage = commandIdAndUsage;
+        }
+    });
+
+    // Sized up front, so that building the help of many commands takes a single allocation
+    std::size_t helpPromptSize { 0 };
+    visitTuple(commands, [&helpPromptSize, longestCommandIdAndUsage](auto&& command) {
+        constexpr std::size_t indentAndNewlineSize { 2 };
+        helpPromptSize += longestCommandIdAndUsage + command.description().size() + indentAndNewlineSize;
+    });
+    std::string helpPrompt {};
+    helpPrompt.reserve(helpPromptSize);
+    visitTuple(commands, [&helpPrompt, longestCommandIdAndUsage](auto&& command) {
+        appendHelpLine(helpPrompt, command.id(), command.usage(), command.description(), longestCommandIdAndUsage);
+    });
+
+    return helpPrompt;
+}
+
+/**
+ * @brief The parts of parsing that only depend on the commands, computed once so that they can be shared by many
+ *        parses of the same commands, e.g. by a long-running server
+ * @tparam T A tuple with the unparsed commands
+ */
+template <typename T>
+class CommandTable
+{
+public:
+    explicit CommandTable(const T& commands)
+        : helpPrompt_ { std::make_shared<const std::string>(createHelpPrompt(commands)) }
+    {
+        // The first command to claim an ID or alias wins, same as when looking commands up one by one
+        visitTupleWithIndex(commands, [this](auto&& command, auto index) {
+            indices_.emplace(command.id(), index);
+            for (const auto& alias : command.aliases()) {
+                indices_.emplace(alias, index);
+            }
+        });
+    }
+
+    /**
+     * @brief Find the command with the supplied ID or alias
+     * @param commandId The command ID or alias
+     * @return The index of the command in the tuple or std::nullopt if there is no such command
+     */
+    [[nodiscard]] std::optional<std::size_t> find(const std::string& commandId) const
+    {
+        const auto search = indices_.find(commandId);
+        if (search == indices_.end()) {
+            return std::nullopt;
+        }
+        return search->second;
+    }
+
+    [[nodiscard]] const std::string& help() const { return *helpPrompt_; }
+
+    /// @brief Get the help prompt to share with the parsed commands, which may outlive the table
+    [[nodiscard]] const std::shared_ptr<const std::string>& sharedHelp() const { return helpPrompt_; }
+
+private:
+    std::shared_ptr<const std::string> helpPrompt_ {};
+    std::unordered_map<std::string, std::size_t> indices_ {};
+};
+
+/**
+ * @brief How a command line is parsed besides the commands, see the `UnparsedCommand::parse` overloads
+ * @tparam T A tuple with the unparsed commands
+ */
+template <typename T>
+struct ParseContext {
+    /// @brief The environment to resolve fallbacks from, the process environment if nullptr
+    const EnvironmentIndex* environment { nullptr };
+    /// @brief A table precomputed from the commands, computed for the parse if nullptr
+    const CommandTable<T>* table { nullptr };
+    /// @brief Whether the program name, i.e. `basename(argv[0])`, may name the command (busybox-style)
+    bool multiCall { false };
+    /// @brief Whether parsing goes on after a problem to collect all of them, see `UnparsedCommand::validate`
+    bool collectErrors { false };
+};
+
+/**
+ * @brief Get the file name of a program path
+ * @param programPath The program path, i.e. `argv[0]` (e.g. "/usr/bin/tool")
+ * @return The part after the last slash (e.g. "tool")
+ */
+constexpr std::string_view programName(std::string_view programPath)
+{
+    const auto lastSlash = programPath.find_last_of('/');
+    return lastSlash == std::string_view::npos ? programPath : programPath.substr(lastSlash + 1);
+}
+
+/**
+ * @brief The words of a command line, either argv or the words of a line split into words, viewed without copying
+ */
+class CommandLineWords
+{
+public:
+    CommandLineWords() = default;
+
+    CommandLineWords(char** argv, int argc)
+        : argv_ { argv }
+        , size_ { argc }
+    {
+    }
+
+    explicit CommandLineWords(const std::vector<std::string_view>& words)
+        : words_ { words.data() }
+        , size_ { static_cast<int>(words.size()) }
+    {
+    }
+
+    [[nodiscard]] std::string_view operator[](int index) const
+    {
+        return argv_ != nullptr ? std::string_view { argv_[index] } : words_[static_cast<std::size_t>(index)];
+    }
+
+    [[nodiscard]] int size() const { return size_; }
+
+    /**
+     * @brief Find the word that a view into the command line is part of, e.g. the value of "--option=value"
+     * @return The index of the word or std::nullopt if the view is not into the command line
+     */
+    [[nodiscard]] std::optional<std::size_t> find(std::string_view text) const
+    {
+        const std::less<const char*> before {};
+        for (int i = 0; i < size_; ++i) {
+            const auto word = (*this)[i];
+            const auto* const end = word.data() + word.size();
+            // Only an empty view may start at the end of a word, e.g. the value of "--option="
+            const auto endsWithin = before(text.data(), end) || (text.empty() && text.data() == end);
+            if (!before(text.data(), word.data()) && endsWithin) {
+                return static_cast<std::size_t>(i);
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    char** argv_ {};
+    const std::string_view* words_ {};
+    int size_ {};
+};
+
+/**
+ * @brief Write the diagnostics of a parse to the standard error with a single write,
+ *        so that the diagnostics of parses in different threads do not interleave
+ */
+COMMAND_PARSER_INLINE void writeDiagnostics(std::string_view diagnostics);
+
+#if COMMAND_PARSER_DEFINITIONS
+COMMAND_PARSER_INLINE void writeDiagnostics(std::string_view diagnostics) { std::cerr << diagnostics << std::flush; }
+#endif
+} // namespace details
+
+template <typename T, typename Instrumentation = NoInstrumentation>
+class ParsedCommandImpl
+{
+public:
+    /**
+     * @brief Constructs a parsed command
+     * @param argc The argument count
+     * @param argv The argument values
+     * @param commands A tuple with the unparsed commands
+     * @warning Users should probably use the helper function `UnparsedCommand::parse`
+     */
+    ParsedCommandImpl(int argc, char* argv[], const T& commands)
+        : ParsedCommandImpl(argc, argv, commands, details::ParseContext<T> {})
+    {
+    }
+
+    /**
+     * @brief Constructs a parsed command where no command was parsed, e.g. to pre-size the results of a batch
+     */
+    ParsedCommandImpl() = default;
+
+    /**
+     * @brief Constructs a parsed command resolving environment fallbacks from the supplied environment
+     * @param argc The argument count
+     * @param argv The argument values
+     * @param commands A tuple with the unparsed commands
+     * @param environment The environment to resolve fallbacks from instead of the process environment
+     * @warning Users should probably use the helper function `UnparsedCommand::parse`
+     */
+    ParsedCommandImpl(int argc, char* argv[], const T& commands, const details::EnvironmentIndex& environment)
+        : ParsedCommandImpl(argc, argv, commands, details::ParseContext<T> { &environment })
+    {
+    }
+
+    /**
+     * @brief Constructs a parsed command reusing the help prompt and the command lookup of a precomputed table
+     * @param argc The argument count
+     * @param argv The argument values
+     * @param commands A tuple with the unparsed commands
+     * @param table The table computed from the same `commands`
+     * @warning Users should probably use the helper function `UnparsedCommand::parse`
+     */
+    ParsedCommandImpl(int argc, char* argv[], const T& commands, const details::CommandTable<T>& table)
+        : ParsedCommandImpl(argc, argv, commands, details::ParseContext<T> { nullptr, &table })
+    {
+    }
+
+    /**
+     * @brief Constructs a parsed command in the supplied context
+     * @param argc The argument count
+     * @param argv The argument values
+     * @param commands A tuple with the unparsed commands
+     * @param context The environment, precomputed table and command resolution to use
+     * @warning Users should probably use the helper functions `UnparsedCommand::parse`
+     *          and `UnparsedCommand::parseMultiCall`
+     */
+    ParsedCommandImpl(int argc, char* argv[], const T& commands, const details::ParseContext<T>& context)
+        : collectErrors_ { context.collectErrors }
+    {
+        details::ParseProbe<Instrumentation> probe {};
+        generateHelp(probe, commands, context.table);
+        // Only a multi-call parse looks at the program name, so the usual parse does not pay for it
+        const int commandPosition
+            = context.multiCall && argc > 0 && isCommand(argv[0], commands, context.table) ? 0 : 1;
+        if (argc <= commandPosition) {
+            diagnose("No command passed");
+            addError(ParseErrorKind::noCommand, static_cast<std::size_t>(commandPosition), "No command passed");
+        } else {
+            const std::string commandId { commandPosition == 0 ? details::programName(argv[0]) : argv[1] };
+            const details::CommandLineWords commandLine { argv, argc };
+            parseCommand(probe, commandId, commandPosition + 1, commandLine, commands, context);
+        }
+        reportDiagnostics();
+    }
+
+    /**
+     * @brief Constructs a parsed command from a command line that is already split into words,
+     *        e.g. by `UnparsedCommand::CommandLine`
+     * @param words The words, starting with the command ID (i.e. without the program name)
+     * @param commands A tuple with the unparsed commands
+     * @param context The environment and precomputed table to use
+     * @warning Users should probably use the helper function `UnparsedCommand::parseLine`
+     */
+    ParsedCommandImpl(
+        const std::vector<std::string_view>& words,
+        const T& commands,
+        const details::ParseContext<T>& context = {})
+        : collectErrors_ { context.collectErrors }
+    {
+        details::ParseProbe<Instrumentation> probe {};
+        generateHelp(probe, commands, context.table);
+        if (words.empty()) {
+            diagnose("No command passed");
+            addError(ParseErrorKind::noCommand, std::size_t { 0 }, "No command passed");
+        } else {
+            const details::CommandLineWords commandLine { words };
+            parseCommand(probe, std::string { words.front() }, 1, commandLine, commands, context);
+        }
+        reportDiagnostics();
+    }
+
+    /**
+     * @brief Check if the parsed command is the supplied (unparsed) command
+     * @tparam CommandType The unparsed command
+     * @param command
+     * @return Whether the parsed command matches the unparsed command
+     */
+    template <typename CommandType>
+    [[nodiscard]] bool is(const CommandType& command) const
+    {
+        static_assert(
+            details::typeInTuple<CommandType, T>::value,
+            "The specified command was not included in the tuple of commands passed when calling "
+            "UnparsedCommand::parse");
+        return command.id() == commandId_;
+    }
+
+    /**
+     * @brief Get the parsed arguments for the supplied command
+     *        Omitted optional arguments with a typed default get it, see `UnparsedCommandImpl::withArgDefault`
+     * @tparam CommandType The unparsed command
+     * @param command
+     * @return  A command-specific tuple with the parsed arguments
+     */
+    template <typename CommandType>
+    [[nodiscard]] auto getArgs(const CommandType& command) const
+    {
+        assert((is(command)) && "Command not found"); // NOLINT (cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+        using ArgumentsType = typename CommandType::ArgumentsType;
+        ArgumentsType argsToReturn {};
+        details::visitTuple(parsedArguments_, [&argsToReturn, &command, this, index = 0U](auto&& arg) mutable {
+            if (index == commandIndex_.value()) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, ArgumentsType>) {
+                    argsToReturn = arg;
+                    resolveTypedDefaults<ArgumentsType>(
+                        command, argsToReturn, std::make_index_sequence<std::tuple_size_v<ArgumentsType>> {});
+                }
+            }
+            ++index;
+        });
+
+        return argsToReturn;
+    }
+
+    /**
+     * @brief Get one parsed argument for the supplied command, so that only its typed default is computed if omitted
+     * @tparam Index The index of the argument
+     * @tparam CommandType The unparsed command
+     * @param command
+     * @return The parsed argument
+     */
+    template <std::size_t Index, typename CommandType>
+    [[nodiscard]] auto getArg(const CommandType& command) const
+    {
+        assert((is(command)) && "Command not found"); // NOLINT (cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+        using ArgumentsType = typename CommandType::ArgumentsType;
+        static_assert(Index < std::tuple_size_v<ArgumentsType>, "Argument index out of range");
+        std::tuple_element_t<Index, ArgumentsType> argToReturn {};
+        details::visitTuple(parsedArguments_, [&argToReturn, &command, this, index = 0U](auto&& arg) mutable {
+            if (index == commandIndex_.value()) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, ArgumentsType>) {
+                    argToReturn = std::get<Index>(arg);
+                    resolveTypedDefault<Index, ArgumentsType>(command, argToReturn);
+                }
+            }
+            ++index;
+        });
+
+        return argToReturn;
+    }
+
+    /**
+     * @brief Check if the supplied option was encountered for the parsed command
+     * @param option
+     * @return true if the option was encountered, false otherwise
+     */
+    [[nodiscard]] bool hasOption(std::string_view option) const { return optionOccurrences(option).count() > 0; }
+
+    /**
+     * @brief Get how often the supplied option was encountered, e.g. 3 for "-vvv" or "-v --v -v"
+     * @param option
+     * @return The number of occurrences, 1 for an option enabled through its environment variable or default
+     */
+    [[nodiscard]] std::size_t optionCount(std::string_view option) const { return optionOccurrences(option).count(); }
+
+    /**
+     * @brief Get where the supplied option was encountered, e.g. to tell the order of options that depend on it
+     * @param option
+     * @return The indices in the command line, i.e. in argv, or in the words for a command line split into words.
+     *         Options combined in one word (e.g. "-vx") share its index. Only the first
+     *         `details::OptionOccurrences::maxPositions` are kept
+     */
+    [[nodiscard]] const details::OptionOccurrences& optionPositions(std::string_view option) const
+    {
+        return optionOccurrences(option);
     }
 
     /**
@@ -624,127 +1376,712 @@ public:
      */
     [[nodiscard]] std::unordered_set<std::string> getUnknownOptions() const { return unknownOptions_; }
 
+    /**
+     * @brief Get the constraints between options the command line did not satisfy, in which case no command is parsed
+     * @return The unsatisfied constraints
+     */
+    [[nodiscard]] const std::vector<OptionViolation>& getOptionViolations() const { return optionViolations_; }
+
+    /**
+     * @brief Get every problem found in the command line, in which case no command is parsed
+     * @return The problems, which are only collected when parsing through `UnparsedCommand::validate`
+     */
+    [[nodiscard]] const std::vector<ParseError>& getErrors() const { return errors_; }
+
     /**
      * @brief Get the help prompt
+     *        It is built by every parse without a `details::CommandTable`, which parses that happen more than once
+     *        (e.g. in a server or a loop) should be given to build it once
      * @return The help prompt
      */
-    [[nodiscard]] std::string help() const { return helpPrompt_; }
+    [[nodiscard]] std::string help() const { return sharedHelpPrompt_ ? *sharedHelpPrompt_ : helpPrompt_; }
+
+    /**
+     * @brief Get the position of the parsed command in the tuple of commands
+     * @return The index of the parsed command or std::nullopt if no command was parsed
+     */
+    [[nodiscard]] std::optional<std::size_t> commandIndex() const { return commandIndex_; }
+
+    /**
+     * @brief Call the handler of the parsed command with its arguments, moved out of the parsed command
+     *        The handler is picked through a table indexed by the position of the command, so dispatching is a
+     *        single indirect call regardless of the number of commands
+     * @param fallback Called with the parsed command if no command was parsed
+     * @param handlers One handler per command, in the order of the tuple of commands. Each is called either with
+     *        the arguments of its command or, if it accepts it, with the parsed command followed by the arguments.
+     *        Omitted optional arguments with a typed default get it, as they do from `getArgs`
+     * @warning The tuple of commands the command was parsed with must still be alive, as it is when dispatching the
+     *          result of `UnparsedCommand::parse` right away
+     * @return What the called handler or fallback returned, converted to the return type of the fallback
+     */
+    template <typename Fallback, typename... Handlers>
+    decltype(auto) dispatch(Fallback&& fallback, Handlers&&... handlers) &&
+    {
+        static_assert(
+            sizeof...(Handlers) == std::tuple_size_v<T>,
+            "Exactly one handler per command must be supplied, in the order of the tuple of commands");
+        using Result = std::invoke_result_t<Fallback, const ParsedCommandImpl&>;
+        if (!commandIndex_) {
+            return static_cast<Result>(std::forward<Fallback>(fallback)(std::as_const(*this)));
+        }
+        auto handlerReferences = std::forward_as_tuple(std::forward<Handlers>(handlers)...);
+        using HandlerReferences = decltype(handlerReferences);
+        static constexpr auto jumpTable
+            = makeJumpTable<Result, HandlerReferences>(std::make_index_sequence<sizeof...(Handlers)> {});
+        return jumpTable[*commandIndex_](*this, handlerReferences);
+    }
 
 private:
     std::optional<std::size_t> commandIndex_ {};
     using ParsedArgumentsType = decltype(details::transformUnparsedArgumentsType(T {}));
+    // Typed defaults are resolved into a copy of the arguments whenever read, so reading never modifies them
     ParsedArgumentsType parsedArguments_ {};
+    // The typed defaults read so far, only allocated if the parsed command omitted an argument that has one. Shared
+    // by copies, which parsed the same command line, and type erased as its type depends on the parsed command
+    std::shared_ptr<void> resolvedDefaults_ {};
+    // For dispatch to find the typed defaults of the parsed command
+    const T* commands_ {};
     std::string commandId_ {};
+    // The help prompt of a precomputed table is shared rather than copied into every parsed command
+    std::shared_ptr<const std::string> sharedHelpPrompt_ {};
     std::string helpPrompt_ {};
-    std::unordered_set<std::string> parsedOptions_ {};
+    // The sorted options of the parsed command, shared with it, and what was recorded of each, at the same index
+    std::shared_ptr<const std::vector<std::string>> optionNames_ {};
+    std::vector<details::OptionOccurrences> parsedOptions_ {};
     std::unordered_set<std::string> unknownOptions_ {};
+    std::vector<OptionViolation> optionViolations_ {};
+    std::vector<ParseError> errors_ {};
+    // The command line while it is parsed, searched for where a problem is only once one is found
+    details::CommandLineWords commandLine_ {};
+    // What to write to the standard error, once the parse ends
+    std::string diagnostics_ {};
+    bool collectErrors_ {};
+    bool hasInvalidArgument_ {};
+
+    /// @brief Set an omitted optional argument with a typed default to it, which only the first read computes
+    template <std::size_t Index, typename ArgumentsType, typename CommandType, typename ArgumentType>
+    void
+    resolveTypedDefault([[maybe_unused]] const CommandType& command, [[maybe_unused]] ArgumentType& argument) const
+    {
+        if constexpr (details::isOptional<ArgumentType>::value) {
+            const auto& argumentDefault = command.template argTypedDefault<Index>();
+            // The slots are those of the parsed command, even if another command has the same argument types
+            if (argument || !argumentDefault || !resolvedDefaults_ || !is(command)) {
+                return;
+            }
+            using ResolvedDefaults = details::ResolvedDefaults<ArgumentsType>;
+            auto& slot = std::get<Index>(static_cast<ResolvedDefaults*>(resolvedDefaults_.get())->slots);
+            std::call_once(slot.once, [&slot, &argumentDefault] { slot.value = argumentDefault.get(); });
+            argument = slot.value;
+        }
+    }
+
+    /// @brief Set the omitted optional arguments with a typed default to it
+    template <typename ArgumentsType, typename CommandType, std::size_t... Indices>
+    void
+    resolveTypedDefaults(const CommandType& command, ArgumentsType& arguments, std::index_sequence<Indices...>) const
+    {
+        (resolveTypedDefault<Indices, ArgumentsType>(command, std::get<Indices>(arguments)), ...);
+    }
+
+    /// @brief Make room for the typed defaults of the parsed command if any is to be read
+    template <typename CommandType, typename ArgumentsType, std::size_t... Indices>
+    void reserveTypedDefaults(
+        [[maybe_unused]] const CommandType& command,
+        [[maybe_unused]] const ArgumentsType& arguments,
+        std::index_sequence<Indices...>)
+    {
+        [[maybe_unused]] const auto omitted = [](const auto& argument, const auto& argumentDefault) {
+            if constexpr (details::isOptional<std::decay_t<decltype(argument)>>::value) {
+                return !argument && static_cast<bool>(argumentDefault);
+            } else {
+                return false;
+            }
+        };
+        if ((omitted(std::get<Indices>(arguments), command.template argTypedDefault<Indices>()) || ...)) {
+            resolvedDefaults_ = std::make_shared<details::ResolvedDefaults<ArgumentsType>>();
+        }
+    }
+
+    const details::OptionOccurrences& optionOccurrences(std::string_view option) const
+    {
+        static const details::OptionOccurrences none {};
+        // Let's be forgiving if someone looks for "--option" instead of "option"
+        details::removeAllLeading(option, '-');
+        const auto index = optionNames_ ? details::findOptionIndex(*optionNames_, option) : std::nullopt;
+        return index && *index < parsedOptions_.size() ? parsedOptions_[*index] : none;
+    }
+
+    template <std::size_t Index, typename Result, typename HandlerReferences>
+    static Result invokeHandler(ParsedCommandImpl& parsedCommand, HandlerReferences& handlers)
+    {
+        auto& handler = std::get<Index>(handlers);
+        auto& commandArguments = std::get<Index>(parsedCommand.parsedArguments_);
+        using ArgumentsType = std::decay_t<decltype(commandArguments)>;
+        parsedCommand.template resolveTypedDefaults<ArgumentsType>(
+            std::get<Index>(*parsedCommand.commands_),
+            commandArguments,
+            std::make_index_sequence<std::tuple_size_v<ArgumentsType>> {});
+        return std::apply(
+            [&parsedCommand, &handler](auto&... arguments) -> Result {
+                using Handler = decltype(handler);
+                constexpr auto takesParsedCommand
+                    = std::is_invocable_v<Handler, const ParsedCommandImpl&, decltype(std::move(arguments))...>;
+                if constexpr (takesParsedCommand) {
+                    return handler(std::as_const(parsedCommand), std::move(arguments)...);
+                } else {
+                    return handler(std::move(arguments)...);
+                }
+            },
+            commandArguments);
+    }
+
+    template <typename Result, typename HandlerReferences, std::size_t... Indices>
+    static constexpr auto makeJumpTable(std::index_sequence<Indices...>)
+    {
+        using Entry = Result (*)(ParsedCommandImpl&, HandlerReferences&);
+        return std::array<Entry, sizeof...(Indices)> { &invokeHandler<Indices, Result, HandlerReferences>... };
+    }
+
+    void generateHelp(
+        details::ParseProbe<Instrumentation>& probe,
+        const T& commands,
+        const details::CommandTable<T>* table)
+    {
+        if (table != nullptr) {
+            sharedHelpPrompt_ = table->sharedHelp();
+            return;
+        }
+        helpPrompt_ = probe.measure(
+            ParsePhase::helpGeneration, [&commands] { return details::createHelpPrompt(commands); });
+    }
+
+    /// @brief Add a line to the diagnostics of the parse
+    template <typename... Parts>
+    void diagnose(const Parts&... parts)
+    {
+        (diagnostics_.append(parts), ...);
+        diagnostics_.push_back('\n');
+    }
+
+    void reportDiagnostics()
+    {
+        if (!diagnostics_.empty()) {
+            details::writeDiagnostics(diagnostics_);
+            diagnostics_ = {};
+        }
+    }
 
     /**
-     * @brief Create the help prompt by finding the longest command id and usage so the description is nicely aligned
-     * @param commands
+     * @brief Parse the words of the command line from firstArgument on for the supplied command ID
      */
-    std::string createHelpPrompt(const T& commands) const
+    void parseCommand(
+        details::ParseProbe<Instrumentation>& probe,
+        const std::string& commandId,
+        int firstArgument,
+        const details::CommandLineWords& commandLine,
+        const T& commands,
+        const details::ParseContext<T>& context)
     {
-        std::size_t longestCommandIdAndUsage { 0 };
-        details::visitTuple(commands, [&longestCommandIdAndUsage](auto&& command) {
-            constexpr std::size_t separatorSize { 1 };
-            const auto commandIdAndUsage = command.id().size() + command.usage().size() + separatorSize;
-            if (commandIdAndUsage > longestCommandIdAndUsage) {
-                longestCommandIdAndUsage = commandIdAndUsage;
-            }
-        });
+        const auto* const table = context.table;
+        const auto argumentCount = commandLine.size();
+        commandLine_ = commandLine;
+        commands_ = &commands;
+        // Arguments refer to the command line, which outlives the parse, so they are only copied once converted
+        std::vector<std::string_view> unparsedArgs {};
+        std::vector<details::UnparsedOption> unparsedOptions {};
+        probe.measure(
+            ParsePhase::tokenization,
+            [firstArgument, argumentCount, &commandLine, &unparsedArgs, &unparsedOptions] {
+                bool optionsEnded {};
+                for (int i = firstArgument; i < argumentCount; ++i) {
+                    const auto word = commandLine[i];
+                    const auto token = details::lexWord(word, optionsEnded);
+                    const auto position = static_cast<std::size_t>(i);
+                    switch (token.kind) {
+                    case details::TokenKind::endOfOptions:
+                        optionsEnded = true;
+                        break;
+                    case details::TokenKind::shortOptions:
+                    case details::TokenKind::longOption:
+                        unparsedOptions.push_back({ token.text(word), position });
+                        break;
+                    case details::TokenKind::longOptionWithValue:
+                        unparsedOptions.push_back({ token.text(word), position, token.value(word) });
+                        break;
+                    case details::TokenKind::argument:
+                        unparsedArgs.push_back(token.text(word));
+                        break;
+                    }
+                }
+            });
+        probe.count(ParseCounter::tokens, static_cast<std::size_t>(argumentCount - firstArgument + 1));
+        probe.count(ParseCounter::options, unparsedOptions.size());
+        probe.count(ParseCounter::arguments, unparsedArgs.size());
+
+        // Find if the commandId exists in the supplied commands
+        bool commandFound {};
+        probe.measure(
+            ParsePhase::commandLookup,
+            [&commands, &commandId, &commandFound, &unparsedArgs, argumentCount, table, this] {
+                const auto tableIndex = table != nullptr ? table->find(commandId) : std::nullopt;
+                const auto matches = [&commandId, &tableIndex, table](auto&& command, std::size_t index) {
+                    return table != nullptr ? tableIndex == index : command.matches(commandId);
+                };
+                details::visitTupleWithIndex(
+                    commands,
+                    [&commandId, &commandFound, &unparsedArgs, &matches, argumentCount, this](
+                        auto&& command, auto index) {
+                        if (commandFound || !matches(command, index)) {
+                            return;
+                        }
+                        commandFound = true;
+                        const auto expectedMaxNumberOfArguments = command.getMaxArgCount();
+                        const auto expectedMinNumberOfArguments = command.getRequiredArgCount();
+                        if (unparsedArgs.size() < expectedMinNumberOfArguments
+                            || unparsedArgs.size() > expectedMaxNumberOfArguments) {
+                            diagnose("Wrong number of arguments for command: ", commandId);
+                            diagnose(command.id(), " ", command.usage(), " ", command.description());
+                            const auto atLeastOrAtMost
+                                = unparsedArgs.size() < expectedMinNumberOfArguments ? "at least " : "at most ";
+                            std::string got { std::to_string(unparsedArgs.size()) + " instead: " };
+                            for (const auto& arg : unparsedArgs) {
+                                got.append("\"").append(arg).append("\" ");
+                            }
+                            diagnose("Expected ",
+                                     atLeastOrAtMost,
+                                     std::to_string(expectedMaxNumberOfArguments),
+                                     " arguments, got ",
+                                     got);
+                            if (collectErrors_) {
+                                // Missing arguments are reported past the last word, extra ones at the first of them
+                                const auto position = unparsedArgs.size() < expectedMinNumberOfArguments
+                                    ? std::optional { static_cast<std::size_t>(argumentCount) }
+                                    : argumentPosition(unparsedArgs[expectedMaxNumberOfArguments]);
+                                addError(ParseErrorKind::wrongArgumentCount,
+                                         position,
+                                         "Wrong number of arguments for command: " + commandId);
+                                // Go on with the command anyway, so that the options and arguments are checked too
+                                commandIndex_ = index;
+                            }
+                        } else {
+                            commandIndex_ = index;
+                            commandId_ = command.id();
+                        }
+                    });
+            });
+
+        if (!commandFound) {
+            diagnose("Unrecognized command: ", commandId);
+            addError(ParseErrorKind::unknownCommand,
+                     static_cast<std::size_t>(firstArgument - 1),
+                     "Unrecognized command: " + commandId);
+            return;
+        }
+
+        if (!commandIndex_) {
+            return;
+        }
 
-        std::stringstream helpPrompt {};
-        details::visitTuple(commands, [&helpPrompt, longestCommandIdAndUsage](auto&& command) {
-            helpPrompt << " " << command.id() << " " << command.usage()
-                       << std::string(longestCommandIdAndUsage - (command.id().size() + command.usage().size()), ' ')
-                       << command.description() << std::endl;
+        // The process environment is only indexed if a command actually falls back to it
+        const auto environment = [&context]() -> const details::EnvironmentIndex& {
+            return context.environment != nullptr ? *context.environment : details::EnvironmentIndex::process();
+        };
+        details::visitTupleWithIndex(
+            commands,
+            [&commandId, &unparsedArgs, &unparsedOptions, &environment, &probe, this](auto&& command, auto index) {
+                if (index != commandIndex_.value()) {
+                    return;
+                }
+                probe.measure(ParsePhase::optionMatching, [&command, &unparsedOptions, &environment, this] {
+                    matchOptions(command, unparsedOptions, environment);
+                    checkOptionConstraints(command);
+                });
+                probe.measure(ParsePhase::argumentConversion, [&command, &unparsedArgs, &environment, this] {
+                    auto& argumentsToParse = std::get<decltype(index)::value>(parsedArguments_);
+                    parseArguments(command, argumentsToParse, unparsedArgs, environment);
+                });
+                if (hasInvalidArgument_) {
+                    diagnose("Invalid arguments for command: ", commandId);
+                    diagnose(command.id(), " ", command.usage(), " ", command.description());
+                }
+                if (!optionViolations_.empty()) {
+                    diagnose("Invalid options for command: ", commandId);
+                    diagnose(command.id(), " ", command.usage(), " ", command.description());
+                }
+            });
+        // The command line may not outlive the parsed command
+        commandLine_ = {};
+        // An argument or option fallback could not be converted or the options are not allowed together,
+        // so the command is left unparsed
+        if (hasInvalidArgument_ || !optionViolations_.empty() || !errors_.empty()) {
+            commandIndex_.reset();
+            commandId_.clear();
+            return;
+        }
+        details::visitTupleWithIndex(commands, [this](auto&& command, auto index) {
+            if (index == commandIndex_.value()) {
+                const auto& arguments = std::get<decltype(index)::value>(parsedArguments_);
+                using ArgumentsType = std::decay_t<decltype(arguments)>;
+                reserveTypedDefaults(
+                    command, arguments, std::make_index_sequence<std::tuple_size_v<ArgumentsType>> {});
+            }
         });
+    }
 
-        return helpPrompt.str();
+    static bool isCommand(std::string_view programPath, const T& commands, const details::CommandTable<T>* table)
+    {
+        const std::string name { details::programName(programPath) };
+        if (table != nullptr) {
+            return table->find(name).has_value();
+        }
+        bool found {};
+        details::visitTuple(commands, [&name, &found](auto&& command) { found = found || command.matches(name); });
+        return found;
     }
 
-    template <typename ArgumentType>
-    void parseArgument(ArgumentType& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    template <typename CommandType, typename EnvironmentGetter>
+    void matchOptions(
+        const CommandType& command,
+        const std::vector<details::UnparsedOption>& unparsedOptions,
+        const EnvironmentGetter& environment)
     {
-        argToSet = unparsedArgs[index];
+        const auto& shortOptions = command.shortOptions();
+        // One record per option of the command, so that recording and looking up an option is indexing
+        optionNames_ = command.sortedOptions();
+        parsedOptions_.assign(optionNames_ ? optionNames_->size() : 0, {});
+        for (const auto& [unparsedOption, position, value] : unparsedOptions) {
+            // Match stand-alone options, through the sorted options as those take a view
+            if (const auto index = command.optionIndex(unparsedOption)) {
+                // An attached value enables the option only if true, as the value of a fallback does
+                bool enabled { true };
+                if (value) {
+                    parseArgument(enabled, *value);
+                }
+                if (enabled) {
+                    parsedOptions_[*index].add(position);
+                }
+            } else { // Match compound options (e.g. -abc instead of -a -b -c)
+                const auto allCharactersAreShortOptions
+                    = std::all_of(unparsedOption.begin(), unparsedOption.end(), [&shortOptions](auto c) {
+                          return shortOptions.find(std::string { c }) != shortOptions.end();
+                      });
+                if (allCharactersAreShortOptions) {
+                    for (const auto& c : unparsedOption) {
+                        parsedOptions_[command.optionIndex(std::string_view { &c, 1 }).value_or(0)].add(position);
+                    }
+                } else {
+                    unknownOptions_.emplace(unparsedOption);
+                    if (collectErrors_) {
+                        addError(ParseErrorKind::unknownOption,
+                                 position,
+                                 std::string { "Unknown option: " }.append(unparsedOption));
+                    }
+                }
+            }
+        }
+        // Options not supplied in the command line may still be enabled through the environment or their default,
+        // while supplying one with a false value, e.g. `--force=no`, overrides them
+        const auto resolveFallback = [&command, &unparsedOptions, &environment, this](const std::string& option) {
+            const auto supplied = [&option](const details::UnparsedOption& unparsedOption) {
+                return unparsedOption.name == option;
+            };
+            const auto index = command.optionIndex(option);
+            if (!index || parsedOptions_[*index].count() > 0
+                || std::any_of(unparsedOptions.begin(), unparsedOptions.end(), supplied)) {
+                return;
+            }
+            if (const auto value = optionFallback(command, option, environment)) {
+                const auto enabled = details::booleanKeywords.find(*value);
+                if (!enabled) {
+                    // Reported rather than taken as false, as the variable is more likely mistyped than meant so
+                    invalidArgument(*value, ", the fallback of option \"" + option + "\" is not a boolean");
+                } else if (*enabled) {
+                    parsedOptions_[*index].add();
+                }
+            }
+        };
+        for (const auto& optionAndVariable : command.optionEnvironment()) {
+            resolveFallback(optionAndVariable.first);
+        }
+        for (const auto& optionAndDefault : command.optionDefaults()) {
+            resolveFallback(optionAndDefault.first);
+        }
     }
 
-    void parseArgument(int& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    /// @brief Check the constraints between options against the bits of the parsed options, once all are known
+    template <typename CommandType>
+    void checkOptionConstraints(const CommandType& command)
     {
-        argToSet = std::stoi(unparsedArgs[index]);
+        const auto& constraints = command.optionConstraints();
+        if (constraints.empty()) {
+            return;
+        }
+        if (!command.optionConstraintsSupported()) {
+            // The constraints cannot be checked, so none of them counts as satisfied
+            for (const auto& constraint : constraints) {
+                optionViolations_.push_back({ constraint.constraint, constraint.options });
+            }
+            std::string message { "Options can only be constrained in commands with at most " };
+            message.append(std::to_string(details::maxConstrainedOptions)).append(" options");
+            diagnose(message);
+            addError(ParseErrorKind::unsatisfiedOptionConstraint, std::nullopt, std::move(message));
+            return;
+        }
+        details::OptionMask parsedOptions {};
+        const auto maskedOptions = std::min(parsedOptions_.size(), details::maxConstrainedOptions);
+        for (std::size_t index = 0; index < maskedOptions; ++index) {
+            if (parsedOptions_[index].count() > 0) {
+                parsedOptions |= details::OptionMask { 1 } << index;
+            }
+        }
+        for (const auto& constraint : constraints) {
+            if (constraint.isSatisfiedBy(parsedOptions)) {
+                continue;
+            }
+            optionViolations_.push_back({ constraint.constraint, constraint.options });
+            std::string options {};
+            for (const auto& option : constraint.options) {
+                options.append(options.empty() ? "" : " ").append(option.size() == 1 ? "-" : "--").append(option);
+            }
+            std::string message {};
+            switch (constraint.constraint) {
+            case OptionConstraint::conflicting:
+                message = "Options cannot be used together: ";
+                break;
+            case OptionConstraint::requiring:
+                message = "Option requires the ones following it: ";
+                break;
+            case OptionConstraint::exactlyOne:
+                message = "Exactly one option is required of: ";
+                break;
+            case OptionConstraint::atLeastOne:
+                message = "At least one option is required of: ";
+                break;
+            }
+            message.append(options);
+            diagnose(message);
+            addError(ParseErrorKind::unsatisfiedOptionConstraint, std::nullopt, std::move(message));
+        }
     }
 
-    void parseArgument(long& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    /**
+     * @brief Get the value of an option not supplied in the command line, i.e. its environment variable if set,
+     *        otherwise its default
+     */
+    template <typename CommandType, typename EnvironmentGetter>
+    static std::optional<std::string_view>
+    optionFallback(const CommandType& command, const std::string& option, const EnvironmentGetter& environment)
     {
-        argToSet = std::stol(unparsedArgs[index]);
+        const auto variable = command.optionEnvironment().find(option);
+        if (variable != command.optionEnvironment().end()) {
+            if (const auto value = environment().find(variable->second)) {
+                return value;
+            }
+        }
+        const auto defaultValue = command.optionDefaults().find(option);
+        if (defaultValue != command.optionDefaults().end()) {
+            return defaultValue->second;
+        }
+        return std::nullopt;
     }
 
-    void parseArgument(long long& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    /**
+     * @brief Get the value of an argument not supplied in the command line, i.e. its environment variable if set,
+     *        otherwise its default
+     */
+    template <typename CommandType, typename EnvironmentGetter>
+    static std::optional<std::string_view>
+    argFallback(const CommandType& command, std::size_t index, const EnvironmentGetter& environment)
     {
-        argToSet = std::stoll(unparsedArgs[index]);
+        if (const auto variable = command.argEnvironment(index)) {
+            if (const auto value = environment().find(*variable)) {
+                return value;
+            }
+        }
+        return command.argDefault(index);
     }
 
-    void parseArgument(unsigned long& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    template <typename CommandType, typename ArgumentsType, typename EnvironmentGetter>
+    void parseArguments(
+        const CommandType& command,
+        ArgumentsType& argumentsToParse,
+        const std::vector<std::string_view>& unparsedArgs,
+        const EnvironmentGetter& environment)
     {
-        argToSet = std::stoul(unparsedArgs[index]);
+        details::visitTupleWithIndex(
+            argumentsToParse,
+            [&command, &unparsedArgs, &environment, this, parsedArgumentIndex = 0U](
+                auto&& arg, auto argumentIndex) mutable {
+                if (parsedArgumentIndex >= unparsedArgs.size()) {
+                    // We end up here when we are out of unparsed arguments. This can happen when:
+                    // We expected an optional argument that was not passed by the user in which case we
+                    // want to leave the argument in the error state that it is, i.e. nullopt, unless it
+                    // falls back to an environment variable that is set or to a default value
+                    if constexpr (details::isOptional<std::decay_t<decltype(arg)>>::value) {
+                        if (const auto value = argFallback(command, argumentIndex, environment)) {
+                            this->parseArgument(arg, *value);
+                        }
+                    }
+                    return;
+                }
+                this->parseArgument(arg, unparsedArgs, parsedArgumentIndex);
+                ++parsedArgumentIndex;
+            });
     }
 
+    template <typename ArgumentType>
     void
-    parseArgument(unsigned long long& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    parseArgument(ArgumentType& argToSet, const std::vector<std::string_view>& unparsedArgs, unsigned int& index)
+    {
+        parseArgument(argToSet, unparsedArgs[index]);
+    }
+
+    /**
+     * @brief Convert an argument to a custom type, through its `parseValue` overload if it has one,
+     *        otherwise through its constructor taking an `std::string`
+     */
+    template <typename ArgumentType>
+    void parseArgument(ArgumentType& argToSet, std::string_view unparsedArg)
+    {
+        if constexpr (details::hasParseValue<ArgumentType>::value) {
+            const auto error = parseValue(unparsedArg, argToSet);
+            if (error != std::errc {}) {
+                invalidArgument(unparsedArg, ": " + std::make_error_code(error).message());
+            }
+        } else if constexpr (details::hasArgumentKeywords<ArgumentType>::value) {
+            static constexpr details::KeywordTable keywords { argumentKeywords(ArgumentType {}) };
+            static_assert(keywords.isPerfect(), "Argument keywords must be unique ignoring case");
+            parseKeyword(argToSet, unparsedArg, keywords);
+        } else {
+            argToSet = std::string { unparsedArg };
+        }
+    }
+
+    void parseArgument(std::string& argToSet, std::string_view unparsedArg) { argToSet = unparsedArg; }
+
+    void parseArgument(int& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    void parseArgument(long& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    void parseArgument(long long& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    void parseArgument(unsigned long& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    void parseArgument(unsigned long long& argToSet, std::string_view unparsedArg)
     {
-        argToSet = std::stoull(unparsedArgs[index]);
+        parseNumber(argToSet, unparsedArg);
     }
 
-    void parseArgument(float& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    void parseArgument(float& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    void parseArgument(double& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    void parseArgument(long double& argToSet, std::string_view unparsedArg) { parseNumber(argToSet, unparsedArg); }
+
+    /**
+     * @brief Convert the whole argument to a number, so that every parse accepts the same numbers (e.g. "12abc" is
+     *        never 12). An invalid number is one more problem to collect while collecting errors, otherwise it ends
+     *        the parse as the `std::sto*` functions do: with `std::invalid_argument` or `std::out_of_range`, or by
+     *        aborting without exceptions
+     */
+    template <typename Number>
+    void parseNumber(Number& argToSet, std::string_view unparsedArg)
     {
-        argToSet = std::stof(unparsedArgs[index]);
+        const auto error = details::convertNumber(unparsedArg, argToSet);
+        if (error == std::errc {}) {
+            return;
+        }
+        if (!collectErrors_) {
+#if __cpp_exceptions
+            const std::string message { "Invalid argument \"" + std::string { unparsedArg } + "\"" };
+            if (error == std::errc::result_out_of_range) {
+                throw std::out_of_range { message };
+            }
+            throw std::invalid_argument { message };
+#else
+            std::abort();
+#endif
+        }
+        invalidArgument(unparsedArg, ": " + std::make_error_code(error).message());
     }
 
-    void parseArgument(double& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    void parseArgument(bool& argToSet, std::string_view unparsedArg)
     {
-        argToSet = std::stod(unparsedArgs[index]);
+        parseKeyword(argToSet, unparsedArg, details::booleanKeywords);
     }
 
-    void parseArgument(long double& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    template <typename E, std::size_t Count>
+    void parseKeyword(E& argToSet, std::string_view unparsedArg, const details::KeywordTable<E, Count>& keywords)
     {
-        argToSet = std::stold(unparsedArgs[index]);
+        if (const auto value = keywords.find(unparsedArg)) {
+            argToSet = *value;
+            return;
+        }
+        std::string reason { ", expected one of:" };
+        for (const auto& keyword : keywords.keywords()) {
+            reason.append(" ").append(keyword.first);
+        }
+        invalidArgument(unparsedArg, reason);
     }
 
-    void parseArgument(bool& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    void invalidArgument(std::string_view unparsedArg, const std::string& reason)
     {
-        for (const auto& trueValue : { "true", "yes", "1", "on" }) {
-            const auto argumentIsTrueIgnoringCase
-                = std::equal(unparsedArgs[index].begin(), unparsedArgs[index].end(), trueValue, [](auto a, auto b) {
-                      return std::tolower(a) == std::tolower(b);
-                  });
-            if (argumentIsTrueIgnoringCase) {
-                argToSet = true;
-                return;
-            }
+        diagnose("Invalid argument \"", unparsedArg, "\"", reason);
+        hasInvalidArgument_ = true;
+        if (!collectErrors_) {
+            return;
+        }
+        addError(ParseErrorKind::invalidArgument,
+                 argumentPosition(unparsedArg),
+                 "Invalid argument \"" + std::string { unparsedArg } + "\"" + reason);
+    }
+
+    /**
+     * @brief Find where an argument or option value is in the command line, while collecting errors
+     * @return Its position or std::nullopt if it is not in the command line, e.g. a fallback value
+     */
+    [[nodiscard]] std::optional<std::size_t> argumentPosition(std::string_view argument) const
+    {
+        return commandLine_.find(argument);
+    }
+
+    void addError(ParseErrorKind kind, std::optional<std::size_t> position, std::string message)
+    {
+        if (collectErrors_) {
+            errors_.push_back({ kind, position, std::move(message) });
         }
     }
 
     template <typename E>
-    void parseArgument(std::vector<E>& argToSet, const std::vector<std::string>& unparsedArgs, unsigned int& index)
+    void
+    parseArgument(std::vector<E>& argToSet, const std::vector<std::string_view>& unparsedArgs, unsigned int& index)
     {
         while (index < unparsedArgs.size()) {
             E element {};
-            parseArgument(element, unparsedArgs, index);
-            argToSet.emplace_back(element);
+            parseArgument(element, unparsedArgs[index]);
+            argToSet.emplace_back(std::move(element));
             ++index;
         }
     }
+
     template <typename E>
-    void
-    parseArgument(std::optional<E>& argToSet, const std::vector<std::string>& unparsedArgs, const unsigned int& index)
+    void parseArgument(std::optional<E>& argToSet, std::string_view unparsedArg)
     {
         E element {};
-        parseArgument(element, unparsedArgs, index);
-        argToSet = element;
+        parseArgument(element, unparsedArg);
+        argToSet = std::move(element);
     }
 };
 
+#ifdef COMMAND_PARSER_SEPARATE_COMPILATION
+// The containers every parse uses whatever the commands are, instantiated once in src/CommandParser.cpp
+extern template class std::vector<details::UnparsedOption>;
+extern template class std::vector<details::OptionOccurrences>;
+extern template class std::vector<OptionViolation>;
+extern template class std::vector<ParseError>;
+#endif
+
 namespace UnparsedCommand {
 /**
  * @brief Helper function to create an unparsed command
@@ -760,15 +2097,127 @@ namespace UnparsedCommand {
 
 /**
  * @brief Helper function to parse a command given the supplied CLI arguments and a list of available commands
+ * @tparam Instrumentation An optional policy the time spent in each parsing phase is reported to,
+ *         e.g. `UnparsedCommand::parse<MyPolicy>(argc, argv, commands)`, see `NoInstrumentation`
+ * @tparam T A tuple with the available unparsed commands
+ * @param argc The number of CLI arguments
+ * @param argv The CLI arguments
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @return A parsed command, with the help prompt built for it. Programs parsing more than once should build it once
+ *         with a `details::CommandTable`, see the overload taking one. An argument that is not entirely a number
+ *         (e.g. "12abc") where one is expected throws `std::invalid_argument`, or aborts without exceptions
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation> parse(int argc, char* argv[], const T& unparsedCommands)
+{
+    return ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands };
+}
+
+/**
+ * @brief Helper function to parse a command resolving environment fallbacks from the supplied environment
+ * @tparam Instrumentation An optional instrumentation policy, see `NoInstrumentation`
  * @tparam T A tuple with the available unparsed commands
  * @param argc The number of CLI arguments
  * @param argv The CLI arguments
  * @param unparsedCommands A tuple with the available unparsed commands
+ * @param environment The environment to use instead of the process environment, e.g. one filtered by a prefix
  * @return A parsed command
  */
-template <typename T>
-[[nodiscard]] ParsedCommandImpl<T> parse(int argc, char* argv[], const T& unparsedCommands)
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation>
+parse(int argc, char* argv[], const T& unparsedCommands, const details::EnvironmentIndex& environment)
+{
+    return ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands, environment };
+}
+
+/**
+ * @brief Helper function to parse a command reusing a precomputed table of the commands,
+ *        e.g. `const details::CommandTable table { commands };` built once and shared by many parses
+ * @tparam Instrumentation An optional instrumentation policy, see `NoInstrumentation`
+ * @tparam T A tuple with the available unparsed commands
+ * @param argc The number of CLI arguments
+ * @param argv The CLI arguments
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @param table The table computed from `unparsedCommands`
+ * @return A parsed command
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation>
+parse(int argc, char* argv[], const T& unparsedCommands, const details::CommandTable<T>& table)
+{
+    return ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands, table };
+}
+
+/**
+ * @brief Helper function to parse a command named either by the program name or by the first CLI argument, so that
+ *        one binary can serve many commands through symlinks (e.g. `/usr/bin/add -> tool` makes `add 1 2` the same
+ *        as `tool add 1 2`). The program name, i.e. `basename(argv[0])`, takes precedence if it is a command ID or
+ *        alias, otherwise the command is parsed as usual
+ * @tparam Instrumentation An optional instrumentation policy, see `NoInstrumentation`
+ * @tparam T A tuple with the available unparsed commands
+ * @param argc The number of CLI arguments
+ * @param argv The CLI arguments
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @return A parsed command
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation> parseMultiCall(int argc, char* argv[], const T& unparsedCommands)
+{
+    const details::ParseContext<T> context { nullptr, nullptr, true };
+    return ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands, context };
+}
+
+/**
+ * @brief Helper function to parse a command named either by the program name or by the first CLI argument,
+ *        reusing a precomputed table of the commands for both lookups, see `parseMultiCall`
+ * @tparam Instrumentation An optional instrumentation policy, see `NoInstrumentation`
+ * @tparam T A tuple with the available unparsed commands
+ * @param argc The number of CLI arguments
+ * @param argv The CLI arguments
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @param table The table computed from `unparsedCommands`
+ * @return A parsed command
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation>
+parseMultiCall(int argc, char* argv[], const T& unparsedCommands, const details::CommandTable<T>& table)
+{
+    const details::ParseContext<T> context { nullptr, &table, true };
+    return ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands, context };
+}
+
+/**
+ * @brief Helper function to parse a command going on after a problem, so that every problem of the command line is
+ *        reported at once, e.g. to lint scripts or to underline them in an editor. An unknown command still stops the
+ *        parse, but wrong numbers of arguments, unknown options, invalid arguments and unsatisfied option
+ *        constraints are all collected, see `ParsedCommandImpl::getErrors`. Numbers are converted as by `parse`,
+ *        i.e. the whole argument must be a number, but an invalid one is collected instead of thrown
+ * @tparam Instrumentation An optional instrumentation policy, see `NoInstrumentation`
+ * @tparam T A tuple with the available unparsed commands
+ * @param argc The number of CLI arguments
+ * @param argv The CLI arguments
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @return A parsed command, parsed only if there are no errors
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation> validate(int argc, char* argv[], const T& unparsedCommands)
+{
+    const details::ParseContext<T> context { nullptr, nullptr, false, true };
+    return ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands, context };
+}
+
+/**
+ * @brief Helper function to call the handler of the parsed command with its typed arguments, instead of a chain of
+ *        `is` and `getArgs` calls, e.g. `dispatch(parse(argc, argv, std::tuple { add, list }), onHelp, onAdd, onList)`
+ * @param parsedCommand The parsed command, whose arguments are moved to the handler
+ * @param fallback Called with the parsed command if no command was parsed
+ * @param handlers One handler per command, in the order of the tuple of commands, see `ParsedCommandImpl::dispatch`
+ * @return What the called handler or fallback returned
+ */
+template <typename T, typename Instrumentation, typename Fallback, typename... Handlers>
+decltype(auto)
+dispatch(ParsedCommandImpl<T, Instrumentation>&& parsedCommand, Fallback&& fallback, Handlers&&... handlers)
 {
-    return ParsedCommandImpl<T> { argc, argv, unparsedCommands };
+    return std::move(parsedCommand).dispatch(std::forward<Fallback>(fallback), std::forward<Handlers>(handlers)...);
 }
 } // namespace UnparsedCommand
@@ -0,0 +1,361 @@
+#pragma once
+
+#include "CommandParserFrame.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace UnparsedCommand {
+/// @brief What recording does when the audit log cannot keep up with the parses
+enum class BackPressure {
+    drop, ///< Drop the record and count it, so that parsing never waits
+    block, ///< Wait until the writer makes room, so that no record is lost
+};
+
+struct AuditOptions {
+    /// @brief The number of records waiting to be written, rounded up to a power of two
+    std::size_t capacity { 1024 };
+    BackPressure backPressure { BackPressure::drop };
+    /// @brief How long the writer waits for more records before writing, i.e. the group commit window
+    std::chrono::milliseconds flushInterval { 5 };
+    /// @brief Whether every written batch is also synced to the storage device
+    bool sync { true };
+};
+} // namespace UnparsedCommand
+
+namespace details {
+/**
+ * @brief A bounded lock-free queue of records for many producers, after Dmitry Vyukov's bounded MPMC queue
+ *        Records are swapped in and out rather than copied, so that their buffers are reused once warmed up
+ */
+class RecordRing
+{
+public:
+    explicit RecordRing(std::size_t capacity)
+        : cells_(nextPowerOfTwo(std::max<std::size_t>(capacity, 2)))
+        , mask_ { cells_.size() - 1 }
+    {
+        for (std::size_t i = 0; i < cells_.size(); ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Enqueue a record, leaving a buffer to reuse in its place
+     * @return Whether there was room for the record
+     */
+    bool tryPush(std::string& record)
+    {
+        auto position = enqueuePosition_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = cells_[position & mask_];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.record.swap(record);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (sequence < position) {
+                return false;
+            } else {
+                position = enqueuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Dequeue a record, leaving the supplied buffer to be reused by a producer
+     * @return Whether there was a record
+     */
+    bool tryPop(std::string& record)
+    {
+        auto position = dequeuePosition_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = cells_[position & mask_];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            if (sequence == position + 1) {
+                if (dequeuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.record.swap(record);
+                    cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (sequence < position + 1) {
+                return false;
+            } else {
+                position = dequeuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence {};
+        std::string record {};
+    };
+
+    std::vector<Cell> cells_;
+    std::size_t mask_ {};
+    // Own cache lines, so that producers and the consumer do not slow each other down
+    alignas(64) std::atomic<std::size_t> enqueuePosition_ {};
+    alignas(64) std::atomic<std::size_t> dequeuePosition_ {};
+};
+
+/**
+ * @brief Write the whole buffer to a file, retrying on interruptions
+ * @return Whether everything was written
+ */
+inline bool writeAll(int file, std::string_view bytes)
+{
+    while (!bytes.empty()) {
+        const auto written = ::write(file, bytes.data(), bytes.size());
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+constexpr std::size_t auditTimestampSize { sizeof(std::uint64_t) };
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief An append-only log of the parsed commands, e.g. for compliance. Recording serializes the command into a
+ *        lock-free ring (see `serialize`) and a background thread writes the records in batches, so that parsing
+ *        does not wait for the file unless the ring is full and the back pressure is `BackPressure::block`
+ *
+ * Each record is the time it was recorded, as nanoseconds since the epoch in a little-endian u64, followed by the
+ * frame of the command, see `forEachAuditRecord`.
+ * @tparam T A tuple with the unparsed commands
+ * @warning The commands must outlive the log
+ */
+template <typename T>
+class AuditLog
+{
+public:
+    explicit AuditLog(const T& unparsedCommands, AuditOptions options = {})
+        : commands_ { &unparsedCommands }
+        , options_ { options }
+        , ring_ { options.capacity }
+    {
+    }
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+    AuditLog(AuditLog&&) = delete;
+    AuditLog& operator=(AuditLog&&) = delete;
+    ~AuditLog() { stop(); }
+
+    /**
+     * @brief Start appending records to a file
+     * @param path The file, created if it does not exist
+     * @return Whether the file could be opened, errors are printed to stderr
+     */
+    bool start(const std::string& path)
+    {
+        if (writer_.joinable()) {
+            std::cerr << "Audit log already started" << std::endl;
+            return false;
+        }
+        constexpr mode_t permissions { 0640 };
+        file_ = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, permissions);
+        if (file_ < 0) {
+            std::cerr << "Cannot open audit log " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        stopping_ = false;
+        running_ = true;
+        writer_ = std::thread { [this] { write(); } };
+        return true;
+    }
+
+    /**
+     * @brief Write the remaining records and close the file
+     *        A record made while stopping is either written or reported as not recorded
+     */
+    void stop()
+    {
+        if (!writer_.joinable()) {
+            return;
+        }
+        running_ = false;
+        // A recording that saw the log running may still be pushing, so the writer only drains the ring after it
+        while (recorders_.load() > 0) {
+            std::this_thread::yield();
+        }
+        {
+            const std::lock_guard<std::mutex> lock { wakeUpMutex_ };
+            stopping_ = true;
+        }
+        wakeUp_.notify_one();
+        writer_.join();
+        ::close(file_);
+        file_ = -1;
+    }
+
+    /**
+     * @brief Record a parsed command
+     * @return Whether the command was recorded, i.e. the log is started and the record was not dropped
+     */
+    template <typename Instrumentation>
+    bool record(const ParsedCommandImpl<T, Instrumentation>& parsedCommand)
+    {
+        // Announced before looking at `running_`, so that `stop` waits for the push if it is not seen stopping
+        recorders_.fetch_add(1);
+        const auto recorded = running_.load() && push(parsedCommand);
+        recorders_.fetch_sub(1);
+        return recorded;
+    }
+
+    /// @brief Wait until every record recorded so far is written or failed to be, woken up by the writer after each
+    ///        batch rather than polling
+    void flush() const
+    {
+        const auto recorded = recorded_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock { flushedMutex_ };
+        // Every recorded record is in a batch by the time the writer stops, so this never waits for a stopped log
+        flushed_.wait(lock, [this, recorded] {
+            return written_.load(std::memory_order_acquire) + failed_.load(std::memory_order_acquire) >= recorded;
+        });
+    }
+
+    /// @brief Get the number of records dropped because of back pressure
+    [[nodiscard]] std::size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /// @brief Get the number of records that could not be written or synced, which are left out of the file
+    [[nodiscard]] std::size_t failed() const { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    const T* commands_ {};
+    AuditOptions options_ {};
+    details::RecordRing ring_;
+    int file_ { -1 };
+    std::atomic<bool> running_ {};
+    std::atomic<std::size_t> recorders_ {};
+    std::atomic<std::size_t> recorded_ {};
+    std::atomic<std::size_t> written_ {};
+    std::atomic<std::size_t> failed_ {};
+    std::atomic<std::size_t> dropped_ {};
+    std::mutex wakeUpMutex_ {};
+    bool stopping_ {};
+    std::condition_variable wakeUp_ {};
+    mutable std::mutex flushedMutex_ {};
+    mutable std::condition_variable flushed_ {};
+    std::thread writer_ {};
+
+    template <typename Instrumentation>
+    bool push(const ParsedCommandImpl<T, Instrumentation>& parsedCommand)
+    {
+        // Reused by every record of this thread, swapped with a buffer already drained by the writer
+        thread_local std::string record {};
+        record.clear();
+        const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        details::FrameWriter { record }.writeInteger(timestamp.count(), details::auditTimestampSize);
+        serialize(parsedCommand, *commands_, record);
+        while (!ring_.tryPush(record)) {
+            if (options_.backPressure == BackPressure::drop || !running_) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        recorded_.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Drain the ring into one batch per flush interval, so that many records share a write and a sync
+    void write()
+    {
+        std::string batch {};
+        std::string record {};
+        bool stopping {};
+        while (!stopping) {
+            {
+                std::unique_lock<std::mutex> lock { wakeUpMutex_ };
+                wakeUp_.wait_for(lock, options_.flushInterval, [this] { return stopping_; });
+                stopping = stopping_;
+            }
+            std::size_t records {};
+            batch.clear();
+            while (ring_.tryPop(record)) {
+                batch.append(record);
+                ++records;
+            }
+            if (records == 0) {
+                continue;
+            }
+            const auto written = writeBatch(batch);
+            {
+                // Counted under the lock, so that a flush checking the counts cannot miss the notification
+                const std::lock_guard<std::mutex> lock { flushedMutex_ };
+                (written ? written_ : failed_).fetch_add(records, std::memory_order_release);
+            }
+            flushed_.notify_all();
+        }
+    }
+
+    /// @brief Write and sync a batch, or truncate what was written of it so that no torn record is left behind
+    bool writeBatch(std::string_view batch)
+    {
+        // Taken before every batch, as another process may append to the file too
+        const auto end = ::lseek(file_, 0, SEEK_END);
+        if (details::writeAll(file_, batch) && (!options_.sync || ::fdatasync(file_) == 0)) {
+            return true;
+        }
+        std::cerr << "Cannot write audit log: " << std::strerror(errno) << std::endl;
+        if (end >= 0 && ::ftruncate(file_, end) != 0) {
+            std::cerr << "Cannot truncate audit log: " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Helper function to parse a command and record it in an audit log
+ * @return A parsed command
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation>
+parse(int argc, char* argv[], const T& unparsedCommands, AuditLog<T>& auditLog)
+{
+    auto parsedCommand = ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands };
+    auditLog.record(parsedCommand);
+    return parsedCommand;
+}
+
+/**
+ * @brief Call `function(timestamp, frame)` for every record of an audit log, e.g. read from its file
+ * @param log The contents of the log
+ * @param function Called with the time of the record as nanoseconds since the epoch and its frame,
+ *        see `CommandFrame`
+ * @return Whether the whole log was made of complete records
+ */
+template <typename Function>
+bool forEachAuditRecord(std::string_view log, const Function& function)
+{
+    while (!log.empty()) {
+        details::FrameReader reader { log };
+        const auto timestamp = reader.readInteger(details::auditTimestampSize);
+        const auto size = frameSize(log.substr(std::min(details::auditTimestampSize, log.size())));
+        if (!reader.ok() || !size || *size > log.size() - details::auditTimestampSize) {
+            return false;
+        }
+        function(timestamp, log.substr(details::auditTimestampSize, *size));
+        log.remove_prefix(details::auditTimestampSize + *size);
+    }
+    return true;
+}
+} // namespace UnparsedCommand
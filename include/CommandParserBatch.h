@@ -0,0 +1,212 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+
+namespace UnparsedCommand {
+/**
+ * @brief A command line that is already laid out as `argc` and `argv`, e.g. pointing into a memory-mapped log
+ */
+struct ArgvView {
+    int argc {};
+    char** argv {};
+};
+} // namespace UnparsedCommand
+
+namespace details {
+/**
+ * @brief A range of indices owned by one worker, which the owner pops from the front and idle workers steal half of
+ *        from the back. Both bounds live in a single atomic, so popping and stealing never hand out an index twice
+ */
+class StealableRange
+{
+public:
+    void assign(std::uint32_t begin, std::uint32_t end) { range_.store(pack(begin, end)); }
+
+    /**
+     * @brief Take up to `chunk` indices from the front
+     * @return Whether any indices were taken, i.e. `begin < end`
+     */
+    bool pop(std::uint32_t chunk, std::uint32_t& begin, std::uint32_t& end)
+    {
+        auto range = range_.load();
+        while (first(range) < last(range)) {
+            // Computed in 64 bits, so that a range ending at the largest index does not overflow
+            const auto taken = std::min(std::uint64_t { first(range) } + chunk, std::uint64_t { last(range) });
+            if (range_.compare_exchange_weak(range, pack(static_cast<std::uint32_t>(taken), last(range)))) {
+                begin = first(range);
+                end = static_cast<std::uint32_t>(taken);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Take the back half of the remaining indices, or the last one
+     * @return Whether any indices were taken, i.e. `begin < end`
+     */
+    bool steal(std::uint32_t& begin, std::uint32_t& end)
+    {
+        auto range = range_.load();
+        while (first(range) < last(range)) {
+            const auto middle = first(range) + (last(range) - first(range)) / 2;
+            if (range_.compare_exchange_weak(range, pack(first(range), middle))) {
+                begin = middle;
+                end = last(range);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static constexpr unsigned int halfWidth { 32 };
+    // Own cache line, so that workers popping from their ranges do not slow each other down
+    alignas(64) std::atomic<std::uint64_t> range_ {};
+
+    static constexpr std::uint64_t pack(std::uint32_t begin, std::uint32_t end)
+    {
+        return (std::uint64_t { begin } << halfWidth) | end;
+    }
+    static constexpr std::uint32_t first(std::uint64_t range)
+    {
+        return static_cast<std::uint32_t>(range >> halfWidth);
+    }
+    static constexpr std::uint32_t last(std::uint64_t range) { return static_cast<std::uint32_t>(range); }
+};
+
+/**
+ * @brief Call `function(index, worker)` for every index in [0, count) on a pool of work-stealing threads
+ *        The calling thread is one of the workers, so a single thread does not spawn any
+ * @param count The number of indices
+ * @param threads The number of workers
+ * @param function The function to call, from multiple threads concurrently
+ */
+template <typename Function>
+void forEachIndexInParallel(std::size_t count, std::size_t threads, const Function& function)
+{
+    constexpr std::uint32_t chunk { 16 };
+    constexpr std::size_t maxRoundSize { std::numeric_limits<std::uint32_t>::max() };
+    const auto workers = std::max<std::size_t>(1, std::min(threads, (count + chunk - 1) / chunk));
+    std::vector<StealableRange> ranges(workers);
+    // Batches too large for 32-bit indices are worked through in rounds
+    for (std::size_t offset = 0; offset < count; offset += maxRoundSize) {
+        const auto roundSize = std::min(count - offset, maxRoundSize);
+        for (std::size_t worker = 0; worker < workers; ++worker) {
+            ranges[worker].assign(
+                static_cast<std::uint32_t>(roundSize * worker / workers),
+                static_cast<std::uint32_t>(roundSize * (worker + 1) / workers));
+        }
+        const auto work = [&ranges, &function, offset, workers](std::size_t worker) {
+            std::uint32_t begin {};
+            std::uint32_t end {};
+            while (true) {
+                while (ranges[worker].pop(chunk, begin, end)) {
+                    for (auto index = begin; index < end; ++index) {
+                        function(offset + index, worker);
+                    }
+                }
+                // Out of work, take over half of what the next busy worker has left
+                bool stole {};
+                for (std::size_t step = 1; step < workers && !stole; ++step) {
+                    stole = ranges[(worker + step) % workers].steal(begin, end);
+                }
+                if (!stole) {
+                    return;
+                }
+                ranges[worker].assign(begin, end);
+            }
+        };
+        std::vector<std::thread> pool {};
+        for (std::size_t worker = 1; worker < workers; ++worker) {
+            pool.emplace_back(work, worker);
+        }
+        work(0);
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+}
+
+inline const char* toCString(const std::string& argument) { return argument.c_str(); }
+inline const char* toCString(const char* argument) { return argument; }
+
+inline std::pair<int, char**> toArgcArgv(const UnparsedCommand::ArgvView& commandLine, std::vector<char*>&)
+{
+    return { commandLine.argc, commandLine.argv };
+}
+
+/**
+ * @brief Lay out a range of arguments (e.g. `std::vector<std::string>`) as `argc` and `argv`
+ * @param commandLine The arguments, starting with the program name
+ * @param buffer Where the argument pointers are kept, reused between command lines
+ * @return The argument count and values, valid as long as `commandLine` and `buffer` are not modified
+ */
+template <typename Range>
+std::pair<int, char**> toArgcArgv(const Range& commandLine, std::vector<char*>& buffer)
+{
+    buffer.clear();
+    for (const auto& argument : commandLine) {
+        // The parser only reads the arguments, it takes them mutable for compatibility with `main`
+        buffer.push_back(const_cast<char*>(toCString(argument))); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+    }
+    buffer.push_back(nullptr);
+    return { static_cast<int>(buffer.size() - 1), buffer.data() };
+}
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief Parse many command lines against the same commands in parallel, e.g. to validate recorded invocations
+ *        The commands are only read, and their help prompt and lookup table are computed once for the whole batch,
+ *        with the help prompt shared rather than copied by the results. Like `UnparsedCommand::validate`, every
+ *        problem of a command line is collected into its result, so an invalid number (e.g. "12abc", as for `parse`)
+ *        fails that command line instead of throwing out of a worker, and the diagnostics of each command line
+ *        are written in one piece
+ * @tparam Instrumentation An optional instrumentation policy, which must be safe to use from multiple threads
+ * @param commandLines A random access range of command lines, each either an `ArgvView` or a range of
+ *        `std::string` or `const char*` starting with the program name
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @param results A random access range of default constructed parsed commands of at least the size of
+ *        `commandLines`, where the result of each command line is written at the same position
+ * @param threads The number of threads to parse with, including the calling one
+ */
+template <typename Instrumentation = NoInstrumentation, typename CommandLines, typename T, typename Results>
+void parseBatch(
+    const CommandLines& commandLines,
+    const T& unparsedCommands,
+    Results& results,
+    std::size_t threads = std::max(1U, std::thread::hardware_concurrency()))
+{
+    const auto count = static_cast<std::size_t>(std::size(commandLines));
+    assert(static_cast<std::size_t>(std::size(results)) >= count && "Results must fit all command lines");
+    const details::CommandTable<T> table { unparsedCommands };
+    const details::ParseContext<T> context { nullptr, &table, false, true };
+    std::vector<std::vector<char*>> buffers(std::max<std::size_t>(threads, 1));
+    details::forEachIndexInParallel(
+        count, threads, [&commandLines, &unparsedCommands, &results, &context, &buffers](auto index, auto worker) {
+            const auto [argc, argv] = details::toArgcArgv(commandLines[index], buffers[worker]);
+            results[index] = ParsedCommandImpl<T, Instrumentation> { argc, argv, unparsedCommands, context };
+        });
+}
+
+/**
+ * @brief Parse many command lines against the same commands in parallel, see the overload taking the results
+ * @return The parsed commands, in the order of `commandLines`
+ */
+template <typename Instrumentation = NoInstrumentation, typename CommandLines, typename T>
+[[nodiscard]] std::vector<ParsedCommandImpl<T, Instrumentation>> parseBatch(
+    const CommandLines& commandLines,
+    const T& unparsedCommands,
+    std::size_t threads = std::max(1U, std::thread::hardware_concurrency()))
+{
+    std::vector<ParsedCommandImpl<T, Instrumentation>> results(static_cast<std::size_t>(std::size(commandLines)));
+    parseBatch<Instrumentation>(commandLines, unparsedCommands, results, threads);
+    return results;
+}
+} // namespace UnparsedCommand
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace UnparsedCommand {
+/// @brief The shells completion scripts can be generated for
+enum class Shell { bash, zsh, fish };
+} // namespace UnparsedCommand
+
+namespace details {
+/// @brief What a completion script needs to know about a command, sorted so that regenerated scripts are identical
+struct CompletionEntry {
+    std::vector<std::string> names {};
+    std::vector<std::string> options {};
+    std::string description {};
+    std::optional<std::size_t> maxArgCount {};
+};
+
+template <typename T>
+std::vector<CompletionEntry> completionEntries(const T& commands)
+{
+    std::vector<CompletionEntry> entries {};
+    visitTuple(commands, [&entries](auto&& command) {
+        auto& entry = entries.emplace_back();
+        entry.names.assign(command.aliases().begin(), command.aliases().end());
+        std::sort(entry.names.begin(), entry.names.end());
+        entry.names.insert(entry.names.begin(), command.id());
+        for (const auto& option : command.options()) {
+            entry.options.push_back((option.size() == 1 ? "-" : "--") + option);
+        }
+        std::sort(entry.options.begin(), entry.options.end());
+        entry.description = command.description();
+        if (command.getMaxArgCount() != std::numeric_limits<std::size_t>::max()) {
+            entry.maxArgCount = command.getMaxArgCount();
+        }
+    });
+    return entries;
+}
+
+/// @brief Quote text for a POSIX shell, so that it is taken literally
+inline std::string shellQuote(std::string_view text)
+{
+    std::string quoted { "'" };
+    for (const auto c : text) {
+        quoted += c == '\'' ? std::string_view { "'\\''" } : std::string_view { &c, 1 };
+    }
+    return quoted + "'";
+}
+
+/// @brief Quote text for fish, where only `\` and `'` are special within single quotes
+inline std::string fishQuote(std::string_view text)
+{
+    std::string quoted { "'" };
+    for (const auto c : text) {
+        if (c == '\'' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "'";
+}
+
+inline std::string join(const std::vector<std::string>& words, std::string_view separator)
+{
+    std::string joined {};
+    for (const auto& word : words) {
+        joined.append(joined.empty() ? "" : separator).append(word);
+    }
+    return joined;
+}
+
+/// @brief A name usable as a shell function name, e.g. `my-tool` becomes `my_tool`
+inline std::string functionName(std::string_view program)
+{
+    std::string name { "_" };
+    for (const auto c : program) {
+        name += std::isalnum(c, std::locale::classic()) ? c : '_';
+    }
+    return name;
+}
+
+inline std::vector<std::string> allNames(const std::vector<CompletionEntry>& entries)
+{
+    std::vector<std::string> names {};
+    for (const auto& entry : entries) {
+        names.insert(names.end(), entry.names.begin(), entry.names.end());
+    }
+    return names;
+}
+
+inline std::vector<std::string> quotedNames(const std::vector<std::string>& names)
+{
+    std::vector<std::string> quoted {};
+    for (const auto& name : names) {
+        quoted.push_back(shellQuote(name));
+    }
+    return quoted;
+}
+
+/**
+ * @brief Write the `case` branches shared by the bash and zsh scripts, which set the options and the maximum number
+ *        of arguments of the command being completed
+ */
+inline void writeCaseBranches(std::ostream& script, const std::vector<CompletionEntry>& entries)
+{
+    for (const auto& entry : entries) {
+        script << "    " << join(quotedNames(entry.names), "|") << ")\n";
+        script << "        options=" << shellQuote(join(entry.options, " ")) << "\n";
+        script << "        maxArguments=" << (entry.maxArgCount ? std::to_string(*entry.maxArgCount) : "-1") << "\n";
+        script << "        ;;\n";
+    }
+}
+
+inline void
+writeBashCompletion(std::ostream& script, std::string_view program, const std::vector<CompletionEntry>& entries)
+{
+    const auto function = functionName(program);
+    script << "# bash completion for " << program << ", generated from its commands\n"
+           << function << "()\n"
+           << "{\n"
+           << "    local current=\"${COMP_WORDS[COMP_CWORD]}\"\n"
+           << "    if [[ ${COMP_CWORD} -eq 1 ]]; then\n"
+           << "        COMPREPLY=($(compgen -W " << shellQuote(join(allNames(entries), " "))
+           << " -- \"${current}\"))\n"
+           << "        return\n"
+           << "    fi\n"
+           << "    local options=\"\" maxArguments=0\n"
+           << "    case \"${COMP_WORDS[1]}\" in\n";
+    writeCaseBranches(script, entries);
+    script << "    *)\n"
+           << "        return\n"
+           << "        ;;\n"
+           << "    esac\n"
+           << "    local arguments=0 i\n"
+           << "    for ((i = 2; i < COMP_CWORD; i++)); do\n"
+           << "        [[ ${COMP_WORDS[i]} == -?* ]] || ((arguments++))\n"
+           << "    done\n"
+           << "    if [[ ${current} == -* || (${maxArguments} -ge 0 && ${arguments} -ge ${maxArguments}) ]]; then\n"
+           << "        COMPREPLY=($(compgen -W \"${options}\" -- \"${current}\"))\n"
+           << "    else\n"
+           << "        COMPREPLY=($(compgen -f -- \"${current}\"))\n"
+           << "    fi\n"
+           << "}\n"
+           << "complete -F " << function << " " << shellQuote(program) << "\n";
+}
+
+inline void
+writeZshCompletion(std::ostream& script, std::string_view program, const std::vector<CompletionEntry>& entries)
+{
+    const auto function = functionName(program);
+    script << "#compdef " << program << "\n"
+           << "# zsh completion for " << program << ", generated from its commands\n"
+           << function << "()\n"
+           << "{\n"
+           << "    if (( CURRENT == 2 )); then\n"
+           << "        compadd -- " << join(quotedNames(allNames(entries)), " ") << "\n"
+           << "        return\n"
+           << "    fi\n"
+           << "    local options=\"\" maxArguments=0\n"
+           << "    case \"${words[2]}\" in\n";
+    writeCaseBranches(script, entries);
+    script << "    *)\n"
+           << "        return 1\n"
+           << "        ;;\n"
+           << "    esac\n"
+           << "    local arguments=0 i\n"
+           << "    for (( i = 3; i < CURRENT; i++ )); do\n"
+           << "        [[ ${words[i]} == -?* ]] || (( arguments++ ))\n"
+           << "    done\n"
+           << "    if [[ ${words[CURRENT]} == -* ]] || (( maxArguments >= 0 && arguments >= maxArguments )); then\n"
+           << "        compadd -- ${=options}\n"
+           << "    else\n"
+           << "        _files\n"
+           << "    fi\n"
+           << "}\n"
+           << "if [[ ${funcstack[1]} == " << function << " ]]; then\n"
+           << "    " << function << " \"$@\"\n"
+           << "else\n"
+           << "    compdef " << function << " " << shellQuote(program) << "\n"
+           << "fi\n";
+}
+
+inline void
+writeFishCompletion(std::ostream& script, std::string_view program, const std::vector<CompletionEntry>& entries)
+{
+    const auto quotedProgram = fishQuote(program);
+    const auto noCommandYet = fishQuote("not __fish_seen_subcommand_from " + join(allNames(entries), " "));
+    script << "# fish completion for " << program << ", generated from its commands\n"
+           << "complete -c " << quotedProgram << " -f\n";
+    for (const auto& entry : entries) {
+        for (const auto& name : entry.names) {
+            script << "complete -c " << quotedProgram << " -n " << noCommandYet << " -a " << fishQuote(name) << " -d "
+                   << fishQuote(entry.description) << "\n";
+        }
+        const auto condition = fishQuote("__fish_seen_subcommand_from " + join(entry.names, " "));
+        for (const auto& option : entry.options) {
+            const auto isShort = option.size() == 2;
+            script << "complete -c " << quotedProgram << " -n " << condition << (isShort ? " -s " : " -l ")
+                   << fishQuote(option.substr(isShort ? 1 : 2)) << "\n";
+        }
+        // fish cannot count the arguments given so far, so commands taking any complete files throughout
+        if (entry.maxArgCount != std::size_t { 0 }) {
+            script << "complete -c " << quotedProgram << " -n " << condition << " -F\n";
+        }
+    }
+}
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief Write a static completion script for the supplied commands, so that the shell completes command IDs,
+ *        aliases and options without running the program. Once a command has all the arguments it can take, only
+ *        its options are completed, otherwise files are
+ * @tparam T A tuple with the available unparsed commands
+ * @param script Where the script is written
+ * @param shell The shell the script is for
+ * @param program The name of the program the script completes
+ * @param unparsedCommands A tuple with the available unparsed commands
+ */
+template <typename T>
+void writeCompletion(std::ostream& script, Shell shell, std::string_view program, const T& unparsedCommands)
+{
+    const auto entries = details::completionEntries(unparsedCommands);
+    switch (shell) {
+    case Shell::bash:
+        details::writeBashCompletion(script, program, entries);
+        break;
+    case Shell::zsh:
+        details::writeZshCompletion(script, program, entries);
+        break;
+    case Shell::fish:
+        details::writeFishCompletion(script, program, entries);
+        break;
+    }
+}
+
+/**
+ * @brief The `main` of a completion generator, i.e. a small program compiled against the commands of a program,
+ *        invoked as `generator <bash|zsh|fish> <output file>` by the `command_parser_add_completions` CMake function
+ * @tparam T A tuple with the available unparsed commands
+ * @param argc The number of CLI arguments of the generator
+ * @param argv The CLI arguments of the generator
+ * @param program The name of the program the scripts complete
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @return The exit code of the generator
+ */
+template <typename T>
+int completionMain(int argc, char* argv[], std::string_view program, const T& unparsedCommands)
+{
+    const auto bash = create("bash", "Generate a bash completion script", "<output file>").withArgs<std::string>();
+    const auto zsh = create("zsh", "Generate a zsh completion script", "<output file>").withArgs<std::string>();
+    const auto fish = create("fish", "Generate a fish completion script", "<output file>").withArgs<std::string>();
+    const std::tuple generators { bash, zsh, fish };
+    const auto generate = [program, &unparsedCommands](Shell shell) {
+        return [shell, program, &unparsedCommands](const std::string& path) {
+            std::ofstream script { path };
+            writeCompletion(script, shell, program, unparsedCommands);
+            return script ? 0 : 1;
+        };
+    };
+    return dispatch(
+        parse(argc, argv, generators),
+        [](const auto& parsedCommand) {
+            std::cerr << parsedCommand.help();
+            return 1;
+        },
+        generate(Shell::bash),
+        generate(Shell::zsh),
+        generate(Shell::fish));
+}
+} // namespace UnparsedCommand
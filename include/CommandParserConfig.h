@@ -0,0 +1,226 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+namespace UnparsedCommand {
+/**
+ * @brief Per-host command defaults loaded from a memory-mapped key/value file
+ *
+ * Every non-empty line that does not start with `#` or `;` is a `<command id>.<key> = <value>` pair, where `<key>` is
+ * either an option (e.g. `get.x = on`) or the index of an optional argument (e.g. `get.1 = fallback`). Values may be
+ * enclosed in double quotes to keep leading or trailing whitespace.
+ *
+ * The file is parsed once into an index of views into the mapping, so applying the defaults to commands copies no
+ * values and defaults that are overridden by the command line or the environment are never converted.
+ * The precedence is command line > environment > file. Keys naming neither a command, an option of the command nor
+ * an optional argument of the command are reported on stderr and ignored, just like malformed lines.
+ */
+class ConfigFile
+{
+public:
+    /**
+     * @brief Map and index the supplied file
+     * @param path The path to the configuration file
+     */
+    explicit ConfigFile(const std::string& path)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        const auto fileDescriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fileDescriptor < 0) {
+            std::cerr << "Could not open config file: " << path << std::endl;
+            return;
+        }
+        struct stat fileStatus {};
+        if (::fstat(fileDescriptor, &fileStatus) != 0) {
+            std::cerr << "Could not read config file: " << path << std::endl;
+        } else if (fileStatus.st_size == 0) {
+            loaded_ = true; // Nothing to map
+        } else {
+            const auto size = static_cast<std::size_t>(fileStatus.st_size);
+            auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (mapping != MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+                mapping_ = mapping;
+                size_ = size;
+                loaded_ = true;
+            } else {
+                std::cerr << "Could not map config file: " << path << std::endl;
+            }
+        }
+        ::close(fileDescriptor);
+        index({ static_cast<const char*>(mapping_), size_ });
+    }
+
+    ConfigFile(const ConfigFile&) = delete;
+    ConfigFile& operator=(const ConfigFile&) = delete;
+
+    ConfigFile(ConfigFile&& other) noexcept
+        : mapping_ { std::exchange(other.mapping_, nullptr) }
+        , size_ { std::exchange(other.size_, 0) }
+        , loaded_ { other.loaded_ }
+        , index_ { std::move(other.index_) }
+    {
+    }
+
+    ConfigFile& operator=(ConfigFile&& other) noexcept
+    {
+        if (this != &other) {
+            unmap();
+            mapping_ = std::exchange(other.mapping_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            loaded_ = other.loaded_;
+            index_ = std::move(other.index_);
+        }
+        return *this;
+    }
+
+    ~ConfigFile() { unmap(); }
+
+    /**
+     * @brief Check whether the file could be read
+     * @return true if the file was loaded (even if empty), false otherwise
+     */
+    [[nodiscard]] bool isLoaded() const { return loaded_; }
+
+    /**
+     * @brief Look up a value
+     * @param commandId The command ID
+     * @param key The option or the index of the argument
+     * @return A view of the value in the mapped file or std::nullopt if it is not defined
+     */
+    [[nodiscard]] std::optional<std::string_view> find(std::string_view commandId, std::string_view key) const
+    {
+        const auto command = index_.find(commandId);
+        if (command == index_.end()) {
+            return std::nullopt;
+        }
+        const auto value = command->second.find(key);
+        if (value == command->second.end()) {
+            return std::nullopt;
+        }
+        return value->second;
+    }
+
+    /**
+     * @brief Create commands that fall back to the defaults in this file
+     * @tparam Commands The unparsed command types
+     * @param commands A tuple with the unparsed commands
+     * @return A tuple with the same commands, including their defaults from the file
+     * @warning The config file must outlive the returned commands
+     */
+    template <typename... Commands>
+    [[nodiscard]] std::tuple<Commands...> apply(const std::tuple<Commands...>& commands) const
+    {
+        for (const auto& [commandId, defaults] : index_) {
+            bool known {};
+            details::visitTuple(commands, [&known, commandId = commandId](auto&& command) {
+                known = known || command.id() == commandId;
+            });
+            if (!known) {
+                std::cerr << "Ignoring config of unknown command: " << commandId << std::endl;
+            }
+        }
+        return std::apply(
+            [this](const auto&... command) { return std::tuple<Commands...> { applyTo(command)... }; }, commands);
+    }
+
+private:
+    void* mapping_ {};
+    std::size_t size_ {};
+    bool loaded_ {};
+    std::unordered_map<std::string_view, std::unordered_map<std::string_view, std::string_view>> index_ {};
+
+    void unmap()
+    {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, size_);
+            mapping_ = nullptr;
+        }
+    }
+
+    static std::string_view trim(std::string_view view)
+    {
+        constexpr std::string_view whitespace { " \t\r" };
+        view.remove_prefix(std::min(view.find_first_not_of(whitespace), view.size()));
+        view.remove_suffix(view.size() - (view.find_last_not_of(whitespace) + 1));
+        return view;
+    }
+
+    void index(std::string_view contents)
+    {
+        std::size_t lineNumber {};
+        while (!contents.empty()) {
+            ++lineNumber;
+            const auto lineEnd = std::min(contents.find('\n'), contents.size());
+            const auto line = trim(contents.substr(0, lineEnd));
+            contents.remove_prefix(std::min(lineEnd + 1, contents.size()));
+            if (line.empty() || line.front() == '#' || line.front() == ';') {
+                continue;
+            }
+
+            const auto separator = line.find('=');
+            const auto key = trim(line.substr(0, std::min(separator, line.size())));
+            const auto dot = key.find('.');
+            if (separator == std::string_view::npos || dot == std::string_view::npos || dot == 0
+                || dot + 1 == key.size()) {
+                std::cerr << "Ignoring malformed config line " << lineNumber << ": " << line << std::endl;
+                continue;
+            }
+            auto value = trim(line.substr(separator + 1));
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.size() - 2);
+            }
+            // Later definitions override earlier ones, like they would if expanded into the command line
+            index_[trim(key.substr(0, dot))][trim(key.substr(dot + 1))] = value;
+        }
+    }
+
+    template <typename ArgumentsType>
+    static bool isOptionalArgument(std::size_t index)
+    {
+        bool optional {};
+        details::visitTupleWithIndex(ArgumentsType {}, [&optional, index](auto&& argument, auto argumentIndex) {
+            if constexpr (details::isOptional<std::decay_t<decltype(argument)>>::value) {
+                optional = optional || decltype(argumentIndex)::value == index;
+            }
+        });
+        return optional;
+    }
+
+    template <typename CommandType>
+    CommandType applyTo(const CommandType& command) const
+    {
+        const auto defaults = index_.find(command.id());
+        if (defaults == index_.end()) {
+            return command;
+        }
+
+        // Collected first, so that the command is copied once however many defaults it has
+        std::unordered_map<std::size_t, std::string_view> argumentDefaults {};
+        std::unordered_map<std::string, std::string_view> optionDefaults {};
+        for (const auto& [key, value] : defaults->second) {
+            std::size_t argumentIndex {};
+            const auto* const keyEnd = key.data() + key.size();
+            const auto [end, error] = std::from_chars(key.data(), keyEnd, argumentIndex);
+            if (command.options().count(std::string { key }) > 0) {
+                optionDefaults.emplace(key, value);
+            } else if (error == std::errc {} && end == keyEnd
+                       && isOptionalArgument<typename CommandType::ArgumentsType>(argumentIndex)) {
+                argumentDefaults.emplace(argumentIndex, value);
+            } else {
+                std::cerr << "Ignoring unknown config key: " << command.id() << "." << key << std::endl;
+            }
+        }
+        if (argumentDefaults.empty() && optionDefaults.empty()) {
+            return command;
+        }
+        return command.withDefaults(argumentDefaults, optionDefaults);
+    }
+};
+} // namespace UnparsedCommand
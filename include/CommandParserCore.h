@@ -0,0 +1,567 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The parts of the command parser that need neither streams nor the heap, shared by `CommandParser.h` and the
+// heap-free parse of `CommandParserFixed.h`
+
+/// @brief The kinds of problems found when parsing with errors collected, see `UnparsedCommand::validate`
+enum class ParseErrorKind {
+    noCommand,
+    unknownCommand,
+    wrongArgumentCount,
+    unknownOption,
+    invalidArgument,
+    unsatisfiedOptionConstraint,
+    tooManyWords, ///< Only from fixed-capacity parses, see `UnparsedCommand::parseFixed`
+};
+
+namespace details {
+// Adapted from
+// https://github.com/heavyeyelid/virthttp/blob/master/include/virt_wrap/utility.hpp#L42-L46
+template <typename T, typename V, size_t... I>
+constexpr void tupleVisitImpl(T&& t, V&& v, std::index_sequence<I...>)
+{
+    (..., v(std::get<I>(t)));
+}
+
+template <typename T, typename V>
+constexpr void visitTuple(T&& t, V&& v)
+{
+    tupleVisitImpl(
+        std::forward<T>(t),
+        std::forward<V>(v),
+        std::make_index_sequence<std::tuple_size<typename std::decay<T>::type>::value>());
+}
+
+template <typename T, typename V, size_t... I>
+constexpr void tupleVisitWithIndexImpl(T&& t, V&& v, std::index_sequence<I...>)
+{
+    (..., v(std::get<I>(t), std::integral_constant<std::size_t, I> {}));
+}
+
+/// @brief Same as visitTuple but the visitor also receives the element index as an std::integral_constant
+template <typename T, typename V>
+constexpr void visitTupleWithIndex(T&& t, V&& v)
+{
+    tupleVisitWithIndexImpl(
+        std::forward<T>(t),
+        std::forward<V>(v),
+        std::make_index_sequence<std::tuple_size<typename std::decay<T>::type>::value>());
+}
+
+template <typename T, typename Valid = void>
+struct isOptional : std::false_type {
+};
+
+template <typename T>
+struct isOptional<std::optional<T>> : std::true_type {
+};
+
+template <typename T, typename Valid = void>
+struct isVector : std::false_type {
+};
+
+template <typename T>
+struct isVector<std::vector<T>> : std::true_type {
+};
+
+/**
+ * @brief Whether a `parseValue(std::string_view text, T& value) -> std::errc` overload is found for `T` through
+ *        argument-dependent lookup, i.e. declared in the namespace of `T`
+ */
+template <typename T, typename Valid = void>
+struct hasParseValue : std::false_type {
+};
+
+template <typename T>
+struct hasParseValue<
+    T,
+    std::enable_if_t<
+        std::is_same<decltype(parseValue(std::declval<std::string_view>(), std::declval<T&>())), std::errc>::value>>
+    : std::true_type {
+};
+
+/**
+ * @brief Whether an `argumentKeywords(T) -> std::array<std::pair<std::string_view, T>, N>` overload is found for `T`
+ *        through argument-dependent lookup, see `KeywordTable`
+ */
+template <typename T, typename Valid = void>
+struct hasArgumentKeywords : std::false_type {
+};
+
+template <typename T>
+struct hasArgumentKeywords<T, std::void_t<decltype(argumentKeywords(std::declval<T>()))>> : std::true_type {
+};
+
+template <typename T, typename Valid = void>
+struct isAllowedCustomType : std::false_type {
+};
+
+template <typename T>
+struct isAllowedCustomType<
+    T,
+    std::enable_if_t<
+        std::is_default_constructible<T>::value
+        && (hasParseValue<T>::value || hasArgumentKeywords<T>::value
+            || std::is_constructible<T, std::string>::value)>> : std::true_type {
+};
+
+template <typename T>
+struct isAllowedType : isAllowedCustomType<T> {
+};
+
+template <typename... Ts>
+struct isAllowedType<std::tuple<Ts...>> : std::conjunction<isAllowedType<Ts>...> {
+};
+
+template <>
+struct isAllowedType<std::string> : std::true_type {
+};
+
+template <>
+struct isAllowedType<int> : std::true_type {
+};
+
+template <>
+struct isAllowedType<long> : std::true_type {
+};
+
+template <>
+struct isAllowedType<long long> : std::true_type {
+};
+
+template <>
+struct isAllowedType<unsigned long> : std::true_type {
+};
+
+template <>
+struct isAllowedType<unsigned long long> : std::true_type {
+};
+
+template <>
+struct isAllowedType<float> : std::true_type {
+};
+
+template <>
+struct isAllowedType<double> : std::true_type {
+};
+
+template <>
+struct isAllowedType<long double> : std::true_type {
+};
+
+template <>
+struct isAllowedType<bool> : std::true_type {
+};
+
+template <typename T>
+struct isAllowedType<std::vector<T>> : isAllowedType<T> {
+};
+
+template <typename T>
+struct isAllowedType<std::optional<T>> : isAllowedType<T> {
+};
+
+// Adapted from cppreference:
+// https://en.cppreference.com/w/cpp/algorithm/is_partitioned
+template <class InputIt, class UnaryPredicate>
+constexpr bool isPartitioned(InputIt first, InputIt last, UnaryPredicate p)
+{
+    for (; first != last; ++first) {
+        if (!p(*first)) {
+            break;
+        }
+    }
+    for (; first != last; ++first) {
+        if (p(*first)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// constexpr std::count since it's not available in C++17
+// Adapted from: https://en.cppreference.com/w/cpp/algorithm/count
+template <class InputIt, class T>
+constexpr auto count(InputIt first, InputIt last, const T& value)
+{
+    typename std::iterator_traits<InputIt>::difference_type n = 0;
+    for (; first != last; ++first) {
+        if (*first == value) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+template <class... Ts>
+class ArrayWrapper
+{
+public:
+    explicit constexpr ArrayWrapper(Ts... ts)
+        : data_ { ts... }
+    {
+    }
+
+    using value_type = std::tuple_element_t<0, std::tuple<Ts...>>;
+
+    [[nodiscard]] constexpr const value_type* begin() const { return static_cast<const value_type*>(data_); }
+
+    [[nodiscard]] constexpr const value_type* end() const
+    {
+        return static_cast<const value_type*>(data_) + sizeof...(Ts);
+    }
+
+private:
+    value_type data_[sizeof...(Ts)];
+};
+
+/// @brief Check that arguments which are mandatory are always expected before optional ones
+template <class... Types>
+constexpr bool hasNoPrecedingOptionalArguments()
+{
+    // TODO(dimitris): Remove ArrayWrapper and replace with constexpr std::array<bool, sizeof...(Types)>
+    //  once we can use a newer clang version, since clang-8 does not think std::array is a literal type
+    constexpr ArrayWrapper r { !isOptional<Types>::value && !isVector<Types>::value... };
+    return isPartitioned(r.begin(), r.end(), [](auto v) { return v; });
+}
+
+/// @brief Check that if we have vector arguments they are always the last ones
+template <class... Types>
+constexpr bool hasNoPrecedingVector()
+{
+    constexpr ArrayWrapper r { !isVector<Types>::value... };
+    return isPartitioned(r.begin(), r.end(), [](auto v) { return v; });
+}
+
+template <class... Types>
+constexpr bool doesNotContainBothOptionalAndVector()
+{
+    constexpr ArrayWrapper optionals { isOptional<Types>::value... };
+    constexpr auto optionalArguments = count(optionals.begin(), optionals.end(), true);
+    constexpr ArrayWrapper vectors { isVector<Types>::value... };
+    constexpr auto vectorArguments = count(vectors.begin(), vectors.end(), true);
+
+    return optionalArguments == 0 || vectorArguments == 0;
+}
+
+template <class... Types>
+constexpr bool containsAtMostOneVector()
+{
+    constexpr ArrayWrapper vectors { isVector<Types>::value... };
+
+    return count(vectors.begin(), vectors.end(), true) <= 1;
+}
+
+constexpr void removeAllLeading(std::string_view& view, char charToRemove)
+{
+    view.remove_prefix(std::min(view.find_first_not_of(charToRemove), view.size()));
+}
+
+/// @brief What a word of the command line is, see `lexWord`
+enum class TokenKind : std::uint8_t {
+    argument, ///< An argument, including negative numbers, a lone `-` and escaped words such as `\-x`
+    shortOptions, ///< One or more short options, e.g. `-xyz`
+    longOption, ///< A long option, e.g. `--force`
+    longOptionWithValue, ///< A long option with a value attached, e.g. `--force=no`
+    endOfOptions, ///< A bare `--`, after which every word is an argument
+};
+
+/// @brief A lexed word of the command line, whose text is a range of the word rather than a copy of it
+struct Token {
+    TokenKind kind {};
+    // Words of a command line are far smaller than 4 GiB
+    std::uint32_t offset {};
+    std::uint32_t length {};
+
+    /// @brief Get the text of an argument or the name of the options, i.e. without dashes or escape
+    [[nodiscard]] constexpr std::string_view text(std::string_view word) const { return word.substr(offset, length); }
+
+    /// @brief Get the value of a `TokenKind::longOptionWithValue`, i.e. what follows the `=`
+    [[nodiscard]] constexpr std::string_view value(std::string_view word) const
+    {
+        return word.substr(std::min<std::size_t>(offset + length + 1, word.size()));
+    }
+};
+
+enum class CharacterClass : std::uint8_t { dash, backslash, digit, dot, letter, equals, space, other };
+constexpr std::size_t characterClassCount { 8 };
+
+constexpr std::array<CharacterClass, 256> characterClasses = [] {
+    std::array<CharacterClass, 256> classes {};
+    for (auto& characterClass : classes) {
+        characterClass = CharacterClass::other;
+    }
+    for (auto c = 'a'; c <= 'z'; ++c) {
+        classes[static_cast<unsigned char>(c)] = CharacterClass::letter;
+        classes[static_cast<unsigned char>(c - 'a' + 'A')] = CharacterClass::letter;
+    }
+    for (auto c = '0'; c <= '9'; ++c) {
+        classes[static_cast<unsigned char>(c)] = CharacterClass::digit;
+    }
+    classes[static_cast<unsigned char>('-')] = CharacterClass::dash;
+    classes[static_cast<unsigned char>('\\')] = CharacterClass::backslash;
+    classes[static_cast<unsigned char>('.')] = CharacterClass::dot;
+    classes[static_cast<unsigned char>('=')] = CharacterClass::equals;
+    classes[static_cast<unsigned char>(' ')] = CharacterClass::space;
+    return classes;
+}();
+
+enum class LexerState : std::uint8_t {
+    start,
+    escape, ///< A leading backslash
+    dash,
+    dashDot, ///< Either a negative number (`-.5`) or short options
+    dashDash,
+    shortOptions,
+    longName,
+    // The states below are final, the rest of the word does not change what it is
+    longValue,
+    argument,
+    escapedArgument,
+};
+
+constexpr std::size_t lexerStateCount { 10 };
+
+/// @brief The next state of the lexer given its current state (rows) and the class of the next character (columns)
+constexpr std::array<std::array<LexerState, characterClassCount>, lexerStateCount> lexerTransitions = [] {
+    using C = CharacterClass;
+    using S = LexerState;
+    std::array<std::array<LexerState, characterClassCount>, lexerStateCount> table {};
+    // A state goes to `otherwise` for every class of characters but the listed ones
+    const auto row = [&table](S state, S otherwise, std::initializer_list<std::pair<C, S>> exceptions) {
+        auto& transitions = table[static_cast<std::size_t>(state)];
+        for (auto& next : transitions) {
+            next = otherwise;
+        }
+        for (const auto& exception : exceptions) {
+            transitions[static_cast<std::size_t>(exception.first)] = exception.second;
+        }
+    };
+    row(S::start, S::argument, { { C::dash, S::dash }, { C::backslash, S::escape } });
+    row(S::escape, S::argument, { { C::dash, S::escapedArgument }, { C::backslash, S::escapedArgument } });
+    row(S::dash,
+        S::shortOptions,
+        { { C::dash, S::dashDash }, { C::digit, S::argument }, { C::dot, S::dashDot }, { C::space, S::argument } });
+    row(S::dashDot, S::shortOptions, { { C::digit, S::argument }, { C::space, S::argument } });
+    row(S::dashDash, S::argument, { { C::digit, S::longName }, { C::letter, S::longName } });
+    row(S::shortOptions, S::shortOptions, { { C::space, S::argument } });
+    row(S::longName, S::longName, { { C::equals, S::longValue }, { C::space, S::argument } });
+    row(S::longValue, S::longValue, {});
+    row(S::argument, S::argument, {});
+    row(S::escapedArgument, S::escapedArgument, {});
+    return table;
+}();
+
+/**
+ * @brief Classify a word of the command line in a single pass over its characters, stopping as soon as the rest of
+ *        the word cannot change what it is, i.e. after the name of an option at most:
+ * - `--` ends the options, so that every following word is an argument
+ * - `--name` is a long option and `--name=value` one with a value attached
+ * - `-xyz` are short options, while negative numbers (`-1`, `-.5`) and a lone `-` are arguments
+ * - A leading backslash escapes a leading dash or backslash, e.g. `\-x` is the argument `-x`, and is kept otherwise
+ * - Option names cannot contain spaces, so words such as `--third argument` are arguments
+ * @param word The word
+ * @param optionsEnded Whether the options were ended by a previous `--`, in which case the word is an argument as is
+ * @return The token of the word
+ */
+constexpr Token lexWord(std::string_view word, bool optionsEnded = false)
+{
+    const auto wordSize = static_cast<std::uint32_t>(word.size());
+    if (optionsEnded) {
+        return { TokenKind::argument, 0, wordSize };
+    }
+    auto state = LexerState::start;
+    std::uint32_t position {};
+    for (; position < wordSize && state < LexerState::longValue; ++position) {
+        const auto characterClass = characterClasses[static_cast<unsigned char>(word[position])];
+        state = lexerTransitions[static_cast<std::size_t>(state)][static_cast<std::size_t>(characterClass)];
+    }
+    switch (state) {
+    case LexerState::dashDash:
+        return { TokenKind::endOfOptions, 0, wordSize };
+    case LexerState::dashDot:
+    case LexerState::shortOptions:
+        return { TokenKind::shortOptions, 1, wordSize - 1 };
+    case LexerState::longName:
+        return { TokenKind::longOption, 2, wordSize - 2 };
+    case LexerState::longValue:
+        // The loop stopped right after the `=`
+        return { TokenKind::longOptionWithValue, 2, position - 3 };
+    case LexerState::escapedArgument:
+        return { TokenKind::argument, 1, wordSize - 1 };
+    default:
+        return { TokenKind::argument, 0, wordSize };
+    }
+}
+
+constexpr char toLowerAscii(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+constexpr bool equalsIgnoringCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (toLowerAscii(a[i]) != toLowerAscii(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief FNV-1a of the lowercase text followed by the MurmurHash3 finalizer, so that every bit depends on the seed
+constexpr std::uint32_t hashIgnoringCase(std::string_view text, std::uint32_t seed)
+{
+    std::uint32_t hash { 2166136261U ^ seed };
+    for (const auto c : text) {
+        hash = (hash ^ static_cast<unsigned char>(toLowerAscii(c))) * 16777619U;
+    }
+    hash = (hash ^ (hash >> 16U)) * 0x85ebca6bU;
+    hash = (hash ^ (hash >> 13U)) * 0xc2b2ae35U;
+    return hash ^ (hash >> 16U);
+}
+
+constexpr std::size_t nextPowerOfTwo(std::size_t n)
+{
+    std::size_t power { 1 };
+    while (power < n) {
+        power *= 2;
+    }
+    return power;
+}
+
+/**
+ * @brief A table of case-insensitive keywords (e.g. "fast", "safe") and the values they stand for, looked up through
+ *        a perfect hash whose seed is searched for when the table is constructed, i.e. at compile time for a
+ *        `constexpr` table. A lookup hashes the text once and compares it with at most one keyword, without
+ *        allocating. Meant for the handful of keywords of an enum, as the slots grow with the square of their count
+ * @tparam E The type of the values
+ * @tparam Count The number of keywords
+ */
+template <typename E, std::size_t Count>
+class KeywordTable
+{
+public:
+    static_assert(Count > 0 && Count < std::numeric_limits<std::uint16_t>::max(), "Unsupported number of keywords");
+    using Keywords = std::array<std::pair<std::string_view, E>, Count>;
+
+    constexpr explicit KeywordTable(const Keywords& keywords)
+        : keywords_ { keywords }
+    {
+        constexpr std::uint32_t maxSeeds { 1024 };
+        for (; seed_ < maxSeeds; ++seed_) {
+            if (fillSlots()) {
+                isPerfect_ = true;
+                return;
+            }
+        }
+    }
+
+    /// @brief Whether a seed without collisions was found, which fails only if keywords are equal ignoring case
+    [[nodiscard]] constexpr bool isPerfect() const { return isPerfect_; }
+
+    /**
+     * @brief Look up a keyword ignoring case
+     * @param text The text to look up
+     * @return The value of the keyword or std::nullopt if the text is not a keyword
+     */
+    [[nodiscard]] constexpr std::optional<E> find(std::string_view text) const
+    {
+        const auto slot = slots_[slotOf(text)];
+        if (slot == 0 || !equalsIgnoringCase(keywords_[slot - 1U].first, text)) {
+            return std::nullopt;
+        }
+        return keywords_[slot - 1U].second;
+    }
+
+    [[nodiscard]] constexpr const Keywords& keywords() const { return keywords_; }
+
+private:
+    // At least four slots per keyword and, for larger tables, a quarter of the squared count, so that a seed without
+    // collisions is found within a few tries
+    static constexpr std::size_t slotCount { nextPowerOfTwo(std::max(4 * Count, Count * Count / 4)) };
+    Keywords keywords_ {};
+    // The position of the keyword plus one, zero for empty slots
+    std::array<std::uint16_t, slotCount> slots_ {};
+    std::uint32_t seed_ {};
+    bool isPerfect_ {};
+
+    [[nodiscard]] constexpr std::size_t slotOf(std::string_view text) const
+    {
+        return hashIgnoringCase(text, seed_) & (slotCount - 1);
+    }
+
+    constexpr bool fillSlots()
+    {
+        slots_ = {};
+        for (std::size_t i = 0; i < Count; ++i) {
+            auto& slot = slots_[slotOf(keywords_[i].first)];
+            if (slot != 0) {
+                return false;
+            }
+            slot = static_cast<std::uint16_t>(i + 1);
+        }
+        return true;
+    }
+};
+
+template <typename E, std::size_t Count>
+KeywordTable(const std::array<std::pair<std::string_view, E>, Count>&) -> KeywordTable<E, Count>;
+
+/// @brief The words a boolean argument or option value may be, ignoring case
+constexpr KeywordTable<bool, 10> booleanKeywords { { {
+    { "true", true },
+    { "yes", true },
+    { "y", true },
+    { "on", true },
+    { "1", true },
+    { "false", false },
+    { "no", false },
+    { "n", false },
+    { "off", false },
+    { "0", false },
+} } };
+static_assert(booleanKeywords.isPerfect());
+
+/**
+ * @brief Convert the whole text to a number without throwing or allocating
+ * @return std::errc {} on success, std::errc::invalid_argument if only a prefix is a number
+ */
+template <typename Number>
+std::errc convertNumber(std::string_view text, Number& number)
+{
+    // A leading plus is accepted by the `std::sto*` functions, but not by `std::from_chars`
+    const auto digits = !text.empty() && text.front() == '+' ? text.substr(1) : text;
+    const auto* const end = digits.data() + digits.size();
+    const auto [parsedEnd, error] = std::from_chars(digits.data(), end, number);
+    if (error != std::errc {}) {
+        return error;
+    }
+    return parsedEnd == end ? std::errc {} : std::errc::invalid_argument;
+}
+
+template <typename T, typename Tuple>
+struct typeInTuple;
+
+template <typename T, typename... Types>
+struct typeInTuple<T, std::tuple<Types...>> : std::disjunction<std::is_same<T, Types>...> {
+};
+
+/// @brief A set of options of a command as bits, indexed by the position of the option in the sorted options
+using OptionMask = std::uint64_t;
+constexpr std::size_t maxConstrainedOptions { sizeof(OptionMask) * 8 };
+} // namespace details
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "CommandParserCore.h"
+
+namespace details {
+/// @brief Whether an argument of a fixed command can be converted without allocating or throwing
+template <typename T, typename Valid = void>
+struct isFixedType : std::disjunction<hasParseValue<T>, hasArgumentKeywords<T>> {
+};
+
+template <typename T>
+struct isFixedType<T, std::enable_if_t<std::is_integral_v<T> || std::is_same_v<T, float> || std::is_same_v<T, double>>>
+    : std::true_type {
+};
+
+template <>
+struct isFixedType<std::string_view> : std::true_type {
+};
+
+template <typename T>
+struct isFixedType<std::optional<T>> : isFixedType<T> {
+};
+
+/// @brief Check that the optional arguments of a fixed command, if any, are the last ones
+template <typename... Types>
+constexpr bool optionalArgumentsAreLast()
+{
+    bool optionalFound {};
+    bool requiredAfterOptional {};
+    [[maybe_unused]] const auto check = [&optionalFound, &requiredAfterOptional](bool optional) {
+        requiredAfterOptional = requiredAfterOptional || (optionalFound && !optional);
+        optionalFound = optionalFound || optional;
+    };
+    (check(isOptional<Types>::value), ...);
+    return !requiredAfterOptional;
+}
+
+template <typename CommandTypes>
+struct FixedArguments;
+
+template <typename... Types>
+struct FixedArguments<std::tuple<Types...>> {
+    static constexpr bool allowed { std::conjunction_v<isFixedType<Types>...> };
+    static constexpr bool optionalsLast { optionalArgumentsAreLast<Types...>() };
+    static constexpr std::size_t requiredCount { (std::size_t { isOptional<Types>::value ? 0U : 1U } + ... + 0U) };
+};
+
+/**
+ * @brief An unparsed command whose ID, description, usage and options are views, e.g. of string literals, so that it
+ *        can be `constexpr` and parsing it never allocates, see `UnparsedCommand::createFixed`
+ * @tparam CommandTypes A tuple with the argument types
+ * @tparam OptionCount The number of options, each of which is one bit of the parsed command
+ */
+template <typename CommandTypes, std::size_t OptionCount>
+class FixedCommandImpl
+{
+public:
+    static_assert(OptionCount <= maxConstrainedOptions, "A fixed command can have at most 64 options");
+    static_assert(
+        FixedArguments<CommandTypes>::allowed,
+        "All arguments of a fixed command must be one of the following: "
+        "bool, an integral type, float, double, std::string_view "
+        "or a type with a parseValue or argumentKeywords overload, along with their std::optional variants");
+    static_assert(
+        FixedArguments<CommandTypes>::optionalsLast,
+        "All optional arguments must be placed in the end of the argument list");
+
+    using ArgumentsType = CommandTypes;
+    using Options = std::array<std::string_view, OptionCount>;
+
+    constexpr FixedCommandImpl(
+        std::string_view id,
+        std::string_view description,
+        std::string_view usage,
+        const Options& options)
+        : id_ { id }
+        , description_ { description }
+        , usage_ { usage }
+        , options_ { options }
+    {
+    }
+
+    /**
+     * @brief Add options to the command, with or without leading dashes, like `UnparsedCommandImpl::withOptions`
+     * @param options Each option, e.g. `{ "v", "--verbose" }`
+     * @return A command with the options of this command followed by the supplied ones
+     */
+    template <std::size_t Count>
+    [[nodiscard]] constexpr FixedCommandImpl<CommandTypes, OptionCount + Count>
+    withOptions(const std::string_view (&options)[Count]) const
+    {
+        std::array<std::string_view, OptionCount + Count> allOptions {};
+        for (std::size_t i = 0; i < OptionCount; ++i) {
+            allOptions[i] = options_[i];
+        }
+        for (std::size_t i = 0; i < Count; ++i) {
+            allOptions[OptionCount + i] = options[i]; // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+            removeAllLeading(allOptions[OptionCount + i], '-');
+        }
+        return { id_, description_, usage_, allOptions };
+    }
+
+    /// @brief Set the types of the arguments of the command
+    template <typename... Arguments>
+    [[nodiscard]] constexpr FixedCommandImpl<std::tuple<Arguments...>, OptionCount> withArgs() const
+    {
+        return { id_, description_, usage_, options_ };
+    }
+
+    [[nodiscard]] constexpr std::string_view id() const { return id_; }
+    [[nodiscard]] constexpr std::string_view description() const { return description_; }
+    [[nodiscard]] constexpr std::string_view usage() const { return usage_; }
+    [[nodiscard]] constexpr const Options& options() const { return options_; }
+
+    static constexpr std::size_t getMaxArgCount() { return std::tuple_size_v<CommandTypes>; }
+    static constexpr std::size_t getRequiredArgCount() { return FixedArguments<CommandTypes>::requiredCount; }
+
+    /**
+     * @brief Get the bit of an option in a parsed command
+     * @param option The option without leading dashes
+     * @return Its position in the options or std::nullopt if the command does not have it
+     */
+    [[nodiscard]] constexpr std::optional<std::size_t> optionIndex(std::string_view option) const
+    {
+        for (std::size_t i = 0; i < OptionCount; ++i) {
+            if (options_[i] == option) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    std::string_view id_ {};
+    std::string_view description_ {};
+    std::string_view usage_ {};
+    Options options_ {};
+};
+
+template <typename T>
+struct FixedArgumentsOf;
+
+template <typename... Commands>
+struct FixedArgumentsOf<std::tuple<Commands...>> {
+    using type = std::tuple<typename Commands::ArgumentsType...>;
+};
+
+/**
+ * @brief Convert an argument of a fixed command without allocating or throwing
+ * @return Whether the argument was valid
+ */
+template <typename ArgumentType>
+bool convertFixedArgument(std::string_view text, ArgumentType& argument)
+{
+    if constexpr (isOptional<ArgumentType>::value) {
+        typename ArgumentType::value_type value {};
+        if (!convertFixedArgument(text, value)) {
+            return false;
+        }
+        argument = value;
+        return true;
+    } else if constexpr (std::is_same_v<ArgumentType, std::string_view>) {
+        argument = text;
+        return true;
+    } else if constexpr (std::is_same_v<ArgumentType, bool>) {
+        const auto value = booleanKeywords.find(text);
+        argument = value.value_or(false);
+        return value.has_value();
+    } else if constexpr (std::is_arithmetic_v<ArgumentType>) {
+        return convertNumber(text, argument) == std::errc {};
+    } else if constexpr (hasParseValue<ArgumentType>::value) {
+        return parseValue(text, argument) == std::errc {};
+    } else {
+        static constexpr KeywordTable keywords { argumentKeywords(ArgumentType {}) };
+        static_assert(keywords.isPerfect(), "Argument keywords must be unique ignoring case");
+        const auto value = keywords.find(text);
+        if (value) {
+            argument = *value;
+        }
+        return value.has_value();
+    }
+}
+} // namespace details
+
+/// @brief The first problem found by a fixed-capacity parse, see `UnparsedCommand::parseFixed`
+struct FixedParseError {
+    ParseErrorKind kind {};
+    /// @brief The index of the offending word in argv, or argc for missing arguments
+    std::size_t position {};
+};
+
+/**
+ * @brief A command parsed into storage of a size known at compile time: a bit per option and a view into argv per
+ *        string argument. Parsing allocates nothing, throws nothing, prints nothing and stops at the first problem,
+ *        so that its time only depends on the length of the command line, which is bounded by `MaxWords`
+ *
+ * Unlike `ParsedCommandImpl`, unknown options are a problem rather than ignored, as they cannot be stored.
+ * @tparam T A tuple with the fixed commands, see `UnparsedCommand::createFixed`
+ * @tparam MaxWords The most words the command line may have after the program name, including the command ID
+ * @warning The commands and argv must outlive it
+ */
+template <typename T, std::size_t MaxWords>
+class FixedParsedCommandImpl
+{
+public:
+    static_assert(MaxWords > 0, "The command line must have room for at least the command ID");
+
+    FixedParsedCommandImpl(int argc, char* argv[], const T& unparsedCommands)
+        : commands_ { &unparsedCommands }
+    {
+        if (argc < 2) {
+            error_ = { ParseErrorKind::noCommand, 1 };
+            return;
+        }
+        if (static_cast<std::size_t>(argc) - 1 > MaxWords) {
+            error_ = { ParseErrorKind::tooManyWords, MaxWords + 1 };
+            return;
+        }
+        commandId_ = argv[1];
+        details::visitTupleWithIndex(unparsedCommands, [argc, argv, this](const auto& command, auto index) {
+            if (!commandIndex_ && !error_ && command.id() == commandId_) {
+                parseCommand(command, std::get<index>(arguments_), argc, argv);
+                commandIndex_ = error_ ? std::nullopt : std::optional<std::size_t> { index };
+            }
+        });
+        if (!commandIndex_ && !error_) {
+            error_ = { ParseErrorKind::unknownCommand, 1 };
+        }
+    }
+
+    /**
+     * @brief Check if the parsed command is the supplied one
+     * @param command
+     * @return Whether the command was parsed
+     */
+    template <typename CommandType>
+    [[nodiscard]] bool is(const CommandType& command) const
+    {
+        static_assert(
+            details::typeInTuple<CommandType, T>::value,
+            "The specified command was not included in the tuple of commands passed when calling "
+            "UnparsedCommand::parseFixed");
+        return commandIndex_ && command.id() == commandId_;
+    }
+
+    /**
+     * @brief Get the parsed arguments of the supplied command, with string arguments as views into argv
+     * @param command A command for which `is` is true
+     * @return A command-specific tuple with the parsed arguments, default constructed if `is` is false
+     */
+    template <typename CommandType>
+    [[nodiscard]] typename CommandType::ArgumentsType getArgs(const CommandType& command) const
+    {
+        using ArgumentsType = typename CommandType::ArgumentsType;
+        ArgumentsType argsToReturn {};
+        if (!is(command)) {
+            return argsToReturn;
+        }
+        details::visitTupleWithIndex(arguments_, [&argsToReturn, this](const auto& arguments, auto index) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(arguments)>, ArgumentsType>) {
+                if (index == *commandIndex_) {
+                    argsToReturn = arguments;
+                }
+            }
+        });
+        return argsToReturn;
+    }
+
+    /**
+     * @brief Check if the supplied option was encountered for the parsed command
+     * @param option The option, with or without leading dashes
+     * @return true if the option was encountered, false otherwise
+     */
+    [[nodiscard]] bool hasOption(std::string_view option) const
+    {
+        details::removeAllLeading(option, '-');
+        bool found {};
+        details::visitTupleWithIndex(*commands_, [&found, option, this](const auto& command, auto index) {
+            if (commandIndex_ == index) {
+                const auto bit = command.optionIndex(option);
+                found = bit && (options_ & (details::OptionMask { 1 } << *bit)) != 0;
+            }
+        });
+        return found;
+    }
+
+    /**
+     * @brief Get the index of the parsed command in the tuple of commands
+     * @return The index of the parsed command or std::nullopt if no command was parsed
+     */
+    [[nodiscard]] std::optional<std::size_t> commandIndex() const { return commandIndex_; }
+
+    /// @brief Get the problem that stopped the parse, std::nullopt if a command was parsed
+    [[nodiscard]] std::optional<FixedParseError> error() const { return error_; }
+
+private:
+    const T* commands_ {};
+    typename details::FixedArgumentsOf<T>::type arguments_ {};
+    details::OptionMask options_ {};
+    std::string_view commandId_ {};
+    std::optional<std::size_t> commandIndex_ {};
+    std::optional<FixedParseError> error_ {};
+
+    template <typename CommandType>
+    void parseCommand(
+        const CommandType& command,
+        typename CommandType::ArgumentsType& arguments,
+        int argc,
+        char* argv[])
+    {
+        constexpr auto maxArgCount = CommandType::getMaxArgCount();
+        std::array<std::string_view, maxArgCount> unparsedArgs {};
+        std::array<std::size_t, maxArgCount> positions {};
+        std::size_t argCount {};
+        bool optionsEnded {};
+        for (int i = 2; i < argc && !error_; ++i) {
+            const std::string_view word { argv[i] }; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            const auto position = static_cast<std::size_t>(i);
+            const auto token = details::lexWord(word, optionsEnded);
+            switch (token.kind) {
+            case details::TokenKind::endOfOptions:
+                optionsEnded = true;
+                break;
+            case details::TokenKind::shortOptions:
+            case details::TokenKind::longOption:
+            case details::TokenKind::longOptionWithValue:
+                matchOption(command, token, word, position);
+                break;
+            case details::TokenKind::argument:
+                if (argCount == maxArgCount) {
+                    error_ = { ParseErrorKind::wrongArgumentCount, position };
+                    break;
+                }
+                unparsedArgs[argCount] = token.text(word); // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+                positions[argCount] = position; // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+                ++argCount;
+                break;
+            }
+        }
+        if (error_) {
+            return;
+        }
+        if (argCount < CommandType::getRequiredArgCount()) {
+            error_ = { ParseErrorKind::wrongArgumentCount, static_cast<std::size_t>(argc) };
+            return;
+        }
+        // Omitted optional arguments are left empty
+        details::visitTupleWithIndex(arguments, [&unparsedArgs, &positions, argCount, this](auto& arg, auto index) {
+            if (index < argCount && !error_ && !details::convertFixedArgument(std::get<index>(unparsedArgs), arg)) {
+                error_ = { ParseErrorKind::invalidArgument, std::get<index>(positions) };
+            }
+        });
+    }
+
+    /// @brief Set the bits of an option word, matching it as a stand-alone option before as compound short options
+    template <typename CommandType>
+    void matchOption(
+        const CommandType& command,
+        const details::Token& token,
+        std::string_view word,
+        std::size_t position)
+    {
+        const auto name = token.text(word);
+        if (const auto bit = command.optionIndex(name)) {
+            // An attached value enables the option only if true, same as `ParsedCommandImpl`
+            bool enabled { true };
+            if (token.kind == details::TokenKind::longOptionWithValue
+                && !details::convertFixedArgument(token.value(word), enabled)) {
+                error_ = { ParseErrorKind::invalidArgument, position };
+                return;
+            }
+            options_ |= enabled ? details::OptionMask { 1 } << *bit : details::OptionMask {};
+            return;
+        }
+        if (token.kind != details::TokenKind::shortOptions) {
+            error_ = { ParseErrorKind::unknownOption, position };
+            return;
+        }
+        details::OptionMask shortOptions {};
+        for (std::size_t i = 0; i < name.size(); ++i) {
+            const auto bit = command.optionIndex(name.substr(i, 1));
+            if (!bit) {
+                error_ = { ParseErrorKind::unknownOption, position };
+                return;
+            }
+            shortOptions |= details::OptionMask { 1 } << *bit;
+        }
+        options_ |= shortOptions;
+    }
+};
+
+namespace UnparsedCommand {
+/**
+ * @brief Create a command to parse without allocating, see `parseFixed`
+ * @param id The command ID, e.g. a string literal, which is not copied
+ * @param description The command description, which is not copied
+ * @param usage The command usage, which is not copied
+ * @return A command without options or arguments, to add them with `withOptions` and `withArgs`
+ */
+constexpr details::FixedCommandImpl<std::tuple<>, 0>
+createFixed(std::string_view id, std::string_view description, std::string_view usage = "")
+{
+    return { id, description, usage, {} };
+}
+
+/**
+ * @brief Helper function to parse a command into fixed-capacity storage, e.g. on targets without a heap
+ * @tparam MaxWords The most words the command line may have after the program name, including the command ID
+ * @return A parsed command, holding its first problem if no command was parsed
+ */
+template <std::size_t MaxWords, typename T>
+[[nodiscard]] FixedParsedCommandImpl<T, MaxWords> parseFixed(int argc, char* argv[], const T& unparsedCommands)
+{
+    return FixedParsedCommandImpl<T, MaxWords> { argc, argv, unparsedCommands };
+}
+} // namespace UnparsedCommand
@@ -0,0 +1,478 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace details {
+/**
+ * @brief A binary frame of a parsed command, all integers little-endian:
+ * - `magic`: "CPFR"
+ * - `version`: u8
+ * - `size`: u32, of the whole frame
+ * - `command`: u16, the index of the command in the tuple of commands, `noCommand` if none was parsed
+ * - `optionBytes`: u16, followed by a bitset of the enabled options in the sorted options of the command
+ * - the arguments of the command:
+ *   - `std::string`: u32 length followed by the characters
+ *   - `bool`: u8
+ *   - integers and enums: LEB128, i.e. 7 bits per byte from the lowest with the high bit set on all but the last byte,
+ *     zigzag encoded if signed so that small negative values take one byte too, and range-checked when read
+ *   - `float` and `double`: their IEEE 754 bits as u32 and u64, `long double`: its native bytes
+ *   - `std::optional<T>`: u8 presence followed by the value if present
+ *   - `std::vector<T>`: u32 count followed by the values
+ */
+namespace frame {
+constexpr std::string_view magic { "CPFR" };
+constexpr std::uint8_t version { 2 };
+constexpr std::size_t headerSize { magic.size() + sizeof(std::uint8_t) + sizeof(std::uint32_t) };
+constexpr std::uint16_t noCommand { std::numeric_limits<std::uint16_t>::max() };
+} // namespace frame
+
+template <typename T>
+struct isFrameScalar
+    : std::bool_constant<std::is_integral_v<T> || std::is_enum_v<T> || std::is_floating_point_v<T>> {
+};
+
+/// @brief The type a frame argument is read as, i.e. strings as views into the frame
+template <typename T>
+struct FrameViewType {
+    using type = T;
+};
+
+template <>
+struct FrameViewType<std::string> {
+    using type = std::string_view;
+};
+
+template <typename T>
+struct FrameViewType<std::optional<T>> {
+    using type = std::optional<typename FrameViewType<T>::type>;
+};
+
+template <typename T>
+struct FrameViewType<std::vector<T>> {
+    using type = std::vector<typename FrameViewType<T>::type>;
+};
+
+template <typename... Ts>
+struct FrameViewType<std::tuple<Ts...>> {
+    using type = std::tuple<typename FrameViewType<Ts>::type...>;
+};
+
+class FrameWriter
+{
+public:
+    explicit FrameWriter(std::string& frame)
+        : frame_ { frame }
+    {
+    }
+
+    template <typename Integer>
+    void writeInteger(Integer value, std::size_t bytes)
+    {
+        const auto bits = static_cast<std::uint64_t>(value);
+        for (std::size_t i = 0; i < bytes; ++i) {
+            frame_.push_back(static_cast<char>((bits >> (8U * i)) & 0xffU));
+        }
+    }
+
+    /// @brief Write an integer in as few bytes as its value needs, see the integers of `details::frame`
+    template <typename Integer>
+    void writeVarint(Integer value)
+    {
+        auto bits = static_cast<std::uint64_t>(value);
+        if constexpr (std::is_signed_v<Integer>) {
+            const auto wide = static_cast<std::int64_t>(value);
+            bits = (static_cast<std::uint64_t>(wide) << 1U) ^ static_cast<std::uint64_t>(wide >> 63U);
+        }
+        for (; bits >= 0x80U; bits >>= 7U) {
+            frame_.push_back(static_cast<char>((bits & 0x7fU) | 0x80U));
+        }
+        frame_.push_back(static_cast<char>(bits));
+    }
+
+    void writeBytes(std::string_view bytes) { frame_.append(bytes); }
+
+    template <typename T>
+    void writeValue(const T& value)
+    {
+        if constexpr (std::is_same_v<T, std::string>) {
+            writeInteger(value.size(), sizeof(std::uint32_t));
+            writeBytes(value);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            writeInteger(value ? 1U : 0U, sizeof(std::uint8_t));
+        } else if constexpr (std::is_same_v<T, float>) {
+            std::uint32_t bits {};
+            std::memcpy(&bits, &value, sizeof(bits));
+            writeInteger(bits, sizeof(bits));
+        } else if constexpr (std::is_same_v<T, double>) {
+            std::uint64_t bits {};
+            std::memcpy(&bits, &value, sizeof(bits));
+            writeInteger(bits, sizeof(bits));
+        } else if constexpr (std::is_same_v<T, long double>) {
+            std::array<char, sizeof(long double)> bytes {};
+            std::memcpy(bytes.data(), &value, bytes.size());
+            writeBytes({ bytes.data(), bytes.size() });
+        } else if constexpr (std::is_enum_v<T>) {
+            writeVarint(static_cast<std::underlying_type_t<T>>(value));
+        } else if constexpr (std::is_integral_v<T>) {
+            writeVarint(value);
+        } else if constexpr (isOptional<T>::value) {
+            writeInteger(value ? 1U : 0U, sizeof(std::uint8_t));
+            if (value) {
+                writeValue(*value);
+            }
+        } else if constexpr (isVector<T>::value) {
+            writeInteger(value.size(), sizeof(std::uint32_t));
+            for (const auto& element : value) {
+                writeValue(static_cast<const typename T::value_type&>(element));
+            }
+        } else {
+            visitTuple(value, [this](const auto& element) { writeValue(element); });
+        }
+    }
+
+private:
+    std::string& frame_;
+};
+
+/// @brief Reads a frame in place, every read checking that it stays within the frame
+class FrameReader
+{
+public:
+    explicit FrameReader(std::string_view frame)
+        : frame_ { frame }
+    {
+    }
+
+    [[nodiscard]] bool ok() const { return ok_; }
+    [[nodiscard]] std::size_t position() const { return position_; }
+
+    std::uint64_t readInteger(std::size_t bytes)
+    {
+        std::uint64_t value {};
+        if (const auto data = readBytes(bytes); ok_) {
+            for (std::size_t i = 0; i < bytes; ++i) {
+                value |= std::uint64_t { static_cast<unsigned char>(data[i]) } << (8U * i);
+            }
+        }
+        return value;
+    }
+
+    /// @brief Read an integer written by `FrameWriter::writeVarint`, which fails the read if it does not fit `Integer`
+    template <typename Integer>
+    Integer readVarint()
+    {
+        constexpr unsigned lastShift { 63 };
+        std::uint64_t bits {};
+        for (unsigned shift = 0; ok_; shift += 7U) {
+            const auto byte = readInteger(sizeof(std::uint8_t));
+            // The tenth byte only has room for the highest of the 64 bits
+            ok_ = ok_ && (shift < lastShift || byte <= 1U);
+            bits |= (byte & 0x7fU) << shift;
+            if ((byte & 0x80U) == 0) {
+                break;
+            }
+        }
+        if constexpr (std::is_signed_v<Integer>) {
+            const auto value = static_cast<std::int64_t>(bits >> 1U) ^ -static_cast<std::int64_t>(bits & 1U);
+            ok_ = ok_ && value >= std::numeric_limits<Integer>::min() && value <= std::numeric_limits<Integer>::max();
+            return ok_ ? static_cast<Integer>(value) : Integer {};
+        } else {
+            ok_ = ok_ && bits <= std::numeric_limits<Integer>::max();
+            return ok_ ? static_cast<Integer>(bits) : Integer {};
+        }
+    }
+
+    std::string_view readBytes(std::size_t size)
+    {
+        if (!ok_ || size > frame_.size() - position_) {
+            ok_ = false;
+            return {};
+        }
+        const auto bytes = frame_.substr(position_, size);
+        position_ += size;
+        return bytes;
+    }
+
+    /**
+     * @brief Read a value of type `T`
+     * @param value Where the value is read to, or nullptr to only check that it is well-formed
+     */
+    template <typename T>
+    void readValue(typename FrameViewType<T>::type* value)
+    {
+        if constexpr (std::is_same_v<T, std::string>) {
+            const auto string = readBytes(static_cast<std::size_t>(readInteger(sizeof(std::uint32_t))));
+            assign(value, string);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            const auto byte = readInteger(sizeof(std::uint8_t));
+            ok_ = ok_ && byte <= 1;
+            assign(value, byte == 1);
+        } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            using Bits = std::conditional_t<std::is_same_v<T, float>, std::uint32_t, std::uint64_t>;
+            const auto bits = static_cast<Bits>(readInteger(sizeof(Bits)));
+            T floatingPoint {};
+            std::memcpy(&floatingPoint, &bits, sizeof(bits));
+            assign(value, floatingPoint);
+        } else if constexpr (std::is_same_v<T, long double>) {
+            const auto bytes = readBytes(sizeof(long double));
+            long double floatingPoint {};
+            if (ok_) {
+                std::memcpy(&floatingPoint, bytes.data(), bytes.size());
+            }
+            assign(value, floatingPoint);
+        } else if constexpr (std::is_enum_v<T>) {
+            using Underlying = std::underlying_type_t<T>;
+            assign(value, static_cast<T>(readVarint<Underlying>()));
+        } else if constexpr (std::is_integral_v<T>) {
+            assign(value, readVarint<T>());
+        } else if constexpr (isOptional<T>::value) {
+            const auto present = readInteger(sizeof(std::uint8_t));
+            ok_ = ok_ && present <= 1;
+            if (present == 1) {
+                typename FrameViewType<typename T::value_type>::type element {};
+                readValue<typename T::value_type>(value != nullptr ? &element : nullptr);
+                assign(value, std::move(element));
+            }
+        } else if constexpr (isVector<T>::value) {
+            const auto count = static_cast<std::size_t>(readInteger(sizeof(std::uint32_t)));
+            // Every element takes at least one byte, so a forged count cannot reserve more than the frame holds
+            if (value != nullptr && ok_ && count <= frame_.size() - position_) {
+                value->reserve(count);
+            }
+            for (std::size_t i = 0; i < count && ok_; ++i) {
+                typename FrameViewType<typename T::value_type>::type element {};
+                readValue<typename T::value_type>(value != nullptr ? &element : nullptr);
+                if (value != nullptr) {
+                    value->push_back(std::move(element));
+                }
+            }
+        } else {
+            readTuple<T>(value, std::make_index_sequence<std::tuple_size_v<T>> {});
+        }
+    }
+
+private:
+    std::string_view frame_ {};
+    std::size_t position_ {};
+    bool ok_ { true };
+
+    template <typename Value, typename Read>
+    static void assign(Value* value, Read&& read)
+    {
+        if (value != nullptr) {
+            *value = std::forward<Read>(read);
+        }
+    }
+
+    template <typename T, std::size_t... Indices>
+    void readTuple([[maybe_unused]] typename FrameViewType<T>::type* value, std::index_sequence<Indices...>)
+    {
+        (readValue<std::tuple_element_t<Indices, T>>(value != nullptr ? &std::get<Indices>(*value) : nullptr), ...);
+    }
+};
+
+template <typename T>
+constexpr bool isFrameSerializable()
+{
+    if constexpr (isOptional<T>::value || isVector<T>::value) {
+        return isFrameSerializable<typename T::value_type>();
+    } else {
+        return std::is_same_v<T, std::string> || isFrameScalar<T>::value;
+    }
+}
+
+template <typename T>
+struct areFrameSerializable;
+
+template <typename... Ts>
+struct areFrameSerializable<std::tuple<Ts...>> : std::bool_constant<(isFrameSerializable<Ts>() && ...)> {
+};
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief Serialize a parsed command into a binary frame, so that a process other than the parsing one can use it
+ *        without parsing again, see `CommandFrame`. Unknown options are not serialized
+ * @param parsedCommand The parsed command
+ * @param unparsedCommands The tuple of unparsed commands it was parsed with, which the reader must use too
+ * @param frame Where the frame is appended to, e.g. a buffer reused between commands
+ */
+template <typename T, typename Instrumentation>
+void serialize(
+    const ParsedCommandImpl<T, Instrumentation>& parsedCommand, const T& unparsedCommands, std::string& frame)
+{
+    static_assert(
+        std::tuple_size_v<T> < details::frame::noCommand, "Too many commands for the command index of a frame");
+    const auto frameStart = frame.size();
+    details::FrameWriter writer { frame };
+    writer.writeBytes(details::frame::magic);
+    writer.writeInteger(details::frame::version, sizeof(std::uint8_t));
+    writer.writeInteger(0U, sizeof(std::uint32_t)); // The size, filled in once known
+    const auto commandIndex = parsedCommand.commandIndex();
+    writer.writeInteger(commandIndex.value_or(details::frame::noCommand), sizeof(std::uint16_t));
+    details::visitTupleWithIndex(unparsedCommands, [&parsedCommand, &writer, commandIndex](auto&& command, auto index) {
+        if (index != commandIndex) {
+            return;
+        }
+        using ArgumentsType = typename std::decay_t<decltype(command)>::ArgumentsType;
+        static_assert(
+            details::areFrameSerializable<ArgumentsType>::value,
+            "Only strings, bools, numbers and enums, optionally within std::optional or std::vector, can be "
+            "serialized");
+        std::string options((command.options().size() + 7) / 8, '\0');
+        for (const auto& option : command.options()) {
+            if (parsedCommand.hasOption(option)) {
+                // The position of the option in the sorted options of the command is its bit in the option bitset
+                const auto rank = command.optionIndex(option).value_or(0);
+                auto& byte = options[rank / 8];
+                byte = static_cast<char>(static_cast<unsigned char>(byte) | (1U << (rank % 8)));
+            }
+        }
+        writer.writeInteger(options.size(), sizeof(std::uint16_t));
+        writer.writeBytes(options);
+        writer.writeValue(parsedCommand.getArgs(command));
+    });
+    if (!commandIndex) {
+        writer.writeInteger(0U, sizeof(std::uint16_t));
+    }
+    std::string size {};
+    details::FrameWriter { size }.writeInteger(frame.size() - frameStart, sizeof(std::uint32_t));
+    frame.replace(frameStart + details::frame::magic.size() + sizeof(std::uint8_t), size.size(), size);
+}
+
+/**
+ * @brief Get the size of the frame at the start of a buffer, e.g. to know how much more to receive from a socket
+ * @param bytes The start of the buffer
+ * @return The size of the frame or std::nullopt if its header is not complete yet
+ */
+inline std::optional<std::size_t> frameSize(std::string_view bytes)
+{
+    if (bytes.size() < details::frame::headerSize) {
+        return std::nullopt;
+    }
+    details::FrameReader reader { bytes.substr(details::frame::magic.size() + sizeof(std::uint8_t)) };
+    return static_cast<std::size_t>(reader.readInteger(sizeof(std::uint32_t)));
+}
+
+/**
+ * @brief A parsed command read in place from a frame written by `serialize`, e.g. in a shared memory segment or a
+ *        socket buffer. The frame is validated once when constructed and string arguments are views into it
+ * @tparam T A tuple with the unparsed commands, the same as the ones the frame was serialized with
+ * @warning The frame and the commands must outlive the command frame
+ */
+template <typename T>
+class CommandFrame
+{
+public:
+    /**
+     * @brief Read a frame
+     * @param frame The frame, whose errors (e.g. a different version or truncation) are printed to stderr and leave
+     *        the command frame without a command
+     * @param unparsedCommands A tuple with the unparsed commands
+     */
+    CommandFrame(std::string_view frame, const T& unparsedCommands)
+        : commands_ { &unparsedCommands }
+    {
+        details::FrameReader reader { frame };
+        const auto magic = reader.readBytes(details::frame::magic.size());
+        const auto version = reader.readInteger(sizeof(std::uint8_t));
+        const auto size = reader.readInteger(sizeof(std::uint32_t));
+        if (!reader.ok() || magic != details::frame::magic || version != details::frame::version) {
+            std::cerr << "Not a command frame of version " << +details::frame::version << std::endl;
+            return;
+        }
+        if (size > frame.size()) {
+            std::cerr << "Truncated command frame of " << frame.size() << " bytes out of " << size << std::endl;
+            return;
+        }
+        frame_ = frame.substr(0, static_cast<std::size_t>(size));
+        reader = details::FrameReader { frame_ };
+        reader.readBytes(details::frame::headerSize);
+        const auto commandIndex = static_cast<std::size_t>(reader.readInteger(sizeof(std::uint16_t)));
+        options_ = reader.readBytes(static_cast<std::size_t>(reader.readInteger(sizeof(std::uint16_t))));
+        argumentsStart_ = reader.position();
+        // Walk through the arguments of the command once, so that reading them later needs no checks
+        details::visitTupleWithIndex(*commands_, [&reader, commandIndex](auto&& command, auto index) {
+            if (index == commandIndex) {
+                reader.readValue<typename std::decay_t<decltype(command)>::ArgumentsType>(nullptr);
+            }
+        });
+        if (!reader.ok() || reader.position() != frame_.size() || commandIndex == details::frame::noCommand
+            || commandIndex >= std::tuple_size_v<T>) {
+            if (commandIndex != details::frame::noCommand) {
+                std::cerr << "Malformed command frame" << std::endl;
+            }
+            return;
+        }
+        commandIndex_ = commandIndex;
+    }
+
+    /**
+     * @brief Get the position of the command in the tuple of commands
+     * @return The index of the command or std::nullopt if no command was parsed or the frame is invalid
+     */
+    [[nodiscard]] std::optional<std::size_t> commandIndex() const { return commandIndex_; }
+
+    /**
+     * @brief Check if the frame holds the supplied (unparsed) command
+     * @return Whether the frame holds the command
+     */
+    template <typename CommandType>
+    [[nodiscard]] bool is(const CommandType& command) const
+    {
+        bool found {};
+        details::visitTupleWithIndex(*commands_, [&command, &found, this](auto&& candidate, auto index) {
+            found = found || (index == commandIndex_ && candidate.id() == command.id());
+        });
+        return found;
+    }
+
+    /**
+     * @brief Check if the supplied option was enabled for the command
+     * @param option The option, with or without leading dashes
+     * @return true if the option was enabled, false otherwise
+     */
+    [[nodiscard]] bool hasOption(std::string_view option) const
+    {
+        details::removeAllLeading(option, '-');
+        bool enabled {};
+        details::visitTupleWithIndex(*commands_, [option, &enabled, this](auto&& command, auto index) {
+            if (index != commandIndex_) {
+                return;
+            }
+            const auto rank = command.optionIndex(option);
+            enabled = rank && *rank / 8 < options_.size()
+                && (static_cast<unsigned char>(options_[*rank / 8]) & (1U << (*rank % 8))) != 0;
+        });
+        return enabled;
+    }
+
+    /**
+     * @brief Get the arguments of the supplied command, reading them from the frame
+     * @return A command-specific tuple with the arguments, with views into the frame instead of `std::string`s
+     */
+    template <typename CommandType>
+    [[nodiscard]] auto getArgs(const CommandType& command) const
+    {
+        assert((is(command)) && "Command not found"); // NOLINT (cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+        static_cast<void>(command);
+        using ArgumentsType = typename CommandType::ArgumentsType;
+        typename details::FrameViewType<ArgumentsType>::type arguments {};
+        details::FrameReader reader { frame_ };
+        reader.readBytes(argumentsStart_);
+        reader.readValue<ArgumentsType>(&arguments);
+        return arguments;
+    }
+
+private:
+    const T* commands_ {};
+    std::string_view frame_ {};
+    std::string_view options_ {};
+    std::size_t argumentsStart_ {};
+    std::optional<std::size_t> commandIndex_ {};
+};
+} // namespace UnparsedCommand
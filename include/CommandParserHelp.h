@@ -0,0 +1,227 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+
+namespace UnparsedCommand {
+/**
+ * @brief Get the width of the terminal, from the terminal itself or otherwise from the `COLUMNS` variable
+ * @param fileDescriptor The file descriptor the help is written to
+ * @return The number of columns, 80 if it is not known, e.g. when the output is redirected to a file
+ */
+COMMAND_PARSER_INLINE std::size_t terminalWidth(int fileDescriptor = STDOUT_FILENO);
+
+#if COMMAND_PARSER_DEFINITIONS
+COMMAND_PARSER_INLINE std::size_t terminalWidth(int fileDescriptor)
+{
+    winsize size {};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+    if (::ioctl(fileDescriptor, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+        return size.ws_col;
+    }
+    constexpr std::size_t defaultWidth { 80 };
+    const std::string_view columns { std::getenv("COLUMNS") != nullptr ? std::getenv("COLUMNS") : "" };
+    std::size_t width {};
+    const auto [end, error] = std::from_chars(columns.data(), columns.data() + columns.size(), width);
+    return error == std::errc {} && end == columns.data() + columns.size() && width > 0 ? width : defaultWidth;
+}
+#endif
+} // namespace UnparsedCommand
+
+namespace details {
+/**
+ * @brief Adapt where help is written to a callable taking an `std::string_view`
+ * @param output An `std::FILE*`, an `std::ostream` or a callable taking an `std::string_view`
+ */
+template <typename Output>
+auto helpWriter(Output&& output)
+{
+    using OutputType = std::decay_t<Output>;
+    if constexpr (std::is_base_of_v<std::ostream, OutputType>) {
+        return [&output](std::string_view text) {
+            output.write(text.data(), static_cast<std::streamsize>(text.size()));
+        };
+    } else if constexpr (std::is_same_v<OutputType, std::FILE*>) {
+        return [file = output](std::string_view text) { std::fwrite(text.data(), 1, text.size(), file); };
+    } else {
+        return [&output](std::string_view text) { output(text); };
+    }
+}
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief Renders the help of a set of commands straight to the output, wrapping descriptions to the output width
+ *        Column widths and the lookup of commands by ID are computed once, so that rendering the help of a single
+ *        command (e.g. for `tool help put`) or of a few of them takes time proportional to the output, regardless of
+ *        the command count
+ * @tparam T A tuple with the unparsed commands
+ * @warning The commands must outlive the renderer
+ */
+template <typename T>
+class HelpRenderer
+{
+public:
+    /**
+     * @brief Lay out the help of the supplied commands
+     * @param commands A tuple with the unparsed commands
+     * @param width The width descriptions are wrapped to, see `terminalWidth`
+     */
+    explicit HelpRenderer(const T& commands, std::size_t width = terminalWidth())
+        : commands_ { &commands }
+        , width_ { width }
+    {
+        // Same layout as `ParsedCommandImpl::help`, so that both agree when nothing needs to be wrapped
+        details::visitTupleWithIndex(commands, [this](auto&& command, auto index) {
+            constexpr std::size_t separatorSize { 1 };
+            idAndUsageWidth_
+                = std::max(idAndUsageWidth_, command.id().size() + command.usage().size() + separatorSize);
+            // The first command to claim an ID or alias wins, same as when parsing
+            indices_.emplace(command.id(), index);
+            for (const auto& alias : command.aliases()) {
+                indices_.emplace(alias, index);
+            }
+        });
+    }
+
+    /**
+     * @brief Render the help of all commands
+     * @param output An `std::FILE*`, an `std::ostream` or a callable taking an `std::string_view`
+     */
+    template <typename Output>
+    void render(Output&& output) const
+    {
+        auto write = details::helpWriter(std::forward<Output>(output));
+        details::visitTuple(*commands_, [this, &write](auto&& command) { renderCommand(command, write); });
+    }
+
+    /**
+     * @brief Render the help of a single command
+     * @param commandId The ID or an alias of the command
+     * @param output An `std::FILE*`, an `std::ostream` or a callable taking an `std::string_view`
+     * @return Whether there is such a command, otherwise nothing is rendered
+     */
+    template <typename Output>
+    bool render(std::string_view commandId, Output&& output) const
+    {
+        const auto index = indices_.find(commandId);
+        if (index == indices_.end()) {
+            return false;
+        }
+        auto write = details::helpWriter(std::forward<Output>(output));
+        renderIndex(index->second, write);
+        return true;
+    }
+
+    /**
+     * @brief Render the help of several commands, aligned as when rendering all of them
+     * @param commandIds The IDs or aliases of the commands, e.g. an `std::vector<std::string_view>`, rendered in
+     *        this order
+     * @param output An `std::FILE*`, an `std::ostream` or a callable taking an `std::string_view`
+     * @return Whether there is a command for every ID, the unknown ones are skipped
+     */
+    template <
+        typename CommandIds,
+        typename Output,
+        typename = std::enable_if_t<!std::is_convertible_v<const CommandIds&, std::string_view>>>
+    bool render(const CommandIds& commandIds, Output&& output) const
+    {
+        auto write = details::helpWriter(std::forward<Output>(output));
+        bool allFound { true };
+        for (const auto& commandId : commandIds) {
+            const auto index = indices_.find(std::string_view { commandId });
+            if (index == indices_.end()) {
+                allFound = false;
+                continue;
+            }
+            renderIndex(index->second, write);
+        }
+        return allFound;
+    }
+
+private:
+    const T* commands_ {};
+    std::size_t width_ {};
+    std::size_t idAndUsageWidth_ {};
+    std::unordered_map<std::string_view, std::size_t> indices_ {};
+
+    template <typename Writer>
+    void renderIndex(std::size_t index, Writer& write) const
+    {
+        static constexpr auto renderers = makeRenderers<Writer>(std::make_index_sequence<std::tuple_size_v<T>> {});
+        renderers[index](*this, write);
+    }
+
+    template <std::size_t Index, typename Writer>
+    static void renderAt(const HelpRenderer& renderer, Writer& write)
+    {
+        renderer.renderCommand(std::get<Index>(*renderer.commands_), write);
+    }
+
+    template <typename Writer, std::size_t... Indices>
+    static constexpr auto makeRenderers(std::index_sequence<Indices...>)
+    {
+        using Renderer = void (*)(const HelpRenderer&, Writer&);
+        return std::array<Renderer, sizeof...(Indices)> { &renderAt<Indices, Writer>... };
+    }
+
+    template <typename Writer>
+    static void pad(Writer& write, std::size_t count)
+    {
+        constexpr std::string_view spaces { "                                " };
+        for (; count > spaces.size(); count -= spaces.size()) {
+            write(spaces);
+        }
+        write(spaces.substr(0, count));
+    }
+
+    template <typename CommandType, typename Writer>
+    void renderCommand(const CommandType& command, Writer& write) const
+    {
+        write(" ");
+        write(command.id());
+        write(" ");
+        write(command.usage());
+        pad(write, idAndUsageWidth_ - command.id().size() - command.usage().size());
+        // Narrow outputs still get a readable description, even if its lines are then wrapped by the terminal
+        constexpr std::size_t minDescriptionWidth { 20 };
+        const auto descriptionColumn = idAndUsageWidth_ + 2;
+        const auto descriptionWidth
+            = width_ > descriptionColumn + minDescriptionWidth ? width_ - descriptionColumn : minDescriptionWidth;
+        std::string_view description { command.description() };
+        if (description.size() <= descriptionWidth) {
+            write(description);
+            write("\n");
+            return;
+        }
+        std::size_t lineWidth {};
+        while (!description.empty()) {
+            const auto wordEnd = std::min(description.find(' '), description.size());
+            const auto word = description.substr(0, wordEnd);
+            description.remove_prefix(std::min(wordEnd + 1, description.size()));
+            if (word.empty()) {
+                continue;
+            }
+            // Words longer than the description width are not broken, they get a line of their own
+            if (lineWidth > 0 && lineWidth + 1 + word.size() > descriptionWidth) {
+                write("\n");
+                pad(write, descriptionColumn);
+                lineWidth = 0;
+            } else if (lineWidth > 0) {
+                write(" ");
+                ++lineWidth;
+            }
+            write(word);
+            lineWidth += word.size();
+        }
+        write("\n");
+    }
+};
+} // namespace UnparsedCommand
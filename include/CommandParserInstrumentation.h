@@ -0,0 +1,213 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+namespace UnparsedCommand {
+/**
+ * @brief A lock-free histogram with power-of-two buckets, i.e. bucket `i` counts values in [2^(i-1), 2^i)
+ */
+class Log2Histogram
+{
+public:
+    static constexpr std::size_t bucketCount { 65 };
+
+    /// @brief A consistent-enough copy of a histogram that may be recorded to concurrently
+    struct Snapshot {
+        std::array<std::uint64_t, bucketCount> buckets {};
+        std::uint64_t count {};
+        std::uint64_t sum {};
+        std::uint64_t max {};
+
+        /**
+         * @brief Get an upper bound of the supplied percentile
+         * @param percentile The percentile in [0, 100]
+         * @return The upper bound of the bucket the percentile falls into
+         */
+        [[nodiscard]] std::uint64_t percentile(double percentile) const
+        {
+            const auto rank = static_cast<double>(count) * percentile / 100.0;
+            std::uint64_t seen {};
+            for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+                seen += buckets[bucket];
+                if (seen > 0 && static_cast<double>(seen) >= rank) {
+                    return std::min(upperBound(bucket), max);
+                }
+            }
+            return max;
+        }
+
+        [[nodiscard]] double mean() const
+        {
+            return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+        }
+    };
+
+    void record(std::uint64_t value)
+    {
+        buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        auto max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    [[nodiscard]] Snapshot snapshot() const
+    {
+        Snapshot snapshot {};
+        for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            snapshot.buckets[bucket] = buckets_[bucket].load(std::memory_order_relaxed);
+        }
+        snapshot.count = count_.load(std::memory_order_relaxed);
+        snapshot.sum = sum_.load(std::memory_order_relaxed);
+        snapshot.max = max_.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    void reset()
+    {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    static constexpr std::size_t bucketOf(std::uint64_t value)
+    {
+        std::size_t bucket {};
+        for (; value != 0; value >>= 1U) {
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    static constexpr std::uint64_t upperBound(std::size_t bucket)
+    {
+        return bucket == 0 ? 0 : (bucket >= 64 ? std::numeric_limits<std::uint64_t>::max() : (1ULL << bucket) - 1);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucketCount> buckets_ {};
+    std::atomic<std::uint64_t> count_ {};
+    std::atomic<std::uint64_t> sum_ {};
+    std::atomic<std::uint64_t> max_ {};
+};
+
+/**
+ * @brief A sample instrumentation policy that aggregates the phase durations (in nanoseconds) and the counts of all
+ *        parses in the process into histograms, e.g. `UnparsedCommand::parse<ParseHistograms<>>(argc, argv, commands)`
+ * @tparam Tag Distinguishes independent sets of histograms, e.g. one per command set
+ */
+template <typename Tag = void>
+class ParseHistograms
+{
+public:
+    static constexpr bool enabled { true };
+    static constexpr std::size_t phaseCount { static_cast<std::size_t>(ParsePhase::helpGeneration) + 1 };
+    static constexpr std::size_t counterCount { static_cast<std::size_t>(ParseCounter::allocations) + 1 };
+    using AllocationCounter = std::size_t (*)();
+
+    void onPhase(
+        ParsePhase phase,
+        std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end)
+    {
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        const auto nanoseconds = static_cast<std::uint64_t>(std::max<decltype(duration)>(duration, 0));
+        phases()[static_cast<std::size_t>(phase)].record(nanoseconds);
+    }
+
+    void onCount(ParseCounter counter, std::size_t value)
+    {
+        // Without an allocation counter there is nothing meaningful to record
+        if (counter == ParseCounter::allocations && allocationCounter().load() == nullptr) {
+            return;
+        }
+        counters()[static_cast<std::size_t>(counter)].record(value);
+    }
+
+    static std::size_t allocationCount()
+    {
+        const auto counter = allocationCounter().load();
+        return counter != nullptr ? counter() : 0;
+    }
+
+    /**
+     * @brief Install a function returning the running number of allocations in the process, e.g. one backed by
+     *        replaced `operator new` or an allocator's statistics
+     * @param counter The allocation counter or nullptr to stop counting allocations
+     */
+    static void setAllocationCounter(AllocationCounter counter) { allocationCounter().store(counter); }
+
+    static const Log2Histogram& phase(ParsePhase phase) { return phases()[static_cast<std::size_t>(phase)]; }
+
+    static const Log2Histogram& counter(ParseCounter counter)
+    {
+        return counters()[static_cast<std::size_t>(counter)];
+    }
+
+    static void reset()
+    {
+        for (auto& histogram : phases()) {
+            histogram.reset();
+        }
+        for (auto& histogram : counters()) {
+            histogram.reset();
+        }
+    }
+
+    /**
+     * @brief Print a summary of all histograms
+     * @param stream The stream to print to
+     */
+    static void report(std::ostream& stream)
+    {
+        constexpr std::array<const char*, phaseCount> phaseNames {
+            "tokenization", "command lookup", "option matching", "argument conversion", "help generation"
+        };
+        constexpr std::array<const char*, counterCount> counterNames {
+            "tokens", "options", "arguments", "allocations"
+        };
+        const auto print = [&stream](const char* name, const Log2Histogram::Snapshot& snapshot) {
+            stream << std::left << std::setw(20) << name << " count " << snapshot.count << " mean " << snapshot.mean()
+                   << " p50 " << snapshot.percentile(50) << " p99 " << snapshot.percentile(99) << " max "
+                   << snapshot.max << std::endl;
+        };
+        stream << "Phase durations (ns):" << std::endl;
+        for (std::size_t phase = 0; phase < phaseCount; ++phase) {
+            print(phaseNames.at(phase), phases()[phase].snapshot());
+        }
+        stream << "Counts per parse:" << std::endl;
+        for (std::size_t counter = 0; counter < counterCount; ++counter) {
+            print(counterNames.at(counter), counters()[counter].snapshot());
+        }
+    }
+
+private:
+    static std::array<Log2Histogram, phaseCount>& phases()
+    {
+        static std::array<Log2Histogram, phaseCount> histograms {};
+        return histograms;
+    }
+
+    static std::array<Log2Histogram, counterCount>& counters()
+    {
+        static std::array<Log2Histogram, counterCount> histograms {};
+        return histograms;
+    }
+
+    static std::atomic<AllocationCounter>& allocationCounter()
+    {
+        static std::atomic<AllocationCounter> counter {};
+        return counter;
+    }
+};
+} // namespace UnparsedCommand
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <dlfcn.h>
+
+#include <iostream>
+#include <mutex>
+
+namespace details {
+/// @brief The symbol a plugin exports unless told otherwise, see `UnparsedCommand::PluginCommands::add`
+constexpr const char* pluginEntryPoint { "command_parser_plugin_run" };
+
+/// @brief What the host knows about a plugin command without loading it
+struct PluginCommand {
+    std::string id {};
+    std::string description {};
+    std::string usage {};
+    std::size_t requiredArgCount {};
+    std::size_t maxArgCount {};
+    std::string library {};
+    std::string symbol {};
+};
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief The signature of the function a plugin exports, called with the whole command line, i.e. the program name
+ *        followed by the command, so that the plugin parses it with its own typed command as usual
+ */
+using PluginEntryPoint = int (*)(int argc, char* argv[]);
+
+/**
+ * @brief Commands implemented in shared objects that are only loaded when the command is run. The host knows the
+ *        IDs, aliases, usage and arity of the commands, e.g. from a header with their definitions shared with the
+ *        plugins, so neither listing them in the help prompt nor rejecting a wrong number of arguments loads a
+ *        plugin
+ *
+ * A plugin exports `extern "C" int command_parser_plugin_run(int argc, char* argv[])`, which typically calls
+ * `UnparsedCommand::parse(argc, argv, std::tuple { command })` with the same command the host added.
+ * Loaded plugins stay loaded until the process exits, so that anything they hand out may refer to their code.
+ */
+class PluginCommands
+{
+public:
+    /**
+     * @brief Add a command whose implementation is in a shared object
+     * @param command The unparsed command, of which only the metadata is kept
+     * @param library The path to the shared object, as passed to `dlopen`
+     * @param symbol The function the shared object exports, see `PluginEntryPoint`
+     */
+    template <typename CommandTypes>
+    void add(
+        const details::UnparsedCommandImpl<CommandTypes>& command,
+        std::string library,
+        std::string symbol = details::pluginEntryPoint)
+    {
+        const auto index = commands_.size();
+        commands_.push_back({ command.id(),
+                              command.description(),
+                              command.usage(),
+                              command.getRequiredArgCount(),
+                              command.getMaxArgCount(),
+                              std::move(library),
+                              std::move(symbol) });
+        // The first command to claim an ID or alias wins, same as for a tuple of commands
+        indices_.emplace(command.id(), index);
+        for (const auto& alias : command.aliases()) {
+            indices_.emplace(alias, index);
+        }
+    }
+
+    /**
+     * @brief Check if a command ID or alias belongs to a plugin command
+     * @param commandId The command ID or alias
+     * @return Whether there is such a plugin command
+     */
+    [[nodiscard]] bool contains(const std::string& commandId) const { return indices_.count(commandId) > 0; }
+
+    /**
+     * @brief Run the plugin command named by the first CLI argument, loading its plugin if not already loaded
+     * @param argc The number of CLI arguments
+     * @param argv The CLI arguments
+     * @return What the plugin returned, 1 if the command has the wrong number of arguments or its plugin cannot be
+     *         loaded, or std::nullopt if the command is not a plugin command, e.g. to parse the built-in commands
+     */
+    std::optional<int> run(int argc, char* argv[]) const
+    {
+        if (argc < 2) {
+            return std::nullopt;
+        }
+        const auto search = indices_.find(argv[1]);
+        if (search == indices_.end()) {
+            return std::nullopt;
+        }
+        const auto& command = commands_[search->second];
+        std::size_t argumentCount {};
+        bool optionsEnded {};
+        for (int i = 2; i < argc; ++i) {
+            const auto kind = details::lexWord(argv[i], optionsEnded).kind;
+            optionsEnded = optionsEnded || kind == details::TokenKind::endOfOptions;
+            argumentCount += kind == details::TokenKind::argument ? 1 : 0;
+        }
+        if (argumentCount < command.requiredArgCount || argumentCount > command.maxArgCount) {
+            std::cerr << "Wrong number of arguments for command: " << argv[1] << std::endl;
+            std::cerr << command.id << " " << command.usage << " " << command.description << std::endl;
+            return 1;
+        }
+        const auto entryPoint = load(command);
+        if (entryPoint == nullptr) {
+            return 1;
+        }
+        return entryPoint(argc, argv);
+    }
+
+    /**
+     * @brief Get the help prompt of the plugin commands, without loading any plugin
+     * @return The help prompt, formatted as the one of a tuple of commands
+     */
+    [[nodiscard]] std::string help() const
+    {
+        std::size_t longestCommandIdAndUsage { 0 };
+        for (const auto& command : commands_) {
+            constexpr std::size_t separatorSize { 1 };
+            longestCommandIdAndUsage
+                = std::max(longestCommandIdAndUsage, command.id.size() + command.usage.size() + separatorSize);
+        }
+        std::string helpPrompt {};
+        for (const auto& command : commands_) {
+            details::appendHelpLine(
+                helpPrompt, command.id, command.usage, command.description, longestCommandIdAndUsage);
+        }
+        return helpPrompt;
+    }
+
+private:
+    std::vector<details::PluginCommand> commands_ {};
+    std::unordered_map<std::string, std::size_t> indices_ {};
+
+    static PluginEntryPoint load(const details::PluginCommand& command)
+    {
+        // dlerror is process-wide, so it is only read while no other plugin is being loaded
+        static std::mutex loadMutex {};
+        const std::lock_guard<std::mutex> lock { loadMutex };
+        auto* const library = ::dlopen(command.library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (library == nullptr) {
+            std::cerr << "Cannot load plugin of command " << command.id << ": " << ::dlerror() << std::endl;
+            return nullptr;
+        }
+        auto* const symbol = ::dlsym(library, command.symbol.c_str());
+        if (symbol == nullptr) {
+            std::cerr << "Cannot find " << command.symbol << " in plugin of command " << command.id << ": "
+                      << ::dlerror() << std::endl;
+            return nullptr;
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return reinterpret_cast<PluginEntryPoint>(symbol);
+    }
+};
+} // namespace UnparsedCommand
@@ -0,0 +1,343 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <iostream>
+#include <memory>
+
+namespace details {
+/// @brief A command parsed through a registry, whose arguments are only known to the command that parsed it
+class ErasedParsedCommand
+{
+public:
+    ErasedParsedCommand() = default;
+    ErasedParsedCommand(const ErasedParsedCommand&) = delete;
+    ErasedParsedCommand& operator=(const ErasedParsedCommand&) = delete;
+    ErasedParsedCommand(ErasedParsedCommand&&) = delete;
+    ErasedParsedCommand& operator=(ErasedParsedCommand&&) = delete;
+    virtual ~ErasedParsedCommand() = default;
+
+    [[nodiscard]] virtual bool parsed() const = 0;
+    [[nodiscard]] virtual bool hasOption(const std::string& option) const = 0;
+    [[nodiscard]] virtual std::unordered_set<std::string> getUnknownOptions() const = 0;
+};
+
+template <typename CommandTypes>
+class ErasedParsedCommandImpl : public ErasedParsedCommand
+{
+public:
+    using Commands = std::tuple<UnparsedCommandImpl<CommandTypes>>;
+
+    ErasedParsedCommandImpl(
+        const std::vector<std::string_view>& words,
+        const Commands& commands,
+        const ParseContext<Commands>& context)
+        : parsedCommand_ { words, commands, context }
+    {
+    }
+
+    [[nodiscard]] bool parsed() const override { return parsedCommand_.commandIndex().has_value(); }
+    [[nodiscard]] bool hasOption(const std::string& option) const override
+    {
+        return parsedCommand_.hasOption(option);
+    }
+    [[nodiscard]] std::unordered_set<std::string> getUnknownOptions() const override
+    {
+        return parsedCommand_.getUnknownOptions();
+    }
+
+    [[nodiscard]] CommandTypes getArgs(const Commands& commands) const
+    {
+        return parsedCommand_.getArgs(std::get<0>(commands));
+    }
+
+private:
+    ParsedCommandImpl<Commands> parsedCommand_;
+};
+
+/// @brief A command registered at runtime, which parses its own arguments without its type being known to the caller
+class RegisteredCommand
+{
+public:
+    RegisteredCommand() = default;
+    RegisteredCommand(const RegisteredCommand&) = delete;
+    RegisteredCommand& operator=(const RegisteredCommand&) = delete;
+    RegisteredCommand(RegisteredCommand&&) = delete;
+    RegisteredCommand& operator=(RegisteredCommand&&) = delete;
+    virtual ~RegisteredCommand() = default;
+
+    [[nodiscard]] virtual const std::string& id() const = 0;
+    [[nodiscard]] virtual const std::unordered_set<std::string>& aliases() const = 0;
+    [[nodiscard]] virtual const std::string& usage() const = 0;
+    [[nodiscard]] virtual const std::string& description() const = 0;
+
+    /**
+     * @brief Parse the words of a command line naming this command
+     * @param words The words, starting with the command ID or alias
+     * @param environment The environment to resolve fallbacks from, the process environment if nullptr
+     */
+    [[nodiscard]] virtual std::unique_ptr<ErasedParsedCommand>
+    parse(const std::vector<std::string_view>& words, const EnvironmentIndex* environment) const = 0;
+};
+
+template <typename CommandTypes>
+class RegisteredCommandImpl : public RegisteredCommand
+{
+public:
+    explicit RegisteredCommandImpl(UnparsedCommandImpl<CommandTypes> command)
+        : commands_ { std::move(command) }
+        , table_ { commands_ }
+    {
+    }
+
+    [[nodiscard]] const std::string& id() const override { return command().id(); }
+    [[nodiscard]] const std::unordered_set<std::string>& aliases() const override { return command().aliases(); }
+    [[nodiscard]] const std::string& usage() const override { return command().usage(); }
+    [[nodiscard]] const std::string& description() const override { return command().description(); }
+
+    [[nodiscard]] std::unique_ptr<ErasedParsedCommand>
+    parse(const std::vector<std::string_view>& words, const EnvironmentIndex* environment) const override
+    {
+        const ParseContext<Commands> context { environment, &table_ };
+        return std::make_unique<ErasedParsedCommandImpl<CommandTypes>>(words, commands_, context);
+    }
+
+    [[nodiscard]] CommandTypes getArgs(const ErasedParsedCommand& parsedCommand) const
+    {
+        return static_cast<const ErasedParsedCommandImpl<CommandTypes>&>(parsedCommand).getArgs(commands_);
+    }
+
+private:
+    using Commands = typename ErasedParsedCommandImpl<CommandTypes>::Commands;
+    // A tuple of one, so that parsing reuses `ParsedCommandImpl` as is
+    Commands commands_;
+    // Built once when the command is added rather than on every parse, which would generate its help prompt each time
+    CommandTable<Commands> table_;
+
+    [[nodiscard]] const UnparsedCommandImpl<CommandTypes>& command() const { return std::get<0>(commands_); }
+};
+} // namespace details
+
+namespace UnparsedCommand {
+class CommandRegistry;
+
+/**
+ * @brief Refers to a command added to a registry and carries its argument types, so that the arguments of a parsed
+ *        command can be accessed with their types, see `RegistryParsedCommand::getArgs`
+ * @tparam CommandTypes The argument types of the command
+ */
+template <typename CommandTypes>
+class CommandHandle
+{
+public:
+    using ArgumentsType = CommandTypes;
+
+    /// @brief Get the position of the command in the registry
+    [[nodiscard]] std::size_t index() const { return index_; }
+
+private:
+    friend class CommandRegistry;
+    friend class RegistryParsedCommand;
+
+    CommandHandle(const CommandRegistry& registry, std::size_t index)
+        : registry_ { &registry }
+        , index_ { index }
+    {
+    }
+
+    const CommandRegistry* registry_ {};
+    std::size_t index_ {};
+};
+
+/**
+ * @brief A command parsed through a registry
+ * @warning The registry must outlive it
+ */
+class RegistryParsedCommand
+{
+public:
+    /**
+     * @brief Check if the parsed command is the one the supplied handle refers to
+     * @param handle A handle of the registry the command was parsed with
+     * @return Whether the parsed command matches the handle
+     */
+    template <typename CommandTypes>
+    [[nodiscard]] bool is(const CommandHandle<CommandTypes>& handle) const
+    {
+        return handle.registry_ == registry_ && commandIndex_ == handle.index_;
+    }
+
+    /**
+     * @brief Get the parsed arguments of the command the supplied handle refers to
+     * @param handle A handle for which `is` is true
+     * @return A command-specific tuple with the parsed arguments, default constructed if `is` is false
+     */
+    template <typename CommandTypes>
+    [[nodiscard]] CommandTypes getArgs(const CommandHandle<CommandTypes>& handle) const;
+
+    /**
+     * @brief Check if the supplied option was encountered for the parsed command
+     * @param option
+     * @return true if the option was encountered, false otherwise
+     */
+    [[nodiscard]] bool hasOption(const std::string& option) const
+    {
+        return commandIndex_ && parsedCommand_->hasOption(option);
+    }
+
+    /**
+     * @brief Get any unknown options encountered during parsing
+     * @return A set of unknown options
+     */
+    [[nodiscard]] std::unordered_set<std::string> getUnknownOptions() const
+    {
+        return parsedCommand_ ? parsedCommand_->getUnknownOptions() : std::unordered_set<std::string> {};
+    }
+
+    /**
+     * @brief Get the position of the parsed command in the registry
+     * @return The index of the parsed command or std::nullopt if no command was parsed
+     */
+    [[nodiscard]] std::optional<std::size_t> commandIndex() const { return commandIndex_; }
+
+    /**
+     * @brief Get the help prompt of all the commands of the registry, which is only generated when asked for
+     * @return The help prompt
+     */
+    [[nodiscard]] std::string help() const;
+
+private:
+    friend class CommandRegistry;
+
+    explicit RegistryParsedCommand(const CommandRegistry& registry)
+        : registry_ { &registry }
+    {
+    }
+
+    const CommandRegistry* registry_ {};
+    std::optional<std::size_t> commandIndex_ {};
+    std::unique_ptr<details::ErasedParsedCommand> parsedCommand_ {};
+};
+
+/**
+ * @brief Commands registered at runtime rather than listed in one tuple, e.g. by modules that only share the registry,
+ *        so that adding a command only recompiles the module that adds it. Every command is looked up through a hash
+ *        index over the IDs and aliases and only the matching command converts its arguments, so parsing does not
+ *        slow down as commands are added
+ */
+class CommandRegistry
+{
+public:
+    CommandRegistry() = default;
+    // Handles and parsed commands refer to the registry
+    CommandRegistry(const CommandRegistry&) = delete;
+    CommandRegistry& operator=(const CommandRegistry&) = delete;
+    CommandRegistry(CommandRegistry&&) = delete;
+    CommandRegistry& operator=(CommandRegistry&&) = delete;
+    ~CommandRegistry() = default;
+
+    /**
+     * @brief Add a command, the first command to claim an ID or alias wins
+     * @param command The unparsed command, e.g. created with `UnparsedCommand::create`
+     * @return A handle to access the arguments of the command once parsed
+     */
+    template <typename CommandTypes>
+    CommandHandle<CommandTypes> add(details::UnparsedCommandImpl<CommandTypes> command)
+    {
+        const auto index = commands_.size();
+        indices_.emplace(command.id(), index);
+        for (const auto& alias : command.aliases()) {
+            indices_.emplace(alias, index);
+        }
+        commands_.push_back(std::make_unique<details::RegisteredCommandImpl<CommandTypes>>(std::move(command)));
+        return CommandHandle<CommandTypes> { *this, index };
+    }
+
+    /**
+     * @brief Parse a command given the supplied CLI arguments
+     * @param argc The number of CLI arguments
+     * @param argv The CLI arguments
+     * @param environment The environment to resolve fallbacks from, the process environment if nullptr
+     * @return A parsed command
+     */
+    [[nodiscard]] RegistryParsedCommand
+    parse(int argc, char* argv[], const details::EnvironmentIndex* environment = nullptr) const
+    {
+        std::vector<std::string_view> words {};
+        for (int i = 1; i < argc; ++i) {
+            words.emplace_back(argv[i]);
+        }
+        return parse(words, environment);
+    }
+
+    /**
+     * @brief Parse a command from a command line that is already split into words, e.g. by `CommandLine`
+     * @param words The words, starting with the command ID (i.e. without the program name)
+     * @param environment The environment to resolve fallbacks from, the process environment if nullptr
+     * @return A parsed command
+     */
+    [[nodiscard]] RegistryParsedCommand
+    parse(const std::vector<std::string_view>& words, const details::EnvironmentIndex* environment = nullptr) const
+    {
+        RegistryParsedCommand parsedCommand { *this };
+        if (words.empty()) {
+            std::cerr << "No command passed" << std::endl;
+            return parsedCommand;
+        }
+        const auto search = indices_.find(std::string { words.front() });
+        if (search == indices_.end()) {
+            std::cerr << "Unrecognized command: " << words.front() << std::endl;
+            return parsedCommand;
+        }
+        parsedCommand.parsedCommand_ = commands_[search->second]->parse(words, environment);
+        if (parsedCommand.parsedCommand_->parsed()) {
+            parsedCommand.commandIndex_ = search->second;
+        }
+        return parsedCommand;
+    }
+
+    /**
+     * @brief Get the help prompt of all the commands, in the order they were added
+     * @return The help prompt
+     */
+    [[nodiscard]] std::string help() const
+    {
+        std::size_t longestCommandIdAndUsage { 0 };
+        for (const auto& command : commands_) {
+            constexpr std::size_t separatorSize { 1 };
+            longestCommandIdAndUsage
+                = std::max(longestCommandIdAndUsage, command->id().size() + command->usage().size() + separatorSize);
+        }
+        std::string helpPrompt {};
+        for (const auto& command : commands_) {
+            details::appendHelpLine(
+                helpPrompt, command->id(), command->usage(), command->description(), longestCommandIdAndUsage);
+        }
+        return helpPrompt;
+    }
+
+    /// @brief Get the number of added commands
+    [[nodiscard]] std::size_t size() const { return commands_.size(); }
+
+private:
+    friend class RegistryParsedCommand;
+
+    std::vector<std::unique_ptr<details::RegisteredCommand>> commands_ {};
+    std::unordered_map<std::string, std::size_t> indices_ {};
+};
+
+template <typename CommandTypes>
+CommandTypes RegistryParsedCommand::getArgs(const CommandHandle<CommandTypes>& handle) const
+{
+    assert(is(handle) && "Command not found"); // NOLINT (cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+    if (!is(handle)) {
+        return {};
+    }
+    // The handle was created with the types of the command at its index, so the command is of those types
+    const auto& command
+        = static_cast<const details::RegisteredCommandImpl<CommandTypes>&>(*registry_->commands_[handle.index_]);
+    return command.getArgs(*parsedCommand_);
+}
+
+inline std::string RegistryParsedCommand::help() const { return registry_->help(); }
+} // namespace UnparsedCommand
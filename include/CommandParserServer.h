@@ -0,0 +1,501 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace details {
+/// @brief Frames larger than this are treated as malformed and close the connection
+constexpr std::size_t maxArgvFrameBytes { 1U << 20U };
+
+/**
+ * @brief Write the whole buffer to a socket, retrying on interruptions
+ * @return Whether everything was written
+ */
+inline bool sendAll(int socket, const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const auto sent = ::send(socket, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+/**
+ * @brief Fill the whole buffer from a socket, retrying on interruptions
+ * @return Whether the buffer was filled, false on errors or if the peer closed the connection
+ */
+inline bool receiveAll(int socket, void* data, std::size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const auto received = ::recv(socket, bytes, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+/**
+ * @brief A command line sent over a local socket as a length-prefixed frame:
+ *        `uint32 argc` followed by `uint32 length` and the bytes of each argument, all in native byte order
+ *        The buffers are reused between frames so that a connection in steady state does not allocate
+ */
+class ArgvFrame
+{
+public:
+    /**
+     * @brief Read the next frame, replacing the current one
+     * @param socket The socket to read from
+     * @return Whether a well-formed frame was read
+     */
+    bool read(int socket)
+    {
+        std::uint32_t argc {};
+        if (!receiveAll(socket, &argc, sizeof(argc)) || argc == 0 || argc > maxArgvFrameBytes) {
+            return false;
+        }
+        bytes_.clear();
+        offsets_.clear();
+        for (std::uint32_t i = 0; i < argc; ++i) {
+            std::uint32_t length {};
+            if (!receiveAll(socket, &length, sizeof(length)) || bytes_.size() + length >= maxArgvFrameBytes) {
+                return false;
+            }
+            offsets_.push_back(bytes_.size());
+            bytes_.resize(bytes_.size() + length + 1);
+            if (!receiveAll(socket, bytes_.data() + offsets_.back(), length)) {
+                return false;
+            }
+            bytes_.back() = '\0';
+        }
+        // Only now that the bytes stopped moving around can they be pointed to
+        argv_.clear();
+        for (const auto offset : offsets_) {
+            argv_.push_back(bytes_.data() + offset);
+        }
+        argv_.push_back(nullptr);
+        return true;
+    }
+
+    /**
+     * @brief Write a command line as a frame
+     * @return Whether the frame was written
+     */
+    static bool write(int socket, int argc, const char* const argv[])
+    {
+        const auto count = static_cast<std::uint32_t>(argc);
+        if (!sendAll(socket, &count, sizeof(count))) {
+            return false;
+        }
+        for (int i = 0; i < argc; ++i) {
+            const auto length = static_cast<std::uint32_t>(std::strlen(argv[i]));
+            if (!sendAll(socket, &length, sizeof(length)) || !sendAll(socket, argv[i], length)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] int argc() const { return static_cast<int>(offsets_.size()); }
+    [[nodiscard]] char** argv() { return argv_.data(); }
+
+private:
+    std::vector<char> bytes_ {};
+    std::vector<std::size_t> offsets_ {};
+    std::vector<char*> argv_ {};
+};
+
+/**
+ * @brief Write the result of a command as `int32 exit code`, `uint32 length` and the output bytes
+ * @return Whether the response was written
+ */
+inline bool writeResponse(int socket, int exitCode, std::string_view output)
+{
+    const auto code = static_cast<std::int32_t>(exitCode);
+    const auto length = static_cast<std::uint32_t>(output.size());
+    return sendAll(socket, &code, sizeof(code)) && sendAll(socket, &length, sizeof(length))
+        && sendAll(socket, output.data(), output.size());
+}
+
+/**
+ * @brief Read the result of a command written by `writeResponse`
+ * @return Whether a response was read
+ */
+inline bool readResponse(int socket, int& exitCode, std::string& output)
+{
+    std::int32_t code {};
+    std::uint32_t length {};
+    if (!receiveAll(socket, &code, sizeof(code)) || !receiveAll(socket, &length, sizeof(length))) {
+        return false;
+    }
+    exitCode = code;
+    output.resize(length);
+    return receiveAll(socket, output.data(), length);
+}
+
+/**
+ * @brief Fill a local socket address
+ * @return Whether the path fits in the address
+ */
+inline bool toSocketAddress(const std::string& socketPath, sockaddr_un& address)
+{
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Invalid socket path: " << socketPath << std::endl;
+        return false;
+    }
+    std::copy(socketPath.begin(), socketPath.end(), std::begin(address.sun_path));
+    return true;
+}
+
+/**
+ * @brief Check if nobody listens on a socket any more, e.g. one left behind by a server that crashed
+ * @return Whether connecting to the socket was refused
+ */
+inline bool isStaleSocket(const sockaddr_un& address)
+{
+    const auto probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        return false;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* genericAddress = reinterpret_cast<const sockaddr*>(&address);
+    const auto refused = ::connect(probe, genericAddress, sizeof(address)) != 0 && errno == ECONNREFUSED;
+    ::close(probe);
+    return refused;
+}
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief Serves command lines sent by `UnparsedCommand::forward` over a local (AF_UNIX) socket, so that scripts
+ *        invoking the tool many times skip the process start up and the building of the commands
+ *
+ * The commands and their lookup tables are built once. Every received command line is parsed as
+ * `UnparsedCommand::validate` does, so that every error is sent back to the client, and dispatched to the handler
+ * registered for the parsed command on one of the workers. An invalid number (e.g. "12abc") is one of these errors
+ * rather than an exception, while `UnparsedCommand::parse` rejects the same numbers by throwing. Handlers may run
+ * concurrently, write the output for the client to the supplied stream and return the exit code. Parsing errors are
+ * also printed to the stderr of the server and environment fallbacks resolve against the environment of the server.
+ * When built with exceptions, an exception thrown while parsing (e.g. by the constructor of a custom argument type)
+ * or by a handler is printed to stderr and sent back as a failure with exit code 1, and the server keeps serving.
+ *
+ * Each worker serves one connection at a time, `forward` opens one connection per command line. A connection that
+ * sends nothing, or does not read the response, for the idle timeout is closed, so that idle clients cannot hold on
+ * to every worker.
+ *
+ * @tparam T A tuple with the unparsed commands
+ */
+template <typename T>
+class CommandServer
+{
+public:
+    using Parsed = ParsedCommandImpl<T>;
+    using Handler = std::function<int(const Parsed&, std::ostream&)>;
+
+    explicit CommandServer(T commands)
+        : commands_ { std::move(commands) }
+        , table_ { commands_ }
+        , handlers_(std::tuple_size_v<T>)
+    {
+    }
+
+    CommandServer(const CommandServer&) = delete;
+    CommandServer& operator=(const CommandServer&) = delete;
+    CommandServer(CommandServer&&) = delete;
+    CommandServer& operator=(CommandServer&&) = delete;
+
+    ~CommandServer() { stop(); }
+
+    /**
+     * @brief Register the handler of a command, replacing any previous one
+     * @param command One of the served commands
+     * @param handler The handler, which must be safe to call from multiple threads
+     * @return The server, to chain registrations
+     */
+    template <typename CommandType>
+    CommandServer& on(const CommandType& command, Handler handler)
+    {
+        static_assert(
+            details::typeInTuple<CommandType, T>::value,
+            "The specified command was not included in the tuple of commands the server was constructed with");
+        const auto index = table_.find(command.id());
+        assert(index && "Command not found"); // NOLINT (cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+        handlers_[index.value_or(0)] = std::move(handler);
+        return *this;
+    }
+
+    /**
+     * @brief Register the handler of command lines that were not parsed or whose command has no handler
+     *        By default the parsing errors, see `ParsedCommandImpl::getErrors`, and the help prompt are sent back
+     *        with exit code 1
+     * @param handler The handler, which must be safe to call from multiple threads
+     * @return The server, to chain registrations
+     */
+    CommandServer& onUnparsed(Handler handler)
+    {
+        unparsedHandler_ = std::move(handler);
+        return *this;
+    }
+
+    /**
+     * @brief Start serving on the supplied socket path, replacing a stale socket left there by a previous server
+     *        but not the socket of a server that still runs
+     * @param socketPath The path of the socket
+     * @param workers The number of threads handling commands
+     * @param idleTimeout How long a connection may send or read nothing before it is closed, zero to never close it
+     * @return Whether the server started, errors are printed to stderr
+     */
+    bool start(
+        const std::string& socketPath,
+        std::size_t workers = std::max(1U, std::thread::hardware_concurrency()),
+        std::chrono::milliseconds idleTimeout = std::chrono::seconds { 10 })
+    {
+        if (listener_ >= 0) {
+            std::cerr << "Server already started on: " << socketPath_ << std::endl;
+            return false;
+        }
+        sockaddr_un address {};
+        if (!details::toSocketAddress(socketPath, address)) {
+            return false;
+        }
+        struct stat existing {};
+        if (::lstat(socketPath.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+            if (!details::isStaleSocket(address)) {
+                std::cerr << "Socket is in use or cannot be probed: " << socketPath << std::endl;
+                return false;
+            }
+            ::unlink(socketPath.c_str());
+        }
+        listener_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* genericAddress = reinterpret_cast<const sockaddr*>(&address);
+        if (listener_ < 0 || ::bind(listener_, genericAddress, sizeof(address)) != 0
+            || ::listen(listener_, SOMAXCONN) != 0) {
+            std::cerr << "Failed to listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+            if (listener_ >= 0) {
+                ::close(listener_);
+            }
+            listener_ = -1;
+            return false;
+        }
+        socketPath_ = socketPath;
+        idleTimeout_ = idleTimeout;
+        stopping_ = false;
+        connections_.assign(std::max<std::size_t>(workers, 1), -1);
+        for (std::size_t worker = 0; worker < connections_.size(); ++worker) {
+            workers_.emplace_back([this, worker] { serve(worker); });
+        }
+        return true;
+    }
+
+    /**
+     * @brief Stop serving, closing any open connections and waiting for running handlers to return
+     */
+    void stop()
+    {
+        if (listener_ < 0) {
+            return;
+        }
+        {
+            const std::lock_guard<std::mutex> lock { connectionsMutex_ };
+            stopping_ = true;
+            ::shutdown(listener_, SHUT_RDWR);
+            for (const auto connection : connections_) {
+                if (connection >= 0) {
+                    ::shutdown(connection, SHUT_RDWR);
+                }
+            }
+        }
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+        ::close(listener_);
+        listener_ = -1;
+        ::unlink(socketPath_.c_str());
+    }
+
+private:
+    T commands_ {};
+    details::CommandTable<T> table_;
+    std::vector<Handler> handlers_ {};
+    Handler unparsedHandler_ { [](const Parsed& parsed, std::ostream& output) {
+        for (const auto& error : parsed.getErrors()) {
+            output << error.message << "\n";
+        }
+        output << parsed.help();
+        return 1;
+    } };
+    int listener_ { -1 };
+    std::string socketPath_ {};
+    std::chrono::milliseconds idleTimeout_ {};
+    std::vector<std::thread> workers_ {};
+    std::mutex connectionsMutex_ {};
+    std::vector<int> connections_ {};
+    bool stopping_ {};
+
+    void serve(std::size_t worker)
+    {
+        details::ArgvFrame frame {};
+        std::stringstream output {};
+        while (true) {
+            const auto connection = ::accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                return; // The listener was shut down
+            }
+            {
+                const std::lock_guard<std::mutex> lock { connectionsMutex_ };
+                if (stopping_) {
+                    ::close(connection);
+                    return;
+                }
+                connections_[worker] = connection;
+            }
+            if (idleTimeout_.count() > 0) {
+                // Reads and writes fail once the client is silent or stops reading for the timeout, which ends the
+                // connection
+                const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(idleTimeout_);
+                const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(idleTimeout_ - seconds);
+                const timeval timeout { static_cast<time_t>(seconds.count()),
+                                        static_cast<suseconds_t>(microseconds.count()) };
+                ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            }
+            serveConnection(connection, frame, output);
+            // Closed under the lock so that `stop` never shuts down a reused descriptor
+            const std::lock_guard<std::mutex> lock { connectionsMutex_ };
+            connections_[worker] = -1;
+            ::close(connection);
+        }
+    }
+
+    void serveConnection(int connection, details::ArgvFrame& frame, std::stringstream& output) const
+    {
+#if __cpp_exceptions
+        // Reading a frame or copying the output may still run out of memory, which only ends this connection
+        try {
+#endif
+            while (frame.read(connection)) {
+                output.str({});
+                output.clear();
+                const auto exitCode = handle(frame, output);
+                if (!details::writeResponse(connection, exitCode, output.str())) {
+                    break;
+                }
+            }
+#if __cpp_exceptions
+        } catch (const std::exception& exception) {
+            std::cerr << "Connection failed: " << exception.what() << std::endl;
+        }
+#endif
+    }
+
+    int handle(details::ArgvFrame& frame, std::stringstream& output) const
+    {
+#if __cpp_exceptions
+        try {
+            return handleParsed(frame, output);
+        } catch (const std::exception& exception) {
+            return fail(output, exception.what());
+        } catch (...) {
+            return fail(output, "unknown exception");
+        }
+#else
+        return handleParsed(frame, output);
+#endif
+    }
+
+    /// @brief Replace what a command wrote so far with the reason it failed
+    static int fail(std::stringstream& output, const char* reason)
+    {
+        std::cerr << "Command failed: " << reason << std::endl;
+        output.str({});
+        output.clear();
+        output << "Command failed: " << reason << "\n";
+        return 1;
+    }
+
+    int handleParsed(details::ArgvFrame& frame, std::ostream& output) const
+    {
+        // Collecting the errors converts numbers without throwing, so an invalid number is an error for the client
+        const details::ParseContext<T> context { nullptr, &table_, false, true };
+        const Parsed parsed { frame.argc(), frame.argv(), commands_, context };
+        const auto index = parsed.commandIndex();
+        if (index && handlers_[*index]) {
+            return handlers_[*index](parsed, output);
+        }
+        return unparsedHandler_(parsed, output);
+    }
+};
+
+/**
+ * @brief Forward a command line to a `CommandServer` and write the output of the command to the supplied stream
+ *        e.g. `if (const auto exitCode = UnparsedCommand::forward(path, argc, argv)) { return *exitCode; }`
+ * @param socketPath The path of the socket the server listens on
+ * @param argc The number of CLI arguments
+ * @param argv The CLI arguments
+ * @param output The stream to write the output of the command to
+ * @return The exit code of the command or std::nullopt if the server could not be reached,
+ *         in which case the caller may parse and run the command itself
+ */
+inline std::optional<int>
+forward(const std::string& socketPath, int argc, const char* const argv[], std::ostream& output = std::cout)
+{
+    sockaddr_un address {};
+    if (!details::toSocketAddress(socketPath, address)) {
+        return std::nullopt;
+    }
+    const auto connection = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0) {
+        return std::nullopt;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* genericAddress = reinterpret_cast<const sockaddr*>(&address);
+    int exitCode {};
+    std::string response {};
+    const auto forwarded = ::connect(connection, genericAddress, sizeof(address)) == 0
+        && details::ArgvFrame::write(connection, argc, argv)
+        && details::readResponse(connection, exitCode, response);
+    ::close(connection);
+    if (!forwarded) {
+        return std::nullopt;
+    }
+    output << response << std::flush;
+    return exitCode;
+}
+} // namespace UnparsedCommand
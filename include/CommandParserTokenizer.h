@@ -0,0 +1,226 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <cstdint>
+#include <cstring>
+#if COMMAND_PARSER_DEFINITIONS
+#include <iostream>
+#endif
+
+namespace details {
+constexpr bool isWordSeparator(char c) { return c == ' ' || c == '\t' || c == '\n'; }
+
+constexpr bool isSpecialCharacter(char c) { return isWordSeparator(c) || c == '\'' || c == '"' || c == '\\'; }
+
+/**
+ * @brief Find the first word separator, quote or backslash, skipping eight plain characters at a time
+ * @param text The text to search
+ * @param from Where to start searching
+ * @return The position of the first special character or `text.size()` if there is none
+ */
+COMMAND_PARSER_INLINE std::size_t findSpecialCharacter(std::string_view text, std::size_t from);
+
+#if COMMAND_PARSER_DEFINITIONS
+COMMAND_PARSER_INLINE std::size_t findSpecialCharacter(std::string_view text, std::size_t from)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && (defined(__GNUC__) || defined(__clang__))
+    constexpr std::uint64_t ones { 0x0101010101010101ULL };
+    constexpr std::uint64_t highBits { 0x8080808080808080ULL };
+    constexpr std::size_t bytesPerWord { sizeof(std::uint64_t) };
+    // Sets the high bit of the bytes equal to `c`, exact for the lowest such byte, which is all we look at
+    const auto bytesEqualTo = [](std::uint64_t word, char c) {
+        const auto difference = word ^ (ones * static_cast<unsigned char>(c));
+        return (difference - ones) & ~difference & highBits;
+    };
+    for (; from + bytesPerWord <= text.size(); from += bytesPerWord) {
+        std::uint64_t word {};
+        std::memcpy(&word, text.data() + from, bytesPerWord);
+        const auto matches = bytesEqualTo(word, ' ') | bytesEqualTo(word, '\t') | bytesEqualTo(word, '\n')
+            | bytesEqualTo(word, '\'') | bytesEqualTo(word, '"') | bytesEqualTo(word, '\\');
+        if (matches != 0) {
+            constexpr unsigned int bitsPerByte { 8 };
+            return from + static_cast<std::size_t>(__builtin_ctzll(matches)) / bitsPerByte;
+        }
+    }
+#endif
+    for (; from < text.size(); ++from) {
+        if (isSpecialCharacter(text[from])) {
+            return from;
+        }
+    }
+    return text.size();
+}
+#endif
+} // namespace details
+
+namespace UnparsedCommand {
+/**
+ * @brief A command line received as a single string (e.g. from a configuration file or a chat bot) split into
+ *        words like a POSIX shell would, without expansions:
+ * - Words are separated by spaces, tabs and newlines
+ * - Single quotes preserve everything up to the closing quote
+ * - Double quotes preserve everything except backslashes escaping `"`, `\`, `$`, `` ` `` or a newline
+ * - A backslash outside quotes preserves the next character, or joins lines if it is a newline
+ * - Words are kept as the shell would pass them, so a bare `--` still ends the options once parsed
+ *
+ * Words without quotes or backslashes refer to the original line, only the others are copied after being unquoted.
+ * @warning The line must outlive the command line
+ */
+class CommandLine
+{
+public:
+    /**
+     * @brief Split a line into words
+     * @param line The line, whose quoting errors are printed to stderr and leave no words
+     */
+    explicit CommandLine(std::string_view line);
+
+    // A copy would refer to the unquoted words of the original, moving keeps them as the buffer moves along
+    CommandLine(const CommandLine&) = delete;
+    CommandLine& operator=(const CommandLine&) = delete;
+    CommandLine(CommandLine&&) noexcept = default;
+    CommandLine& operator=(CommandLine&&) noexcept = default;
+    ~CommandLine() = default;
+
+    /**
+     * @brief Get the words of the line
+     * @return The words, which are views to the line or to the command line
+     */
+    [[nodiscard]] const std::vector<std::string_view>& words() const { return words_; }
+
+private:
+    std::string_view line_ {};
+    // Holds the words that are not views to the line, never reallocated once reserved so that views to it stay valid
+    std::vector<char> unquoted_ {};
+    std::vector<std::string_view> words_ {};
+
+    void reserveOnce()
+    {
+        if (unquoted_.capacity() == 0) {
+            // Unquoted words take at most the size of the line
+            unquoted_.reserve(line_.size());
+        }
+    }
+
+    /**
+     * @brief Unquote the word starting at `wordStart`, whose first special character is at `position`
+     * @return Whether the quotes and escapes were balanced, in which case `position` is past the word
+     */
+    bool unquote(std::string_view line, std::size_t wordStart, std::size_t& position, std::string_view& word);
+
+    bool unquoteDoubleQuotes(std::string_view line, std::size_t& position);
+
+    void append(std::string_view text)
+    {
+        assert(unquoted_.size() + text.size() <= unquoted_.capacity() && "Views to the words would be invalidated");
+        unquoted_.insert(unquoted_.end(), text.begin(), text.end());
+    }
+};
+
+#if COMMAND_PARSER_DEFINITIONS
+COMMAND_PARSER_INLINE CommandLine::CommandLine(std::string_view line)
+    : line_ { line }
+{
+    std::size_t position {};
+    while (true) {
+        // Escaped newlines between words only join lines
+        while (position < line.size()
+               && (details::isWordSeparator(line[position]) || line.substr(position, 2) == "\\\n")) {
+            ++position;
+        }
+        if (position == line.size()) {
+            return;
+        }
+        const auto wordStart = position;
+        position = details::findSpecialCharacter(line, position);
+        std::string_view word {};
+        if (position == line.size() || details::isWordSeparator(line[position])) {
+            word = line.substr(wordStart, position - wordStart);
+        } else if (!unquote(line, wordStart, position, word)) {
+            words_.clear();
+            return;
+        }
+        words_.push_back(word);
+    }
+}
+
+COMMAND_PARSER_INLINE bool
+CommandLine::unquote(std::string_view line, std::size_t wordStart, std::size_t& position, std::string_view& word)
+{
+    reserveOnce();
+    const auto start = unquoted_.size();
+    append(line.substr(wordStart, position - wordStart));
+    while (position < line.size() && !details::isWordSeparator(line[position])) {
+        const auto c = line[position];
+        if (c == '\'') {
+            const auto closingQuote = line.find('\'', position + 1);
+            if (closingQuote == std::string_view::npos) {
+                std::cerr << "Unterminated single quote in: " << line << std::endl;
+                return false;
+            }
+            append(line.substr(position + 1, closingQuote - position - 1));
+            position = closingQuote + 1;
+        } else if (c == '"') {
+            if (!unquoteDoubleQuotes(line, position)) {
+                std::cerr << "Unterminated double quote in: " << line << std::endl;
+                return false;
+            }
+        } else if (c == '\\') {
+            if (position + 1 == line.size()) {
+                std::cerr << "Trailing backslash in: " << line << std::endl;
+                return false;
+            }
+            if (line[position + 1] != '\n') {
+                unquoted_.push_back(line[position + 1]);
+            }
+            position += 2;
+        } else {
+            const auto runEnd = details::findSpecialCharacter(line, position);
+            append(line.substr(position, runEnd - position));
+            position = runEnd;
+        }
+    }
+    word = { unquoted_.data() + start, unquoted_.size() - start };
+    return true;
+}
+
+COMMAND_PARSER_INLINE bool CommandLine::unquoteDoubleQuotes(std::string_view line, std::size_t& position)
+{
+    for (++position; position < line.size(); ++position) {
+        const auto c = line[position];
+        if (c == '"') {
+            ++position;
+            return true;
+        }
+        constexpr std::string_view escapable { "\"\\$`\n" };
+        const auto isEscape = c == '\\' && position + 1 < line.size()
+            && escapable.find(line[position + 1]) != std::string_view::npos;
+        if (isEscape) {
+            ++position;
+            if (line[position] != '\n') {
+                unquoted_.push_back(line[position]);
+            }
+        } else {
+            unquoted_.push_back(c);
+        }
+    }
+    return false;
+}
+#endif
+
+/**
+ * @brief Helper function to parse a command line received as a single string, e.g. "get --verbose 'my key'"
+ * @tparam Instrumentation An optional instrumentation policy, see `NoInstrumentation`
+ * @tparam T A tuple with the available unparsed commands
+ * @param line The command line, starting with the command ID and split into words by `CommandLine`
+ * @param unparsedCommands A tuple with the available unparsed commands
+ * @return A parsed command
+ */
+template <typename Instrumentation = NoInstrumentation, typename T>
+[[nodiscard]] ParsedCommandImpl<T, Instrumentation> parseLine(std::string_view line, const T& unparsedCommands)
+{
+    const CommandLine commandLine { line };
+    return ParsedCommandImpl<T, Instrumentation> { commandLine.words(), unparsedCommands };
+}
+} // namespace UnparsedCommand
@@ -0,0 +1,15 @@
+// The parts of the command parser that do not depend on the commands, compiled once rather than in every
+// translation unit that includes the headers, see the `command_parser_compiled` CMake target
+#ifndef COMMAND_PARSER_SEPARATE_COMPILATION
+#error "Build with COMMAND_PARSER_SEPARATE_COMPILATION defined, as the users of this translation unit are"
+#endif
+#define COMMAND_PARSER_IMPLEMENTATION
+
+#include "CommandParser.h"
+#include "CommandParserHelp.h"
+#include "CommandParserTokenizer.h"
+
+template class std::vector<details::UnparsedOption>;
+template class std::vector<details::OptionOccurrences>;
+template class std::vector<OptionViolation>;
+template class std::vector<ParseError>;
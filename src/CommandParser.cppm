@@ -0,0 +1,32 @@
+// The command parser as a C++20 module, e.g. `import command_parser;`, see the `command_parser_module` CMake target
+module;
+
+#include "CommandParser.h"
+#include "CommandParserTokenizer.h"
+
+export module command_parser;
+
+export using ::NoInstrumentation;
+export using ::OptionConstraint;
+export using ::OptionViolation;
+export using ::ParseCounter;
+export using ::ParsedCommandImpl;
+export using ::ParseError;
+export using ::ParseErrorKind;
+export using ::ParsePhase;
+
+export namespace details {
+using details::CommandTable;
+using details::EnvironmentIndex;
+using details::UnparsedCommandImpl;
+} // namespace details
+
+export namespace UnparsedCommand {
+using UnparsedCommand::CommandLine;
+using UnparsedCommand::create;
+using UnparsedCommand::dispatch;
+using UnparsedCommand::parse;
+using UnparsedCommand::parseLine;
+using UnparsedCommand::parseMultiCall;
+using UnparsedCommand::validate;
+} // namespace UnparsedCommand
@@ -0,0 +1,197 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParser.h"
+#include "CommandParserRegistry.h"
+#include "TestUtils.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<std::size_t> allocationCount {};
+std::atomic<std::size_t> allocatedBytes {};
+
+void* countedAllocation(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    // NOLINTNEXTLINE(cppcoreguidelines-no-malloc)
+    if (auto* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    std::abort(); // We are built without exceptions, so we cannot throw std::bad_alloc
+}
+
+/**
+ * @brief Counts the heap allocations made during its lifetime
+ */
+class AllocationScope
+{
+public:
+    AllocationScope()
+        : countBefore_ { allocationCount.load() }
+        , bytesBefore_ { allocatedBytes.load() }
+    {
+    }
+
+    [[nodiscard]] std::size_t allocations() const { return allocationCount.load() - countBefore_; }
+    [[nodiscard]] std::size_t bytes() const { return allocatedBytes.load() - bytesBefore_; }
+
+private:
+    std::size_t countBefore_ {};
+    std::size_t bytesBefore_ {};
+};
+
+/**
+ * @brief The upper bounds of heap use for a parse
+ *        Budgets are set slightly above what the parser currently needs, so that regressions are caught, and should
+ *        be lowered whenever the parser gets leaner
+ */
+struct Budget {
+    std::size_t allocations {};
+    std::size_t bytes {};
+};
+
+template <typename Commands>
+void expectWithinBudget(
+    std::vector<char*>& argv,
+    const Commands& commands,
+    Budget budget,
+    bool expectParsed,
+    bool collectErrors = false)
+{
+    const auto argc = static_cast<int>(argv.size() - 1);
+    std::size_t allocations {};
+    std::size_t bytes {};
+    bool parsed {};
+    {
+        const AllocationScope scope {};
+        const auto parsedCommand = collectErrors ? UnparsedCommand::validate(argc, argv.data(), commands)
+                                                 : UnparsedCommand::parse(argc, argv.data(), commands);
+        parsed = parsedCommand.is(std::get<0>(commands));
+        allocations = scope.allocations();
+        bytes = scope.bytes();
+    }
+    EXPECT_EQ(parsed, expectParsed);
+    EXPECT_LE(allocations, budget.allocations) << "Allocation count budget exceeded";
+    EXPECT_LE(bytes, budget.bytes) << "Allocated bytes budget exceeded";
+}
+}
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc)
+void* operator new(std::size_t size) { return countedAllocation(size); }
+void* operator new[](std::size_t size) { return countedAllocation(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+// NOLINTEND(cppcoreguidelines-no-malloc)
+
+using std::string_literals::operator""s;
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenNoArgumentCommand_WillStayWithinBudget)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s, "dummyUsage"s);
+    auto otherCommand = UnparsedCommand::create("otherCommand"s, "dummyDescription"s).withArgs<int>();
+    std::array arguments { "binary"s, "dummyCommand"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command, otherCommand };
+
+    expectWithinBudget(argv, commands, { 6, 1024 }, true);
+}
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenNumericArguments_WillStayWithinBudget)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withArgs<int, long, unsigned long long, double, std::optional<float>>();
+    std::array arguments { "binary"s, "dummyCommand"s, "-1"s, "1234567890"s, "42"s, "3.14"s, "2.5"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+
+    expectWithinBudget(argv, commands, { 10, 1536 }, true);
+}
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenValidatedSuccessfully_WillStayWithinTheSameBudget)
+{
+    // Collecting errors only costs allocations once there is an error to collect
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "verbose" })
+                       .withArgs<int, long, unsigned long long, double, std::optional<float>>();
+    std::array arguments { "binary"s, "dummyCommand"s, "-1"s, "1234567890"s, "42"s, "--verbose=yes"s, "3.14"s, "2.5"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+
+    expectWithinBudget(argv, commands, { 10, 1536 }, true, true);
+}
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenCompoundShortOptions_WillStayWithinBudget)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "a", "b", "c", "d", "e", "f", "verbose" });
+    std::array arguments { "binary"s, "dummyCommand"s, "-abcdef"s, "--verbose"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+
+    expectWithinBudget(argv, commands, { 8, 1024 }, true);
+}
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenLongOptions_WillStayWithinBudget)
+{
+    // Longer than the small string buffer, so that copying a name would allocate
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "a-rather-long-option-name", "another-rather-long-option-name" });
+    std::array arguments { "binary"s, "dummyCommand"s, "--a-rather-long-option-name"s,
+                           "--another-rather-long-option-name=false"s, "--a-rather-long-option-name"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+
+    expectWithinBudget(argv, commands, { 8, 768 }, true);
+}
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenVectorOfTenThousandElements_WillStayWithinBudget)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withArgs<std::vector<int>>();
+    std::vector<std::string> arguments { "binary"s, "dummyCommand"s };
+    for (int i = 0; i < 10000; ++i) {
+        arguments.push_back(std::to_string(i));
+    }
+    std::vector<char*> argv {};
+    for (auto& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+    std::tuple commands { command };
+
+    expectWithinBudget(argv, commands, { 48, 1500000 }, true);
+}
+
+TEST(CommandParserAllocationTest, ParsedCommandImpl_WhenUnknownCommand_WillStayWithinBudget)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withOptions({ "x" });
+    std::array arguments { "binary"s, "unknownCommand"s, "-x"s, "argument"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+
+    expectWithinBudget(argv, commands, { 8, 1024 }, false);
+}
+
+TEST(CommandParserAllocationTest, CommandRegistry_WhenParsed_WillNotGenerateTheHelpPrompt)
+{
+    // The help prompt of a registered command is generated once when it is added rather than on every parse
+    UnparsedCommand::CommandRegistry registry {};
+    registry.add(UnparsedCommand::create("dummyCommand"s, std::string(1024, 'd'), "<value>"s).withArgs<int>());
+    std::array arguments { "binary"s, "dummyCommand"s, "42"s };
+    auto argv = toArgv(arguments);
+    const auto argc = static_cast<int>(argv.size() - 1);
+
+    const AllocationScope scope {};
+    const auto parsedCommand = registry.parse(argc, argv.data());
+    EXPECT_EQ(parsedCommand.commandIndex(), 0U);
+    EXPECT_LE(scope.allocations(), 5U) << "Allocation count budget exceeded";
+    EXPECT_LE(scope.bytes(), 512U) << "Allocated bytes budget exceeded";
+}
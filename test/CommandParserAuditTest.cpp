@@ -0,0 +1,202 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserAudit.h"
+
+#include <sys/resource.h>
+
+#include <csignal>
+#include <fstream>
+
+namespace {
+template <std::size_t Size, typename T>
+auto parse(std::array<const char*, Size> arguments, const T& commands)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return UnparsedCommand::parse(static_cast<int>(Size), const_cast<char**>(arguments.data()), commands);
+}
+
+const auto add = UnparsedCommand::create("add", "Add an item").withOptions({ "f" }).withArgs<std::string, int>();
+const auto list = UnparsedCommand::create("list", "List the items");
+const std::tuple commands { add, list };
+
+std::string auditLogPath(const std::string& name)
+{
+    const auto path = testing::TempDir() + name;
+    std::remove(path.c_str());
+    return path;
+}
+
+std::string readFile(const std::string& path)
+{
+    std::ifstream file { path, std::ios::binary };
+    return { std::istreambuf_iterator<char> { file }, {} };
+}
+
+std::size_t countRecords(const std::string& path)
+{
+    std::size_t records {};
+    const auto complete = UnparsedCommand::forEachAuditRecord(readFile(path), [&records](auto, auto) { ++records; });
+    return complete ? records : 0;
+}
+}
+
+TEST(CommandParserAuditTest, AuditLog_WhenCommandsRecorded_WillAppendThemInOrder)
+{
+    const auto path = auditLogPath("command_parser_audit_order");
+    const auto before = std::chrono::system_clock::now().time_since_epoch();
+    {
+        UnparsedCommand::AuditLog auditLog { commands };
+        ASSERT_TRUE(auditLog.start(path));
+        EXPECT_TRUE(auditLog.record(parse(std::array { "binary", "add", "-f", "item", "3" }, commands)));
+        EXPECT_TRUE(auditLog.record(parse(std::array { "binary", "unknown" }, commands)));
+    }
+    {
+        // Reopening appends rather than truncates
+        UnparsedCommand::AuditLog auditLog { commands };
+        ASSERT_TRUE(auditLog.start(path));
+        std::array arguments { "binary", "list" };
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        const auto parsedCommand = UnparsedCommand::parse(2, const_cast<char**>(arguments.data()), commands, auditLog);
+        EXPECT_TRUE(parsedCommand.is(list));
+    }
+
+    const auto log = readFile(path);
+    std::vector<std::string_view> frames {};
+    const auto complete = UnparsedCommand::forEachAuditRecord(log, [&frames, before](auto timestamp, auto frame) {
+        EXPECT_GE(timestamp, static_cast<std::uint64_t>(std::chrono::nanoseconds { before }.count()));
+        frames.push_back(frame);
+    });
+    ASSERT_TRUE(complete);
+    ASSERT_EQ(frames.size(), 3U);
+
+    const UnparsedCommand::CommandFrame first { frames[0], commands };
+    ASSERT_TRUE(first.is(add));
+    EXPECT_TRUE(first.hasOption("f"));
+    EXPECT_EQ(first.getArgs(add), std::make_tuple(std::string_view { "item" }, 3));
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(frames[1], commands).commandIndex());
+    EXPECT_TRUE(UnparsedCommand::CommandFrame(frames[2], commands).is(list));
+
+    EXPECT_FALSE(UnparsedCommand::forEachAuditRecord(std::string_view { log }.substr(0, log.size() - 1),
+                                                     [](auto, auto) {}));
+}
+
+TEST(CommandParserAuditTest, AuditLog_WhenNotStarted_WillNotRecord)
+{
+    UnparsedCommand::AuditLog auditLog { commands };
+    EXPECT_FALSE(auditLog.record(parse(std::array { "binary", "list" }, commands)));
+    EXPECT_FALSE(auditLog.start(testing::TempDir() + "missing/directory/audit"));
+    EXPECT_EQ(auditLog.dropped(), 0U);
+    // Nothing was recorded, so there is nothing to wait for
+    auditLog.flush();
+}
+
+TEST(CommandParserAuditTest, AuditLog_WhenBlockingAndManyThreadsRecord_WillKeepEveryRecord)
+{
+    const auto path = auditLogPath("command_parser_audit_block");
+    constexpr std::size_t threadCount { 4 };
+    constexpr std::size_t recordsPerThread { 500 };
+    {
+        UnparsedCommand::AuditLog auditLog { commands,
+                                             { 8, UnparsedCommand::BackPressure::block, std::chrono::milliseconds { 1 },
+                                               false } };
+        ASSERT_TRUE(auditLog.start(path));
+        const auto parsedCommand = parse(std::array { "binary", "add", "item", "3" }, commands);
+        std::vector<std::thread> threads {};
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            threads.emplace_back([&auditLog, &parsedCommand] {
+                for (std::size_t j = 0; j < recordsPerThread; ++j) {
+                    auditLog.record(parsedCommand);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auditLog.flush();
+        EXPECT_EQ(countRecords(path), threadCount * recordsPerThread);
+        EXPECT_EQ(auditLog.dropped(), 0U);
+    }
+}
+
+TEST(CommandParserAuditTest, AuditLog_WhenDroppingAndRingFull_WillCountDroppedRecords)
+{
+    const auto path = auditLogPath("command_parser_audit_drop");
+    constexpr std::size_t recordCount { 100 };
+    std::size_t recorded {};
+    {
+        // The writer waits far longer than the records take, so all but the first few are dropped
+        UnparsedCommand::AuditLog auditLog { commands,
+                                             { 4, UnparsedCommand::BackPressure::drop, std::chrono::seconds { 10 },
+                                               false } };
+        ASSERT_TRUE(auditLog.start(path));
+        const auto parsedCommand = parse(std::array { "binary", "list" }, commands);
+        for (std::size_t i = 0; i < recordCount; ++i) {
+            recorded += auditLog.record(parsedCommand) ? 1 : 0;
+        }
+        EXPECT_EQ(recorded, 4U);
+        EXPECT_EQ(auditLog.dropped(), recordCount - recorded);
+    }
+    EXPECT_EQ(countRecords(path), recorded);
+}
+
+TEST(CommandParserAuditTest, AuditLog_WhenWriteFails_WillTruncateTheBatchAndCountIt)
+{
+    const auto path = auditLogPath("command_parser_audit_fail");
+    constexpr std::size_t recordCount { 10 };
+    // The writer only wakes up when stopped, so every record goes in one batch, of which the file fits only a part
+    rlimit fileSizeLimit {};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &fileSizeLimit), 0);
+    const auto previousFileSizeLimit = fileSizeLimit;
+    fileSizeLimit.rlim_cur = 64;
+    const auto previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &fileSizeLimit), 0);
+    std::size_t failed {};
+    {
+        UnparsedCommand::AuditLog auditLog { commands,
+                                             { 16, UnparsedCommand::BackPressure::drop, std::chrono::seconds { 10 },
+                                               false } };
+        ASSERT_TRUE(auditLog.start(path));
+        const auto parsedCommand = parse(std::array { "binary", "add", "item", "3" }, commands);
+        for (std::size_t i = 0; i < recordCount; ++i) {
+            EXPECT_TRUE(auditLog.record(parsedCommand));
+        }
+        testing::internal::CaptureStderr();
+        auditLog.stop();
+        EXPECT_THAT(testing::internal::GetCapturedStderr(), testing::HasSubstr("Cannot write audit log"));
+        failed = auditLog.failed();
+    }
+    ::setrlimit(RLIMIT_FSIZE, &previousFileSizeLimit);
+    std::signal(SIGXFSZ, previousHandler);
+
+    EXPECT_EQ(failed, recordCount);
+    EXPECT_TRUE(readFile(path).empty());
+}
+
+TEST(CommandParserAuditTest, AuditLog_WhenRecordingWhileStopping_WillWriteEveryRecordReportedRecorded)
+{
+    const auto path = auditLogPath("command_parser_audit_stop");
+    std::atomic<std::size_t> recorded {};
+    {
+        UnparsedCommand::AuditLog auditLog { commands,
+                                             { 1024, UnparsedCommand::BackPressure::block,
+                                               std::chrono::milliseconds { 1 }, false } };
+        ASSERT_TRUE(auditLog.start(path));
+        const auto parsedCommand = parse(std::array { "binary", "list" }, commands);
+        std::vector<std::thread> threads {};
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back([&auditLog, &parsedCommand, &recorded] {
+                while (auditLog.record(parsedCommand)) {
+                    ++recorded;
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+        auditLog.stop();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    EXPECT_GT(recorded.load(), 0U);
+    EXPECT_EQ(countRecords(path), recorded.load());
+}
@@ -0,0 +1,154 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserBatch.h"
+
+#include <array>
+#include <sstream>
+
+using std::string_literals::operator""s;
+
+TEST(CommandParserBatchTest, ParseBatch_WhenManyCommandLines_WillMatchSequentialParse)
+{
+    const auto add = UnparsedCommand::create("add"s, "dummyDescription"s).withArgs<int, int>().withOptions({ "v" });
+    const auto echo = UnparsedCommand::create("echo"s, "dummyDescription"s).withArgs<std::vector<std::string>>();
+    const auto list = UnparsedCommand::create("list"s, "dummyDescription"s).withAliases({ "ls" });
+    const std::tuple commands { add, echo, list };
+    std::vector<std::vector<std::string>> commandLines {};
+    for (int i = 0; i < 10000; ++i) {
+        switch (i % 3) {
+        case 0:
+            commandLines.push_back({ "binary"s, "add"s, std::to_string(i), "-v"s, std::to_string(-i) });
+            break;
+        case 1:
+            commandLines.push_back({ "binary"s, "echo"s, std::string(static_cast<std::size_t>(i % 7), 'x'), "y"s });
+            break;
+        default:
+            commandLines.push_back({ "binary"s, "ls"s });
+        }
+    }
+
+    std::vector<ParsedCommandImpl<std::decay_t<decltype(commands)>>> results(commandLines.size());
+    UnparsedCommand::parseBatch(commandLines, commands, results, 4);
+
+    for (std::size_t i = 0; i < commandLines.size(); ++i) {
+        const auto& result = results[i];
+        ASSERT_EQ(result.commandIndex(), i % 3) << i;
+        if (result.is(add)) {
+            EXPECT_EQ(result.getArgs(add), std::make_tuple(static_cast<int>(i), -static_cast<int>(i)));
+            EXPECT_TRUE(result.hasOption("v"));
+        } else if (result.is(echo)) {
+            const auto [words] = result.getArgs(echo);
+            EXPECT_EQ(words, (std::vector { std::string(i % 7, 'x'), "y"s }));
+        }
+    }
+}
+
+TEST(CommandParserBatchTest, ParseBatch_WhenArgvViewsOrCStrings_WillParseInPlace)
+{
+    const auto add = UnparsedCommand::create("add"s, "dummyDescription"s).withArgs<int, int>();
+    const std::tuple commands { add };
+    std::array<std::string, 4> arguments { "binary"s, "add"s, "1"s, "2"s };
+    std::array<char*, 5> argv { arguments[0].data(), arguments[1].data(), arguments[2].data(), arguments[3].data() };
+    const std::vector<UnparsedCommand::ArgvView> views { { 4, argv.data() }, { 2, argv.data() } };
+
+    const auto viewResults = UnparsedCommand::parseBatch(views, commands, 2);
+    ASSERT_EQ(viewResults.size(), 2U);
+    ASSERT_TRUE(viewResults[0].is(add));
+    EXPECT_EQ(viewResults[0].getArgs(add), std::make_tuple(1, 2));
+    EXPECT_FALSE(viewResults[1].commandIndex());
+
+    const std::vector<std::vector<const char*>> cStrings { { "binary", "add", "3", "4" } };
+    const auto cStringResults = UnparsedCommand::parseBatch(cStrings, commands, 1);
+    ASSERT_TRUE(cStringResults[0].is(add));
+    EXPECT_EQ(cStringResults[0].getArgs(add), std::make_tuple(3, 4));
+
+    EXPECT_TRUE(UnparsedCommand::parseBatch(std::vector<UnparsedCommand::ArgvView> {}, commands).empty());
+}
+
+TEST(CommandParserBatchTest, ForEachIndexInParallel_WhenWorkIsUneven_WillVisitEveryIndexOnce)
+{
+    constexpr std::size_t count { 5000 };
+    constexpr std::size_t slowCount { count / 4 };
+    std::vector<std::atomic<int>> visits(count);
+    std::array<std::atomic<bool>, 4> visitedSlowIndices {};
+    details::forEachIndexInParallel(count, 4, [&visits, &visitedSlowIndices](std::size_t index, std::size_t worker) {
+        // The range of the first worker is far slower, so the other workers have to steal from it
+        if (index < slowCount) {
+            visitedSlowIndices.at(worker) = true;
+            std::this_thread::sleep_for(std::chrono::microseconds { 50 });
+        }
+        visits[index].fetch_add(1);
+    });
+
+    for (std::size_t index = 0; index < count; ++index) {
+        EXPECT_EQ(visits[index].load(), 1) << index;
+    }
+    const auto slowWorkers = std::count_if(
+        visitedSlowIndices.begin(), visitedSlowIndices.end(), [](const auto& visited) { return visited.load(); });
+    EXPECT_GT(slowWorkers, 1);
+}
+
+TEST(CommandParserBatchTest, StealableRange_WhenPoppedAndStolen_WillHandOutDisjointIndices)
+{
+    details::StealableRange range {};
+    range.assign(0, 100);
+    std::uint32_t begin {};
+    std::uint32_t end {};
+    ASSERT_TRUE(range.pop(16, begin, end));
+    EXPECT_EQ(begin, 0U);
+    EXPECT_EQ(end, 16U);
+    ASSERT_TRUE(range.steal(begin, end));
+    EXPECT_EQ(begin, 58U);
+    EXPECT_EQ(end, 100U);
+    ASSERT_TRUE(range.pop(100, begin, end));
+    EXPECT_EQ(begin, 16U);
+    EXPECT_EQ(end, 58U);
+    EXPECT_FALSE(range.pop(1, begin, end));
+    EXPECT_FALSE(range.steal(begin, end));
+
+    range.assign(7, 8);
+    ASSERT_TRUE(range.steal(begin, end));
+    EXPECT_EQ(begin, 7U);
+    EXPECT_EQ(end, 8U);
+    EXPECT_FALSE(range.pop(1, begin, end));
+}
+
+TEST(CommandParserBatchTest, ParseBatch_WhenArgumentsInvalid_WillReportEachCommandLineInOnePiece)
+{
+    const auto add = UnparsedCommand::create("add"s, "dummyDescription"s).withArgs<int, int>();
+    const std::tuple commands { add };
+    std::vector<std::vector<std::string>> commandLines {};
+    for (int i = 0; i < 1000; ++i) {
+        commandLines.push_back({ "binary"s, "add"s, "x" + std::to_string(i), std::to_string(i) });
+    }
+    commandLines.push_back({ "binary"s, "add"s, "1"s, "2"s });
+
+    testing::internal::CaptureStderr();
+    const auto results = UnparsedCommand::parseBatch(commandLines, commands, 4);
+    const auto diagnostics = testing::internal::GetCapturedStderr();
+
+    for (std::size_t i = 0; i + 1 < commandLines.size(); ++i) {
+        EXPECT_FALSE(results[i].commandIndex()) << i;
+        ASSERT_EQ(results[i].getErrors().size(), 1U) << i;
+        EXPECT_EQ(results[i].getErrors().front().kind, ParseErrorKind::invalidArgument);
+        EXPECT_EQ(results[i].getErrors().front().position, 2U);
+    }
+    ASSERT_TRUE(results.back().is(add));
+    EXPECT_EQ(results.back().getArgs(add), std::make_tuple(1, 2));
+    EXPECT_EQ(results.front().help(), results.back().help());
+
+    // Every invalid argument is directly followed by the rest of the diagnostics of its command line
+    std::istringstream lines { diagnostics };
+    std::string line {};
+    std::size_t invalidArguments {};
+    while (std::getline(lines, line)) {
+        ASSERT_THAT(line, testing::StartsWith("Invalid argument \"x"));
+        ASSERT_TRUE(std::getline(lines, line));
+        EXPECT_EQ(line, "Invalid arguments for command: add");
+        ASSERT_TRUE(std::getline(lines, line));
+        EXPECT_EQ(line, "add  dummyDescription");
+        ++invalidArguments;
+    }
+    EXPECT_EQ(invalidArguments, commandLines.size() - 1);
+}
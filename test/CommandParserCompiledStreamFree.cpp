@@ -0,0 +1,7 @@
+// Includes nothing but the parser, built with COMMAND_PARSER_SEPARATE_COMPILATION, so that it is checked to leave the
+// standard streams to src/CommandParser.cpp
+#include "CommandParser.h"
+
+#if defined(_GLIBCXX_IOSTREAM) || defined(_LIBCPP_IOSTREAM)
+#error "CommandParser.h must not include <iostream> when compiled separately"
+#endif
@@ -0,0 +1,109 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserCompletion.h"
+#include "completion/CompletionCommands.h"
+
+#include <cstdio>
+
+namespace {
+const std::string bashScript { COMPLETION_DIR "/tool.bash" };
+
+/// @brief Complete the last of the supplied words with the generated bash script
+std::string completeWithBash(const std::vector<std::string>& words)
+{
+    const auto driverPath = testing::TempDir() + "command_parser_completion_driver.bash";
+    std::ofstream driver { driverPath };
+    driver << "source " << details::shellQuote(bashScript) << "\nCOMP_WORDS=(";
+    for (const auto& word : words) {
+        driver << details::shellQuote(word) << " ";
+    }
+    driver << ")\nCOMP_CWORD=" << words.size() - 1 << "\n_tool\necho \"${COMPREPLY[*]}\"\n";
+    driver.close();
+
+    auto* const output = ::popen(("bash " + details::shellQuote(driverPath) + " 2>&1").c_str(), "r");
+    if (output == nullptr) {
+        return "popen failed";
+    }
+    std::string completions {};
+    std::array<char, 256> buffer {};
+    while (std::fgets(buffer.data(), static_cast<int>(buffer.size()), output) != nullptr) {
+        completions += buffer.data();
+    }
+    ::pclose(output);
+    return completions;
+}
+
+/// @brief A file only the test creates, to tell file completion apart from option completion
+std::string completionFile()
+{
+    const auto path = testing::TempDir() + "command_parser_completion_file";
+    std::ofstream { path } << "file";
+    return path;
+}
+
+std::string scriptFor(UnparsedCommand::Shell shell)
+{
+    std::stringstream script {};
+    UnparsedCommand::writeCompletion(script, shell, "tool", completion::commands());
+    return script.str();
+}
+}
+
+TEST(CommandParserCompletionTest, WriteCompletion_WhenGeneratedAtBuildTime_WillMatchCommands)
+{
+    std::ifstream generated { bashScript };
+    ASSERT_TRUE(generated.is_open()) << bashScript;
+    const std::string contents { std::istreambuf_iterator<char> { generated }, {} };
+    EXPECT_EQ(contents, scriptFor(UnparsedCommand::Shell::bash));
+}
+
+TEST(CommandParserCompletionTest, BashCompletion_WhenCompletingCommand_WillOfferIdsAndAliases)
+{
+    EXPECT_EQ(completeWithBash({ "tool", "" }), "add plus list remove\n");
+    EXPECT_EQ(completeWithBash({ "tool", "p" }), "plus\n");
+    EXPECT_EQ(completeWithBash({ "tool", "unknown", "" }), "\n");
+}
+
+TEST(CommandParserCompletionTest, BashCompletion_WhenCompletingOptions_WillOfferThoseOfTheCommand)
+{
+    EXPECT_EQ(completeWithBash({ "tool", "plus", "-" }), "--force -f\n");
+    EXPECT_EQ(completeWithBash({ "tool", "remove", "--d" }), "--dry-run\n");
+    EXPECT_EQ(completeWithBash({ "tool", "list", "-" }), "\n");
+}
+
+TEST(CommandParserCompletionTest, BashCompletion_WhenAllArgumentsGiven_WillOfferOnlyOptions)
+{
+    // Files are completed while arguments are missing, options are skipped when counting them
+    const auto file = completionFile();
+    const auto filePrefix = file.substr(0, file.size() - 2);
+    EXPECT_EQ(completeWithBash({ "tool", "add", "-f", "item", filePrefix }), file + "\n");
+    EXPECT_EQ(completeWithBash({ "tool", "add", "-f", "item", "3", filePrefix }), "\n");
+    EXPECT_EQ(completeWithBash({ "tool", "add", "-f", "item", "3", "" }), "--force -f\n");
+    EXPECT_EQ(completeWithBash({ "tool", "list", "" }), "\n");
+    EXPECT_EQ(completeWithBash({ "tool", "remove", "a", "b", "c", filePrefix }), file + "\n");
+}
+
+TEST(CommandParserCompletionTest, WriteCompletion_WhenZshOrFish_WillListCommandsAndOptions)
+{
+    const auto zsh = scriptFor(UnparsedCommand::Shell::zsh);
+    EXPECT_THAT(zsh, testing::StartsWith("#compdef tool\n"));
+    EXPECT_THAT(zsh, testing::HasSubstr("compadd -- 'add' 'plus' 'list' 'remove'\n"));
+    EXPECT_THAT(zsh, testing::HasSubstr("    'add'|'plus')\n        options='--force -f'\n        maxArguments=2\n"));
+    EXPECT_THAT(zsh, testing::HasSubstr("    'remove')\n        options='--dry-run'\n        maxArguments=-1\n"));
+
+    const auto fish = scriptFor(UnparsedCommand::Shell::fish);
+    EXPECT_THAT(fish,
+                testing::HasSubstr("complete -c 'tool' -n 'not __fish_seen_subcommand_from add plus list remove' "
+                                   "-a 'plus' -d 'Add an item'\n"));
+    EXPECT_THAT(fish, testing::HasSubstr("complete -c 'tool' -n '__fish_seen_subcommand_from add plus' -s 'f'\n"));
+    EXPECT_THAT(fish, testing::HasSubstr("complete -c 'tool' -n '__fish_seen_subcommand_from remove' -l 'dry-run'\n"));
+    EXPECT_THAT(fish, testing::Not(testing::HasSubstr("'__fish_seen_subcommand_from list' -F")));
+}
+
+TEST(CommandParserCompletionTest, ShellQuote_WhenQuotes_WillEscapeThem)
+{
+    EXPECT_EQ(details::shellQuote("it's"), "'it'\\''s'");
+    EXPECT_EQ(details::fishQuote("it's a \\"), "'it\\'s a \\\\'");
+    EXPECT_EQ(details::functionName("my-tool.v2"), "_my_tool_v2");
+}
@@ -0,0 +1,245 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParser.h"
+#include "fuzz/FuzzCommands.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <new>
+#include <sstream>
+
+namespace {
+std::atomic<std::size_t> allocations {};
+std::atomic<std::size_t> allocatedBytes {};
+
+void* countedAllocation(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    // NOLINTNEXTLINE(cppcoreguidelines-no-malloc)
+    if (auto* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    std::abort(); // We are built without exceptions, so we cannot throw std::bad_alloc
+}
+
+/**
+ * @brief Keeps the counts reported by the last parse, with its allocations counted by the operator new of this test
+ */
+struct Counters {
+    static constexpr bool enabled { true };
+    static inline std::array<std::size_t, 4> last {};
+
+    static std::size_t allocationCount() { return allocations.load(std::memory_order_relaxed); }
+
+    void onPhase(ParsePhase, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point) { }
+
+    void onCount(ParseCounter counter, std::size_t value) { last.at(static_cast<std::size_t>(counter)) = value; }
+};
+/**
+ * @brief Owns the command line arguments of a parse, so that the argv pointers stay valid
+ */
+struct Arguments {
+    explicit Arguments(std::vector<std::string> arguments)
+        : strings { std::move(arguments) }
+    {
+        for (auto& argument : strings) {
+            argv.push_back(argument.data());
+        }
+        argv.push_back(nullptr);
+    }
+
+    [[nodiscard]] int argc() const { return static_cast<int>(strings.size()); }
+
+    std::vector<std::string> strings {};
+    std::vector<char*> argv {};
+};
+
+/// @brief Creates a parse whose input grows with the supplied size, only the returned function is measured
+using Generator = std::function<std::function<void()>(std::size_t)>;
+
+template <typename Commands>
+std::function<void()> parseOf(Commands commands, std::vector<std::string> arguments)
+{
+    auto input = std::make_shared<Arguments>(std::move(arguments));
+    return [commands = std::move(commands), input] {
+        static_cast<void>(UnparsedCommand::parse<Counters>(input->argc(), input->argv.data(), commands));
+    };
+}
+
+/// @brief What a parse costs, counted rather than timed so that the comparison does not depend on the machine load
+struct Cost {
+    std::size_t tokens {};
+    std::size_t allocations {};
+    std::size_t bytes {};
+};
+
+Cost costOf(const std::function<void()>& parse)
+{
+    const auto bytesBefore = allocatedBytes.load();
+    parse();
+    return { Counters::last.at(static_cast<std::size_t>(ParseCounter::tokens)),
+             Counters::last.at(static_cast<std::size_t>(ParseCounter::allocations)),
+             allocatedBytes.load() - bytesBefore };
+}
+
+/**
+ * @brief Expect the cost of a parse to grow at most linearly with its input
+ *        Growing the input 8 times costs at most 8 times more if linear and 64 times more if quadratic, e.g. when
+ *        every word or option is copied once per other one
+ */
+void expectAtMostLinearGrowth(const Generator& generate, std::size_t size)
+{
+    constexpr std::size_t growth { 8 };
+    // Silence the error messages of hostile inputs to keep the output readable
+    std::stringstream errors {};
+    auto* const originalErrors = std::cerr.rdbuf(errors.rdbuf());
+    const auto small = costOf(generate(size));
+    const auto large = costOf(generate(size * growth));
+    std::cerr.rdbuf(originalErrors);
+
+    EXPECT_LE(large.tokens, small.tokens * growth) << "Tokens of " << size << " and " << size * growth;
+    EXPECT_LE(large.allocations, small.allocations * growth)
+        << "Parsing " << size * growth << " made " << large.allocations << " allocations while parsing " << size
+        << " made " << small.allocations;
+    EXPECT_LE(large.bytes, small.bytes * growth)
+        << "Parsing " << size * growth << " allocated " << large.bytes << " bytes while parsing " << size
+        << " allocated " << small.bytes;
+}
+
+std::string repeated(std::string_view pattern, std::size_t size)
+{
+    std::string result {};
+    result.reserve(size);
+    while (result.size() < size) {
+        result.append(pattern.substr(0, std::min(pattern.size(), size - result.size())));
+    }
+    return result;
+}
+
+std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream file { path, std::ios::binary };
+    return { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {} };
+}
+
+constexpr std::size_t inputSize { 12500 };
+}
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc)
+void* operator new(std::size_t size) { return countedAllocation(size); }
+void* operator new[](std::size_t size) { return countedAllocation(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+// NOLINTEND(cppcoreguidelines-no-malloc)
+
+using std::string_literals::operator""s;
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenCompoundOptionGrows_WillParseInLinearTime)
+{
+    const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withOptions({ "a", "b", "c" }) };
+    expectAtMostLinearGrowth(
+        [&commands](std::size_t size) {
+            return parseOf(commands, { "binary"s, "get"s, "-" + repeated("abc", size) });
+        },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenCompoundOptionWithUnknownTailGrows_WillParseInLinearTime)
+{
+    const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withOptions({ "a", "b", "c" }) };
+    expectAtMostLinearGrowth(
+        [&commands](std::size_t size) {
+            return parseOf(commands, { "binary"s, "get"s, "-" + repeated("abc", size) + "z" });
+        },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenAliasSetGrows_WillParseInLinearTime)
+{
+    expectAtMostLinearGrowth(
+        [](std::size_t size) {
+            std::unordered_set<std::string> aliases {};
+            for (std::size_t i = 0; i < size; ++i) {
+                aliases.emplace("alias" + std::to_string(i));
+            }
+            const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withAliases(aliases) };
+            return parseOf(commands, { "binary"s, "alias" + std::to_string(size - 1) });
+        },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenLeadingBackslashesGrow_WillParseInLinearTime)
+{
+    const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withArgs<std::string>() };
+    expectAtMostLinearGrowth(
+        [&commands](std::size_t size) {
+            return parseOf(commands, { "binary"s, "get"s, std::string(size, '\\') + "-a" });
+        },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenLeadingDashesGrow_WillParseInLinearTime)
+{
+    const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withOptions({ "a" }) };
+    expectAtMostLinearGrowth(
+        [&commands](std::size_t size) {
+            return parseOf(commands, { "binary"s, "get"s, std::string(size, '-') + "a" });
+        },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenBoolArgumentGrows_WillParseInLinearTime)
+{
+    const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withArgs<bool>() };
+    expectAtMostLinearGrowth(
+        [&commands](std::size_t size) { return parseOf(commands, { "binary"s, "get"s, repeated("TrUe", size) }); },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenBoolVectorGrows_WillParseInLinearTime)
+{
+    const std::tuple commands { UnparsedCommand::create("get"s, "dummyDescription"s).withArgs<std::vector<bool>>() };
+    expectAtMostLinearGrowth(
+        [&commands](std::size_t size) {
+            std::vector<std::string> arguments { "binary"s, "get"s };
+            for (std::size_t i = 0; i < size / 8; ++i) {
+                arguments.emplace_back(i % 2 == 0 ? "YeS" : "off");
+            }
+            return parseOf(commands, std::move(arguments));
+        },
+        inputSize);
+}
+
+TEST(CommandParserComplexityTest, ParsedCommandImpl_WhenBoolArgumentLongerThanKeyword_WillNotParse)
+{
+    const auto command = UnparsedCommand::create("get"s, "dummyDescription"s).withArgs<bool>();
+    std::tuple commands { command };
+    for (const auto& argument : { "truex"s, "yess"s, "10"s, "onn"s, repeated("TrUe", inputSize) }) {
+        Arguments input { { "binary"s, "get"s, argument } };
+        auto parsedCommand = UnparsedCommand::parse(input.argc(), input.argv.data(), commands);
+        EXPECT_FALSE(parsedCommand.is(command)) << argument;
+    }
+}
+
+TEST(CommandParserComplexityTest, FuzzCorpus_WhenReplayed_WillParseEverySeed)
+{
+    std::size_t seeds {};
+    for (const auto& entry : std::filesystem::directory_iterator { FUZZ_CORPUS_DIR }) {
+        // A seed that makes the parse hang is caught by the timeout of the test
+        static_cast<void>(fuzz::parse(readFile(entry.path())));
+        ++seeds;
+    }
+    EXPECT_GT(seeds, 0U);
+}
@@ -0,0 +1,149 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserConfig.h"
+#include "TestUtils.h"
+
+#include <array>
+#include <fstream>
+
+namespace {
+std::string writeConfigFile(const std::string& name, const std::string& contents)
+{
+    const auto path = testing::TempDir() + name;
+    std::ofstream file { path, std::ios::trunc };
+    file << contents;
+    return path;
+}
+}
+
+using std::string_literals::operator""s;
+
+TEST(CommandParserConfigTest, ConfigFile_WhenFileMissing_WillNotBeLoaded)
+{
+    UnparsedCommand::ConfigFile config { testing::TempDir() + "doesNotExist.conf" };
+    EXPECT_FALSE(config.isLoaded());
+    EXPECT_FALSE(config.find("dummyCommand", "x"));
+}
+
+TEST(CommandParserConfigTest, ConfigFile_WhenFileHasCommentsAndMalformedLines_WillIndexValidLines)
+{
+    const auto path = writeConfigFile(
+        "indexed.conf",
+        "# comment\n"
+        "; another comment\n"
+        "\n"
+        "get.x = on\r\n"
+        "  get.1=\"  spaced value \"\n"
+        "malformed line\n"
+        ".missingCommand = 1\n"
+        "put.y = off\n"
+        "put.y = on");
+
+    UnparsedCommand::ConfigFile config { path };
+    ASSERT_TRUE(config.isLoaded());
+    EXPECT_EQ(config.find("get", "x"), "on");
+    EXPECT_EQ(config.find("get", "1"), "  spaced value ");
+    EXPECT_EQ(config.find("put", "y"), "on");
+    EXPECT_FALSE(config.find("get", "y"));
+    EXPECT_FALSE(config.find("", "missingCommand"));
+}
+
+TEST(CommandParserConfigTest, ConfigFile_WhenArgumentsAndOptionsMissing_WillUseFileDefaults)
+{
+    const auto path = writeConfigFile(
+        "defaults.conf",
+        "dummyCommand.1 = 42\n"
+        "dummyCommand.x = yes\n"
+        "dummyCommand.y = no\n"
+        "dummyCommand.unknown = yes\n"
+        "otherCommand.0 = ignored\n");
+    UnparsedCommand::ConfigFile config { path };
+    ASSERT_TRUE(config.isLoaded());
+
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
+                       .withArgs<std::string, std::optional<int>>()
+                       .withOptions({ "x", "y" });
+    auto otherCommand = UnparsedCommand::create("otherCommand"s, "dummyDescription"s);
+    const auto commands = config.apply(std::tuple { command, otherCommand });
+    constexpr int argc = 3;
+    std::array<std::string, argc> arguments { "binary"s, expectedCommand, "firstArgument"s };
+    auto argv = toArgv(arguments);
+
+    auto parsedCommand = UnparsedCommand::parse(argc, argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    auto [firstArgument, secondArgument] = parsedCommand.getArgs(command);
+    EXPECT_EQ(firstArgument, "firstArgument");
+    EXPECT_EQ(secondArgument, 42);
+    EXPECT_TRUE(parsedCommand.hasOption("x"));
+    EXPECT_FALSE(parsedCommand.hasOption("y"));
+    EXPECT_FALSE(parsedCommand.hasOption("unknown"));
+}
+
+TEST(CommandParserConfigTest, ConfigFile_WhenKeysUnknown_WillReportThem)
+{
+    const auto path = writeConfigFile(
+        "unknown.conf",
+        "dummyCommand.0 = mandatory\n"
+        "dummyCommand.1 = 42\n"
+        "dummyCommand.7 = outOfRange\n"
+        "dummyCommand.x = yes\n"
+        "dummyCommand.typo = yes\n"
+        "missingCommand.x = yes\n");
+    UnparsedCommand::ConfigFile config { path };
+    ASSERT_TRUE(config.isLoaded());
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withArgs<std::string, std::optional<int>>()
+                       .withOptions({ "x" });
+
+    testing::internal::CaptureStderr();
+    const auto commands = config.apply(std::tuple { command });
+    const auto errors = testing::internal::GetCapturedStderr();
+    EXPECT_THAT(errors, testing::HasSubstr("Ignoring unknown config key: dummyCommand.0\n"));
+    EXPECT_THAT(errors, testing::HasSubstr("Ignoring unknown config key: dummyCommand.7\n"));
+    EXPECT_THAT(errors, testing::HasSubstr("Ignoring unknown config key: dummyCommand.typo\n"));
+    EXPECT_THAT(errors, testing::HasSubstr("Ignoring config of unknown command: missingCommand\n"));
+    EXPECT_THAT(errors, testing::Not(testing::HasSubstr("dummyCommand.1")));
+    EXPECT_THAT(errors, testing::Not(testing::HasSubstr("dummyCommand.x")));
+
+    // The known keys are all applied
+    std::array arguments { "binary"s, "dummyCommand"s, "firstArgument"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_EQ(std::get<1>(parsedCommand.getArgs(command)), 42);
+    EXPECT_TRUE(parsedCommand.hasOption("x"));
+}
+
+TEST(CommandParserConfigTest, ConfigFile_WhenCommandLineAndEnvironmentSupplied_WillTakePrecedenceOverFile)
+{
+    const auto path = writeConfigFile(
+        "precedence.conf",
+        "dummyCommand.0 = 1\n"
+        "dummyCommand.1 = 2\n"
+        "dummyCommand.x = on\n"
+        "dummyCommand.y = off\n");
+    UnparsedCommand::ConfigFile config { path };
+
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
+                       .withArgs<std::optional<int>, std::optional<int>>()
+                       .withEnvArg<1>("TOOL_SECOND")
+                       .withEnvOption("x", "TOOL_X")
+                       .withEnvOption("y", "TOOL_Y");
+    const auto commands = config.apply(std::tuple { command });
+    constexpr int argc = 3;
+    std::array<std::string, argc> arguments { "binary"s, expectedCommand, "10"s };
+    auto argv = toArgv(arguments);
+    std::array<const char*, 4> environment { "TOOL_SECOND=20", "TOOL_X=off", "TOOL_Y=on", nullptr };
+
+    auto parsedCommand
+        = UnparsedCommand::parse(argc, argv.data(), commands, details::EnvironmentIndex { environment.data() });
+    ASSERT_TRUE(parsedCommand.is(command));
+    auto [firstArgument, secondArgument] = parsedCommand.getArgs(command);
+    EXPECT_EQ(firstArgument, 10);
+    EXPECT_EQ(secondArgument, 20);
+    EXPECT_FALSE(parsedCommand.hasOption("x"));
+    EXPECT_TRUE(parsedCommand.hasOption("y"));
+}
@@ -0,0 +1,12 @@
+// Includes nothing but the fixed-capacity parser, so that it is checked to build without the standard streams
+#include "CommandParserFixed.h"
+
+#if defined(_GLIBCXX_IOSTREAM) || defined(_GLIBCXX_OSTREAM) || defined(_LIBCPP_IOSTREAM) || defined(_LIBCPP_OSTREAM)
+#error "CommandParserFixed.h must not include the standard streams"
+#endif
+
+std::optional<std::size_t> parseWithoutStreams(int argc, char* argv[])
+{
+    constexpr auto remove = UnparsedCommand::createFixed("remove", "Remove a value").withArgs<std::string_view>();
+    return UnparsedCommand::parseFixed<4>(argc, argv, std::tuple { remove }).commandIndex();
+}
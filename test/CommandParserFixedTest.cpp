@@ -0,0 +1,134 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserFixed.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace levels {
+enum class Level { low, high };
+
+constexpr std::array<std::pair<std::string_view, Level>, 2> argumentKeywords(Level)
+{
+    return { { { "low", Level::low }, { "high", Level::high } } };
+}
+}
+
+namespace {
+std::atomic<std::size_t> allocationCount {};
+
+void* countedAllocation(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    // NOLINTNEXTLINE(cppcoreguidelines-no-malloc)
+    if (auto* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    std::abort(); // We are built without exceptions, so we cannot throw std::bad_alloc
+}
+
+template <std::size_t MaxWords, std::size_t Size, typename T>
+auto parse(std::array<const char*, Size>& arguments, const T& commands)
+{
+    const auto argc = static_cast<int>(Size);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return UnparsedCommand::parseFixed<MaxWords>(argc, const_cast<char**>(arguments.data()), commands);
+}
+
+constexpr auto put = UnparsedCommand::createFixed("put", "Store a value", "<key> <value> [level] [ratio]")
+                         .withOptions({ "f", "force", "--dry-run", "v" })
+                         .withArgs<std::string_view, int, std::optional<levels::Level>, std::optional<double>>();
+constexpr auto get = UnparsedCommand::createFixed("get", "Get a value").withArgs<std::string_view, bool>();
+constexpr std::tuple commands { get, put };
+
+static_assert(put.options()[2] == "dry-run");
+static_assert(put.optionIndex("v") == 3U);
+static_assert(put.getRequiredArgCount() == 2U && put.getMaxArgCount() == 4U);
+
+// Options are added to the ones the command already has, as for unparsed commands
+constexpr auto chained
+    = UnparsedCommand::createFixed("chained", "Chained options").withOptions({ "a" }).withOptions({ "--b" });
+static_assert(chained.options().size() == 2U && chained.optionIndex("a") == 0U && chained.optionIndex("b") == 1U);
+} // namespace
+
+// Defined in a translation unit that includes nothing but CommandParserFixed.h
+std::optional<std::size_t> parseWithoutStreams(int argc, char* argv[]);
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc)
+void* operator new(std::size_t size) { return countedAllocation(size); }
+void* operator new[](std::size_t size) { return countedAllocation(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+// NOLINTEND(cppcoreguidelines-no-malloc)
+
+TEST(CommandParserFixedTest, FixedParsedCommandImpl_WhenParsed_WillNotAllocate)
+{
+    std::array arguments { "binary", "put", "-fv", "key", "--dry-run=no", "+42", "HIGH", "--", "-2.5" };
+    const auto before = allocationCount.load();
+    const auto parsedCommand = parse<16>(arguments, commands);
+    const auto [key, value, level, ratio] = parsedCommand.getArgs(put);
+    const auto force = parsedCommand.hasOption("--f");
+    EXPECT_EQ(allocationCount.load(), before);
+
+    EXPECT_EQ(parsedCommand.error(), std::nullopt);
+    ASSERT_EQ(parsedCommand.commandIndex(), 1U);
+    EXPECT_TRUE(parsedCommand.is(put));
+    EXPECT_FALSE(parsedCommand.is(get));
+    EXPECT_TRUE(force);
+    EXPECT_TRUE(parsedCommand.hasOption("v"));
+    EXPECT_FALSE(parsedCommand.hasOption("dry-run"));
+    EXPECT_FALSE(parsedCommand.hasOption("force"));
+    EXPECT_FALSE(parsedCommand.hasOption("unknown"));
+    // A view into argv rather than a copy
+    EXPECT_EQ(key.data(), arguments[3]);
+    EXPECT_EQ(value, 42);
+    EXPECT_EQ(level, levels::Level::high);
+    EXPECT_EQ(ratio, -2.5);
+}
+
+TEST(CommandParserFixedTest, FixedParsedCommandImpl_WhenOptionalArgumentsOmitted_WillLeaveThemEmpty)
+{
+    std::array arguments { "binary", "put", "key", "7", "--force" };
+    const auto parsedCommand = parse<4>(arguments, commands);
+    ASSERT_TRUE(parsedCommand.is(put));
+    EXPECT_TRUE(parsedCommand.hasOption("force"));
+    EXPECT_EQ(parsedCommand.getArgs(put), std::make_tuple(std::string_view { "key" }, 7, std::nullopt, std::nullopt));
+    // Another command gets default constructed arguments
+    EXPECT_EQ(parsedCommand.getArgs(get), std::make_tuple(std::string_view {}, false));
+}
+
+TEST(CommandParserFixedTest, FixedParsedCommandImpl_WhenInvalid_WillReportFirstProblem)
+{
+    const auto expectError = [](auto arguments, ParseErrorKind kind, std::size_t position) {
+        const auto parsedCommand = parse<4>(arguments, commands);
+        EXPECT_EQ(parsedCommand.commandIndex(), std::nullopt);
+        ASSERT_TRUE(parsedCommand.error());
+        EXPECT_EQ(parsedCommand.error()->kind, kind);
+        EXPECT_EQ(parsedCommand.error()->position, position);
+    };
+    expectError(std::array { "binary" }, ParseErrorKind::noCommand, 1);
+    expectError(std::array { "binary", "remove", "key" }, ParseErrorKind::unknownCommand, 1);
+    expectError(std::array { "binary", "get", "key" }, ParseErrorKind::wrongArgumentCount, 3);
+    expectError(std::array { "binary", "get", "key", "yes", "extra" }, ParseErrorKind::wrongArgumentCount, 4);
+    expectError(std::array { "binary", "get", "key", "maybe" }, ParseErrorKind::invalidArgument, 3);
+    expectError(std::array { "binary", "put", "key", "1x" }, ParseErrorKind::invalidArgument, 3);
+    expectError(std::array { "binary", "put", "key", "1", "medium" }, ParseErrorKind::invalidArgument, 4);
+    expectError(std::array { "binary", "put", "--force=maybe", "key" }, ParseErrorKind::invalidArgument, 2);
+    expectError(std::array { "binary", "put", "-fx", "key", "1" }, ParseErrorKind::unknownOption, 2);
+    expectError(std::array { "binary", "get", "--verbose", "key" }, ParseErrorKind::unknownOption, 2);
+    expectError(std::array { "binary", "put", "key", "1", "low", "0.5" }, ParseErrorKind::tooManyWords, 5);
+}
+
+TEST(CommandParserFixedTest, FixedParsedCommandImpl_WhenBuiltWithoutStreams_WillParse)
+{
+    std::array arguments { "binary", "remove", "key" };
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    EXPECT_EQ(parseWithoutStreams(static_cast<int>(arguments.size()), const_cast<char**>(arguments.data())), 0U);
+}
@@ -0,0 +1,171 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserFrame.h"
+
+#include <array>
+
+namespace levels {
+enum class Level : short { low = -1, high = 7 };
+
+constexpr std::array<std::pair<std::string_view, Level>, 2> argumentKeywords(Level)
+{
+    return { { { "low", Level::low }, { "high", Level::high } } };
+}
+}
+
+namespace {
+template <std::size_t Size, typename T>
+auto parse(std::array<const char*, Size> arguments, const T& commands)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return UnparsedCommand::parse(static_cast<int>(Size), const_cast<char**>(arguments.data()), commands);
+}
+
+const auto put = UnparsedCommand::create("put", "Store values")
+                     .withOptions({ "f", "force", "dry-run", "v" })
+                     .withArgs<std::string, long long, double, std::vector<std::string>>();
+const auto get = UnparsedCommand::create("get", "Get a value")
+                     .withArgs<std::string, std::optional<bool>, std::optional<float>>();
+const std::tuple commands { get, put };
+}
+
+using std::string_view_literals::operator""sv;
+
+TEST(CommandParserFrameTest, CommandFrame_WhenSerialized_WillReadArgumentsAsViewsIntoFrame)
+{
+    const auto parsedCommand
+        = parse(std::array { "binary", "put", "-fv", "key", "-42", "2.5", "a", "", "bc" }, commands);
+    ASSERT_TRUE(parsedCommand.is(put));
+    std::string frame {};
+    UnparsedCommand::serialize(parsedCommand, commands, frame);
+    EXPECT_EQ(UnparsedCommand::frameSize(frame), frame.size());
+
+    const UnparsedCommand::CommandFrame commandFrame { frame, commands };
+    ASSERT_EQ(commandFrame.commandIndex(), 1U);
+    EXPECT_TRUE(commandFrame.is(put));
+    EXPECT_FALSE(commandFrame.is(get));
+    EXPECT_TRUE(commandFrame.hasOption("f"));
+    EXPECT_TRUE(commandFrame.hasOption("--v"));
+    EXPECT_FALSE(commandFrame.hasOption("force"));
+    EXPECT_FALSE(commandFrame.hasOption("unknown"));
+
+    const auto [key, number, floatingPoint, words] = commandFrame.getArgs(put);
+    static_assert(std::is_same_v<decltype(key), const std::string_view>);
+    EXPECT_EQ(key, "key");
+    EXPECT_GE(key.data(), frame.data());
+    EXPECT_LT(key.data(), frame.data() + frame.size());
+    EXPECT_EQ(number, -42);
+    EXPECT_EQ(floatingPoint, 2.5);
+    EXPECT_THAT(words, testing::ElementsAre("a", "", "bc"));
+}
+
+TEST(CommandParserFrameTest, CommandFrame_WhenOptionalsOrNoCommand_WillRoundTrip)
+{
+    std::string frames {};
+    UnparsedCommand::serialize(parse(std::array { "binary", "get", "key", "no" }, commands), commands, frames);
+    const auto firstSize = frames.size();
+    UnparsedCommand::serialize(parse(std::array { "binary", "unknown" }, commands), commands, frames);
+
+    // Frames can be concatenated, e.g. in a stream, and are delimited by their size
+    ASSERT_EQ(UnparsedCommand::frameSize(frames), firstSize);
+    const UnparsedCommand::CommandFrame first { frames, commands };
+    ASSERT_TRUE(first.is(get));
+    EXPECT_EQ(first.getArgs(get), std::make_tuple("key"sv, std::optional { false }, std::optional<float> {}));
+
+    const UnparsedCommand::CommandFrame second { std::string_view { frames }.substr(firstSize), commands };
+    EXPECT_FALSE(second.commandIndex());
+    EXPECT_FALSE(second.is(get));
+}
+
+TEST(CommandParserFrameTest, CommandFrame_WhenEnumArgument_WillKeepItsValue)
+{
+    using levels::Level;
+    const auto level = UnparsedCommand::create("level", "Set the levels").withArgs<std::vector<Level>>();
+    const std::tuple levelCommands { level };
+    std::string frame {};
+    const auto parsedCommand = parse(std::array { "binary", "level", "low", "HIGH" }, levelCommands);
+    UnparsedCommand::serialize(parsedCommand, levelCommands, frame);
+
+    const UnparsedCommand::CommandFrame commandFrame { frame, levelCommands };
+    ASSERT_TRUE(commandFrame.is(level));
+    EXPECT_EQ(std::get<0>(commandFrame.getArgs(level)), (std::vector { Level::low, Level::high }));
+}
+
+TEST(CommandParserFrameTest, CommandFrame_WhenMalformed_WillHaveNoCommand)
+{
+    std::string frame {};
+    UnparsedCommand::serialize(parse(std::array { "binary", "put", "key", "1", "2", "x" }, commands), commands, frame);
+    ASSERT_TRUE(UnparsedCommand::CommandFrame(frame, commands).commandIndex());
+
+    EXPECT_EQ(UnparsedCommand::frameSize(std::string_view { frame }.substr(0, 8)), std::nullopt);
+    // Truncated anywhere
+    for (std::size_t size = 0; size < frame.size(); ++size) {
+        const UnparsedCommand::CommandFrame truncated { std::string_view { frame }.substr(0, size), commands };
+        EXPECT_FALSE(truncated.commandIndex()) << size;
+    }
+    // Another version
+    auto otherVersion = frame;
+    otherVersion[4] = static_cast<char>(details::frame::version + 1);
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(otherVersion, commands).commandIndex());
+    // A string longer than the frame, claiming the size of the whole frame is not enough either
+    auto forgedLength = frame;
+    forgedLength[16] = '\x7f';
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(forgedLength, commands).commandIndex());
+    // An unknown command
+    auto unknownCommand = frame;
+    unknownCommand[9] = 5;
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(unknownCommand, commands).commandIndex());
+}
+
+TEST(CommandParserFrameTest, CommandFrame_WhenIntegers_WillTakeTheBytesTheirValuesNeed)
+{
+    const auto numbers = UnparsedCommand::create("numbers", "Set numbers").withArgs<int, long long, unsigned long>();
+    const std::tuple numberCommands { numbers };
+    const auto frameOf = [&numberCommands](std::array<const char*, 5> arguments) {
+        std::string frame {};
+        UnparsedCommand::serialize(parse(arguments, numberCommands), numberCommands, frame);
+        return frame;
+    };
+    const auto small = frameOf({ "binary", "numbers", "-1", "63", "127" });
+    const auto large = frameOf({ "binary", "numbers", "-2147483648", "-9223372036854775808", "18446744073709551615" });
+    // The header, the command index and the empty option bitset, then one byte per small value
+    constexpr std::size_t withoutArguments { details::frame::headerSize + 2 * sizeof(std::uint16_t) };
+    EXPECT_EQ(small.size(), withoutArguments + 3);
+    EXPECT_EQ(large.size(), withoutArguments + 5 + 10 + 10);
+
+    const UnparsedCommand::CommandFrame commandFrame { large, numberCommands };
+    ASSERT_TRUE(commandFrame.is(numbers));
+    EXPECT_EQ(
+        commandFrame.getArgs(numbers),
+        std::make_tuple(
+            std::numeric_limits<int>::min(), std::numeric_limits<long long>::min(),
+            std::numeric_limits<unsigned long>::max()));
+}
+
+TEST(CommandParserFrameTest, CommandFrame_WhenIntegerDoesNotFitItsType_WillHaveNoCommand)
+{
+    // Read with commands whose argument types are narrower than the ones the frame was serialized with
+    const auto frameOf = [](const char* number, const auto& wideCommands) {
+        std::string frame {};
+        UnparsedCommand::serialize(parse(std::array { "binary", "number", number }, wideCommands), wideCommands, frame);
+        return frame;
+    };
+    const std::tuple wideCommands { UnparsedCommand::create("number", "Set a number").withArgs<long long>() };
+    const std::tuple intCommands { UnparsedCommand::create("number", "Set a number").withArgs<int>() };
+    EXPECT_TRUE(UnparsedCommand::CommandFrame(frameOf("-2147483648", wideCommands), intCommands).commandIndex());
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(frameOf("-2147483649", wideCommands), intCommands).commandIndex());
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(frameOf("2147483648", wideCommands), intCommands).commandIndex());
+    // Enums are checked against their underlying type
+    const std::tuple levelCommands { UnparsedCommand::create("number", "Set a level").withArgs<levels::Level>() };
+    EXPECT_TRUE(UnparsedCommand::CommandFrame(frameOf("-32768", wideCommands), levelCommands).commandIndex());
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(frameOf("32768", wideCommands), levelCommands).commandIndex());
+
+    // An integer of more than 10 bytes, in a frame whose size is fixed up to match
+    auto overlong = frameOf("0", wideCommands);
+    overlong.pop_back();
+    overlong.append(10, '\x80');
+    overlong.push_back('\x01');
+    overlong[details::frame::magic.size() + sizeof(std::uint8_t)] = static_cast<char>(overlong.size());
+    EXPECT_FALSE(UnparsedCommand::CommandFrame(overlong, wideCommands).commandIndex());
+}
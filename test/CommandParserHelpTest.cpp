@@ -0,0 +1,111 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserHelp.h"
+
+#include <cstdlib>
+
+using std::string_literals::operator""s;
+
+namespace {
+const auto add = UnparsedCommand::create("add"s, "Add a new item"s, "<item>"s).withAliases({ "plus" });
+const auto list = UnparsedCommand::create("list"s, "List all items"s);
+const auto remove = UnparsedCommand::create(
+    "remove"s, "Remove the items matching a pattern, asking for confirmation unless forced"s, "<pattern>"s);
+const std::tuple commands { add, list, remove };
+}
+
+TEST(CommandParserHelpTest, HelpRenderer_WhenWideEnough_WillRenderLikeHelpPrompt)
+{
+    const UnparsedCommand::HelpRenderer renderer { commands, std::numeric_limits<std::size_t>::max() / 2 };
+    std::stringstream help {};
+    renderer.render(help);
+    EXPECT_EQ(help.str(), details::createHelpPrompt(commands));
+    EXPECT_EQ(help.str(),
+              " add <item>       Add a new item\n"
+              " list             List all items\n"
+              " remove <pattern> Remove the items matching a pattern, asking for confirmation unless forced\n");
+}
+
+TEST(CommandParserHelpTest, HelpRenderer_WhenDescriptionTooLong_WillWrapItUnderItself)
+{
+    const UnparsedCommand::HelpRenderer renderer { commands, 50 };
+    std::string help {};
+    renderer.render([&help](std::string_view text) { help.append(text); });
+    EXPECT_EQ(help,
+              " add <item>       Add a new item\n"
+              " list             List all items\n"
+              " remove <pattern> Remove the items matching a\n"
+              "                  pattern, asking for confirmation\n"
+              "                  unless forced\n");
+
+    // Too narrow for the usual layout, descriptions keep a minimum width
+    std::string narrowHelp {};
+    UnparsedCommand::HelpRenderer { commands, 10 }.render([&narrowHelp](std::string_view text) {
+        narrowHelp.append(text);
+    });
+    EXPECT_THAT(narrowHelp,
+                testing::HasSubstr(" remove <pattern> Remove the items\n"
+                                   "                  matching a pattern,\n"));
+}
+
+TEST(CommandParserHelpTest, HelpRenderer_WhenSingleCommand_WillRenderOnlyIt)
+{
+    const UnparsedCommand::HelpRenderer renderer { commands, 80 };
+    std::vector<std::string_view> writes {};
+    const auto collect = [&writes](std::string_view text) { writes.push_back(text); };
+
+    ASSERT_TRUE(renderer.render("plus", collect));
+    std::string help {};
+    for (const auto text : writes) {
+        help.append(text);
+    }
+    // Aligned with the other commands even when rendered on its own
+    EXPECT_EQ(help, " add <item>       Add a new item\n");
+
+    writes.clear();
+    EXPECT_FALSE(renderer.render("unknown", collect));
+    EXPECT_TRUE(writes.empty());
+}
+
+TEST(CommandParserHelpTest, HelpRenderer_WhenSeveralCommands_WillRenderThemInOrder)
+{
+    const UnparsedCommand::HelpRenderer renderer { commands, 80 };
+    std::stringstream help {};
+    const std::vector<std::string_view> commandIds { "list", "plus" };
+    ASSERT_TRUE(renderer.render(commandIds, help));
+    EXPECT_EQ(help.str(),
+              " list             List all items\n"
+              " add <item>       Add a new item\n");
+
+    std::stringstream partialHelp {};
+    const std::array<std::string, 2> someUnknown { "unknown"s, "list"s };
+    EXPECT_FALSE(renderer.render(someUnknown, partialHelp));
+    EXPECT_EQ(partialHelp.str(), " list             List all items\n");
+}
+
+TEST(CommandParserHelpTest, HelpRenderer_WhenFile_WillWriteToIt)
+{
+    auto* const file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    const UnparsedCommand::HelpRenderer renderer { commands, 80 };
+    ASSERT_TRUE(renderer.render("list", file));
+    std::rewind(file);
+    std::array<char, 64> buffer {};
+    const auto size = std::fread(buffer.data(), 1, buffer.size(), file);
+    std::fclose(file);
+    EXPECT_EQ(std::string_view(buffer.data(), size), " list             List all items\n");
+}
+
+TEST(CommandParserHelpTest, TerminalWidth_WhenNotTerminal_WillUseColumnsVariable)
+{
+    auto* const file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    ::setenv("COLUMNS", "132", 1);
+    EXPECT_EQ(UnparsedCommand::terminalWidth(::fileno(file)), 132U);
+    ::setenv("COLUMNS", "wide", 1);
+    EXPECT_EQ(UnparsedCommand::terminalWidth(::fileno(file)), 80U);
+    ::unsetenv("COLUMNS");
+    EXPECT_EQ(UnparsedCommand::terminalWidth(::fileno(file)), 80U);
+    std::fclose(file);
+}
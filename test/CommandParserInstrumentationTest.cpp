@@ -0,0 +1,163 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserInstrumentation.h"
+#include "TestUtils.h"
+
+#include <array>
+
+namespace {
+struct RecordingInstrumentation {
+    static constexpr bool enabled { true };
+
+    static std::vector<ParsePhase>& phases()
+    {
+        static std::vector<ParsePhase> recordedPhases {};
+        return recordedPhases;
+    }
+
+    static std::vector<std::pair<ParseCounter, std::size_t>>& counts()
+    {
+        static std::vector<std::pair<ParseCounter, std::size_t>> recordedCounts {};
+        return recordedCounts;
+    }
+
+    static std::size_t allocationCount()
+    {
+        static std::size_t allocations {};
+        return allocations += 3; // Every call pretends 3 more allocations happened
+    }
+
+    void onPhase(
+        ParsePhase phase,
+        std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end)
+    {
+        EXPECT_LE(begin, end);
+        phases().push_back(phase);
+    }
+
+    void onCount(ParseCounter counter, std::size_t value) { counts().emplace_back(counter, value); }
+};
+
+struct HistogramsTag {
+};
+
+std::size_t fakeAllocationCount()
+{
+    static std::size_t allocations {};
+    return allocations += 5;
+}
+}
+
+using std::string_literals::operator""s;
+
+TEST(CommandParserInstrumentationTest, ParsedCommandImpl_WhenInstrumented_WillReportAllPhasesAndCounts)
+{
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
+                       .withArgs<int, std::string>()
+                       .withOptions({ "x", "y" });
+    constexpr int argc = 6;
+    std::array<std::string, argc> arguments { "binary"s, expectedCommand, "-xy"s, "1"s, "--unknown"s, "second"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+    RecordingInstrumentation::phases().clear();
+    RecordingInstrumentation::counts().clear();
+
+    auto parsedCommand = UnparsedCommand::parse<RecordingInstrumentation>(argc, argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    auto [firstArgument, secondArgument] = parsedCommand.getArgs(command);
+    EXPECT_EQ(firstArgument, 1);
+    EXPECT_EQ(secondArgument, "second");
+
+    std::vector expectedPhases { ParsePhase::helpGeneration,
+                                 ParsePhase::tokenization,
+                                 ParsePhase::commandLookup,
+                                 ParsePhase::optionMatching,
+                                 ParsePhase::argumentConversion };
+    EXPECT_EQ(RecordingInstrumentation::phases(), expectedPhases);
+    std::vector<std::pair<ParseCounter, std::size_t>> expectedCounts { { ParseCounter::tokens, 5 },
+                                                                       { ParseCounter::options, 2 },
+                                                                       { ParseCounter::arguments, 2 },
+                                                                       { ParseCounter::allocations, 3 } };
+    EXPECT_EQ(RecordingInstrumentation::counts(), expectedCounts);
+}
+
+TEST(CommandParserInstrumentationTest, ParsedCommandImpl_WhenUnknownCommand_WillOnlyReportPhasesThatRan)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s);
+    constexpr int argc = 2;
+    std::array<std::string, argc> arguments { "binary"s, "unknownCommand"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+    RecordingInstrumentation::phases().clear();
+
+    auto parsedCommand = UnparsedCommand::parse<RecordingInstrumentation>(argc, argv.data(), commands);
+    EXPECT_FALSE(parsedCommand.is(command));
+    std::vector expectedPhases { ParsePhase::helpGeneration, ParsePhase::tokenization, ParsePhase::commandLookup };
+    EXPECT_EQ(RecordingInstrumentation::phases(), expectedPhases);
+}
+
+TEST(CommandParserInstrumentationTest, ParseHistograms_WhenManyParses_WillAggregateAcrossParses)
+{
+    using Histograms = UnparsedCommand::ParseHistograms<HistogramsTag>;
+    Histograms::reset();
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s).withArgs<std::vector<int>>();
+    constexpr int argc = 5;
+    std::array<std::string, argc> arguments { "binary"s, expectedCommand, "1"s, "2"s, "3"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+
+    constexpr int parses { 100 };
+    for (int i = 0; i < parses; ++i) {
+        auto parsedCommand = UnparsedCommand::parse<Histograms>(argc, argv.data(), commands);
+        ASSERT_TRUE(parsedCommand.is(command));
+    }
+    Histograms::setAllocationCounter(fakeAllocationCount);
+    static_cast<void>(UnparsedCommand::parse<Histograms>(argc, argv.data(), commands));
+    Histograms::setAllocationCounter(nullptr);
+
+    for (auto phase : { ParsePhase::tokenization,
+                        ParsePhase::commandLookup,
+                        ParsePhase::optionMatching,
+                        ParsePhase::argumentConversion,
+                        ParsePhase::helpGeneration }) {
+        EXPECT_EQ(Histograms::phase(phase).snapshot().count, parses + 1);
+    }
+    const auto tokens = Histograms::counter(ParseCounter::tokens).snapshot();
+    EXPECT_EQ(tokens.count, parses + 1);
+    EXPECT_EQ(tokens.sum, 4 * (parses + 1));
+    EXPECT_EQ(tokens.max, 4);
+    EXPECT_EQ(tokens.percentile(50), 4);
+    const auto allocations = Histograms::counter(ParseCounter::allocations).snapshot();
+    EXPECT_EQ(allocations.count, 1);
+    EXPECT_EQ(allocations.max, 5);
+
+    std::stringstream report {};
+    Histograms::report(report);
+    EXPECT_THAT(report.str(), testing::HasSubstr("argument conversion"));
+    EXPECT_THAT(report.str(), testing::HasSubstr("allocations"));
+}
+
+TEST(CommandParserInstrumentationTest, Log2Histogram_WhenValuesRecorded_WillBucketByPowerOfTwo)
+{
+    static_assert(UnparsedCommand::Log2Histogram::bucketOf(0) == 0);
+    static_assert(UnparsedCommand::Log2Histogram::bucketOf(1) == 1);
+    static_assert(UnparsedCommand::Log2Histogram::bucketOf(3) == 2);
+    static_assert(UnparsedCommand::Log2Histogram::bucketOf(4) == 3);
+    static_assert(UnparsedCommand::Log2Histogram::bucketOf(std::numeric_limits<std::uint64_t>::max()) == 64);
+
+    UnparsedCommand::Log2Histogram histogram {};
+    for (std::uint64_t value = 1; value <= 100; ++value) {
+        histogram.record(value);
+    }
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 100);
+    EXPECT_EQ(snapshot.sum, 5050);
+    EXPECT_EQ(snapshot.max, 100);
+    EXPECT_EQ(snapshot.percentile(50), 63);
+    EXPECT_EQ(snapshot.percentile(100), 100);
+    EXPECT_DOUBLE_EQ(snapshot.mean(), 50.5);
+}
@@ -0,0 +1,71 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserPlugin.h"
+#include "plugin/PluginCommands.h"
+
+#include <cstdlib>
+
+namespace {
+template <std::size_t Size>
+std::optional<int> run(std::array<const char*, Size> arguments, const UnparsedCommand::PluginCommands& plugins)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return plugins.run(static_cast<int>(Size), const_cast<char**>(arguments.data()));
+}
+
+bool isPluginLoaded() { return ::dlopen(PLUGIN_PATH, RTLD_NOW | RTLD_NOLOAD) != nullptr; }
+
+UnparsedCommand::PluginCommands pluginCommands()
+{
+    UnparsedCommand::PluginCommands plugins {};
+    plugins.add(plugin::sum(), PLUGIN_PATH);
+    plugins.add(plugin::count(), PLUGIN_PATH, "command_parser_plugin_count");
+    return plugins;
+}
+}
+
+TEST(CommandParserPluginTest, PluginCommands_WhenHelpOrNoPluginCommand_WillNotLoadPlugin)
+{
+    const auto runWithoutLoading = [] {
+        const auto plugins = pluginCommands();
+        EXPECT_EQ(plugins.help(),
+                  " sum [-n] <number...> Sum numbers\n"
+                  " count <word...>      Count words\n");
+        EXPECT_TRUE(plugins.contains("add"));
+        EXPECT_FALSE(plugins.contains("version"));
+        EXPECT_EQ(run(std::array { "binary", "version" }, plugins), std::nullopt);
+        EXPECT_EQ(run(std::array { "binary" }, plugins), std::nullopt);
+        // The arity is known without the plugin
+        EXPECT_EQ(run(std::array { "binary", "sum", "-n" }, plugins), 1);
+    };
+    runWithoutLoading();
+    // The plugin stays loaded once any test runs one of its commands, so whether it gets loaded is checked in a
+    // process of its own, re-executed rather than forked so that it does not inherit the plugins loaded so far
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    EXPECT_EXIT(
+        {
+            runWithoutLoading();
+            std::exit(isPluginLoaded() ? 1 : 0);
+        },
+        testing::ExitedWithCode(0),
+        "");
+}
+
+TEST(CommandParserPluginTest, PluginCommands_WhenPluginCommandRun_WillLoadPluginAndRunIt)
+{
+    const auto plugins = pluginCommands();
+    EXPECT_EQ(run(std::array { "binary", "sum", "1", "2", "3" }, plugins), 6);
+    EXPECT_TRUE(isPluginLoaded());
+    EXPECT_EQ(run(std::array { "binary", "add", "-n", "4" }, plugins), -4);
+    EXPECT_EQ(run(std::array { "binary", "count", "a", "b" }, plugins), 2);
+}
+
+TEST(CommandParserPluginTest, PluginCommands_WhenPluginMissing_WillFail)
+{
+    UnparsedCommand::PluginCommands plugins {};
+    plugins.add(plugin::sum(), "missing_plugin.so");
+    plugins.add(plugin::count(), PLUGIN_PATH, "missing_symbol");
+    EXPECT_EQ(run(std::array { "binary", "sum", "1" }, plugins), 1);
+    EXPECT_EQ(run(std::array { "binary", "count", "a" }, plugins), 1);
+}
@@ -0,0 +1,93 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserRegistry.h"
+
+namespace {
+template <std::size_t Size>
+auto parse(std::array<const char*, Size> arguments, const UnparsedCommand::CommandRegistry& registry)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    return registry.parse(static_cast<int>(Size), const_cast<char**>(arguments.data()));
+}
+}
+
+TEST(CommandParserRegistryTest, CommandRegistry_WhenCommandAdded_WillParseItsTypedArguments)
+{
+    UnparsedCommand::CommandRegistry registry {};
+    const auto add = registry.add(UnparsedCommand::create("add", "Add an item", "<item> [count]")
+                                      .withAliases({ "plus" })
+                                      .withOptions({ "f", "force" })
+                                      .withArgs<std::string, std::optional<int>>());
+    const auto list = registry.add(UnparsedCommand::create("list", "List the items"));
+    EXPECT_EQ(registry.size(), 2U);
+
+    const auto parsedCommand = parse(std::array { "binary", "plus", "-f", "item", "3" }, registry);
+    ASSERT_EQ(parsedCommand.commandIndex(), add.index());
+    EXPECT_TRUE(parsedCommand.is(add));
+    EXPECT_FALSE(parsedCommand.is(list));
+    EXPECT_TRUE(parsedCommand.hasOption("f"));
+    EXPECT_FALSE(parsedCommand.hasOption("force"));
+    EXPECT_EQ(parsedCommand.getArgs(add), std::make_tuple(std::string { "item" }, std::optional { 3 }));
+
+    EXPECT_TRUE(parse(std::array { "binary", "list" }, registry).is(list));
+}
+
+TEST(CommandParserRegistryTest, CommandRegistry_WhenCommandMissingOrUnknown_WillHaveNoCommand)
+{
+    UnparsedCommand::CommandRegistry registry {};
+    const auto add = registry.add(UnparsedCommand::create("add", "Add an item").withArgs<int>());
+
+    EXPECT_FALSE(parse(std::array { "binary" }, registry).commandIndex());
+    EXPECT_FALSE(parse(std::array { "binary", "unknown" }, registry).commandIndex());
+    EXPECT_FALSE(parse(std::array { "binary", "add" }, registry).commandIndex());
+    const auto unknownOption = parse(std::array { "binary", "add", "--unknown", "3" }, registry);
+    EXPECT_TRUE(unknownOption.is(add));
+    EXPECT_THAT(unknownOption.getUnknownOptions(), testing::ElementsAre("unknown"));
+}
+
+TEST(CommandParserRegistryTest, CommandRegistry_WhenHandleOfAnotherRegistry_WillNotMatch)
+{
+    UnparsedCommand::CommandRegistry registry {};
+    UnparsedCommand::CommandRegistry otherRegistry {};
+    const auto add = registry.add(UnparsedCommand::create("add", "Add an item").withArgs<int>());
+    const auto otherAdd = otherRegistry.add(UnparsedCommand::create("add", "Add an item").withArgs<int>());
+
+    const auto parsedCommand = parse(std::array { "binary", "add", "1" }, registry);
+    EXPECT_TRUE(parsedCommand.is(add));
+    EXPECT_FALSE(parsedCommand.is(otherAdd));
+}
+
+TEST(CommandParserRegistryTest, CommandRegistry_WhenManyCommands_WillFindEachAndKeepTheFirstOfAnId)
+{
+    UnparsedCommand::CommandRegistry registry {};
+    constexpr std::size_t commandCount { 2000 };
+    std::vector<UnparsedCommand::CommandHandle<std::tuple<int>>> handles {};
+    for (std::size_t i = 0; i < commandCount; ++i) {
+        const auto id = "command" + std::to_string(i);
+        handles.push_back(registry.add(UnparsedCommand::create(id, "A command").withArgs<int>()));
+    }
+    const auto duplicate = registry.add(UnparsedCommand::create("command7", "A duplicate").withArgs<std::string>());
+
+    const auto parsedCommand = parse(std::array { "binary", "command1234", "42" }, registry);
+    EXPECT_TRUE(parsedCommand.is(handles[1234]));
+    EXPECT_EQ(std::get<0>(parsedCommand.getArgs(handles[1234])), 42);
+    EXPECT_TRUE(parse(std::array { "binary", "command7", "7" }, registry).is(handles[7]));
+    EXPECT_FALSE(parse(std::array { "binary", "command7", "7" }, registry).is(duplicate));
+}
+
+TEST(CommandParserRegistryTest, Help_WhenCommandsAdded_WillMatchHelpOfTuple)
+{
+    const auto add = UnparsedCommand::create("add", "Add an item", "<item>").withArgs<std::string>();
+    const auto list = UnparsedCommand::create("list", "List the items");
+    UnparsedCommand::CommandRegistry registry {};
+    registry.add(add);
+    registry.add(list);
+
+    std::array arguments { "binary", "list" };
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    auto* const argv = const_cast<char**>(arguments.data());
+    const auto tupleParsedCommand = UnparsedCommand::parse(2, argv, std::tuple { add, list });
+    EXPECT_EQ(registry.help(), tupleParsedCommand.help());
+    EXPECT_EQ(parse(arguments, registry).help(), tupleParsedCommand.help());
+}
@@ -0,0 +1,249 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserServer.h"
+
+#include <array>
+#include <stdexcept>
+
+namespace {
+/// @brief An argument whose conversion throws rather than failing through `parseValue`
+struct Throwing {
+    Throwing() = default;
+    // NOLINTNEXTLINE(google-explicit-constructor), arguments are assigned from their command line string
+    Throwing(const std::string& value)
+    {
+        if (value == "throw") {
+            throw std::runtime_error { "cannot convert" };
+        }
+    }
+};
+
+std::string socketPath(const std::string& name) { return testing::TempDir() + name + ".sock"; }
+
+template <std::size_t Size>
+std::optional<int>
+forward(const std::string& path, const std::array<const char*, Size>& arguments, std::ostream& output)
+{
+    return UnparsedCommand::forward(path, static_cast<int>(Size), arguments.data(), output);
+}
+}
+
+using std::string_literals::operator""s;
+
+TEST(CommandParserServerTest, CommandServer_WhenCommandForwarded_WillReturnHandlerOutputAndExitCode)
+{
+    const auto add = UnparsedCommand::create("add"s, "Add numbers"s).withArgs<int, int>().withAliases({ "plus" });
+    const auto echo = UnparsedCommand::create("echo"s, "Echo words"s).withArgs<std::vector<std::string>>();
+    UnparsedCommand::CommandServer server { std::tuple { add, echo } };
+    using Parsed = decltype(server)::Parsed;
+    server.on(add, [&add](const Parsed& parsed, std::ostream& output) {
+        const auto [first, second] = parsed.getArgs(add);
+        output << first + second;
+        return 0;
+    });
+    server.on(echo, [&echo](const Parsed& parsed, std::ostream& output) {
+        const auto [words] = parsed.getArgs(echo);
+        for (const auto& word : words) {
+            output << word << (parsed.hasOption("n") ? "" : "\n");
+        }
+        return 3;
+    });
+    const auto path = socketPath("command_parser_server_test");
+    ASSERT_TRUE(server.start(path, 2));
+
+    std::stringstream sum {};
+    EXPECT_EQ(forward(path, std::array { "binary", "plus", "40", "2" }, sum), 0);
+    EXPECT_EQ(sum.str(), "42");
+    std::stringstream words {};
+    EXPECT_EQ(forward(path, std::array { "binary", "echo", "hello", "world" }, words), 3);
+    EXPECT_EQ(words.str(), "hello\nworld\n");
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenCommandUnparsed_WillReturnHelpAndFailure)
+{
+    const auto add = UnparsedCommand::create("add"s, "Add numbers"s).withArgs<int, int>();
+    const auto list = UnparsedCommand::create("list"s, "List items"s);
+    UnparsedCommand::CommandServer server { std::tuple { add, list } };
+    server.on(add, [](const auto&, std::ostream&) { return 0; });
+    const auto path = socketPath("command_parser_server_unparsed_test");
+    ASSERT_TRUE(server.start(path, 1));
+
+    for (const auto* command : { "unknown", "list" }) {
+        std::stringstream output {};
+        EXPECT_EQ(forward(path, std::array { "binary", command }, output), 1) << command;
+        EXPECT_THAT(output.str(), testing::HasSubstr("Add numbers")) << command;
+    }
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "binary" }, output), 1);
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenArgumentNotANumber_WillReturnErrorAndKeepServing)
+{
+    const auto add = UnparsedCommand::create("add"s, "Add numbers"s).withArgs<int, int>();
+    UnparsedCommand::CommandServer server { std::tuple { add } };
+    server.on(add, [](const auto&, std::ostream&) { return 0; });
+    const auto path = socketPath("command_parser_server_invalid_number_test");
+    ASSERT_TRUE(server.start(path, 1));
+
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "tool", "add", "foo", "2" }, output), 1);
+    EXPECT_THAT(output.str(), testing::HasSubstr("Invalid argument \"foo\""));
+    EXPECT_THAT(output.str(), testing::HasSubstr("Add numbers"));
+    std::stringstream sum {};
+    EXPECT_EQ(forward(path, std::array { "tool", "add", "1", "2" }, sum), 0);
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenCommandThrows_WillReturnFailureAndKeepServing)
+{
+    const auto add = UnparsedCommand::create("add"s, "Add numbers"s).withArgs<int, int>();
+    const auto convert = UnparsedCommand::create("convert"s, "Convert a value"s).withArgs<Throwing>();
+    UnparsedCommand::CommandServer server { std::tuple { add, convert } };
+    server.on(add, [](const auto&, std::ostream& output) -> int {
+        output << "partial output";
+        throw std::runtime_error { "handler failed" };
+    });
+    server.on(convert, [](const auto&, std::ostream&) { return 0; });
+    const auto path = socketPath("command_parser_server_throwing_test");
+    // A single worker, which must survive every exception to serve the next command line
+    ASSERT_TRUE(server.start(path, 1));
+
+    std::stringstream handlerFailure {};
+    EXPECT_EQ(forward(path, std::array { "tool", "add", "1", "2" }, handlerFailure), 1);
+    EXPECT_EQ(handlerFailure.str(), "Command failed: handler failed\n");
+    std::stringstream conversionFailure {};
+    EXPECT_EQ(forward(path, std::array { "tool", "convert", "throw" }, conversionFailure), 1);
+    EXPECT_EQ(conversionFailure.str(), "Command failed: cannot convert\n");
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "tool", "convert", "value" }, output), 0);
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenClientIdle_WillCloseItsConnection)
+{
+    const auto list = UnparsedCommand::create("list"s, "List items"s);
+    UnparsedCommand::CommandServer server { std::tuple { list } };
+    server.on(list, [](const auto&, std::ostream&) { return 0; });
+    const auto path = socketPath("command_parser_server_idle_test");
+    ASSERT_TRUE(server.start(path, 1, std::chrono::milliseconds { 50 }));
+
+    // Holds the only worker until the idle timeout
+    sockaddr_un address {};
+    ASSERT_TRUE(details::toSocketAddress(path, address));
+    const auto idle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(idle, 0);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    ASSERT_EQ(::connect(idle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "binary", "list" }, output), 0);
+    char byte {};
+    EXPECT_FALSE(details::receiveAll(idle, &byte, sizeof(byte)));
+    ::close(idle);
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenSocketInUse_WillNotReplaceIt)
+{
+    const auto list = UnparsedCommand::create("list"s, "List items"s);
+    UnparsedCommand::CommandServer server { std::tuple { list } };
+    server.on(list, [](const auto&, std::ostream&) { return 0; });
+    const auto path = socketPath("command_parser_server_in_use_test");
+    ASSERT_TRUE(server.start(path, 1));
+
+    UnparsedCommand::CommandServer other { std::tuple { list } };
+    EXPECT_FALSE(other.start(path, 1));
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "binary", "list" }, output), 0);
+
+    // A socket nobody listens on is replaced
+    const auto stalePath = socketPath("command_parser_server_stale_test");
+    sockaddr_un address {};
+    ASSERT_TRUE(details::toSocketAddress(stalePath, address));
+    const auto stale = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(stalePath.c_str());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    ASSERT_EQ(::bind(stale, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    ::close(stale);
+    EXPECT_TRUE(other.start(stalePath, 1));
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenManyConcurrentClients_WillServeAll)
+{
+    const auto increment = UnparsedCommand::create("increment"s, "Increment a number"s).withArgs<int>();
+    UnparsedCommand::CommandServer server { std::tuple { increment } };
+    server.on(increment, [&increment](const auto& parsed, std::ostream& output) {
+        output << std::get<0>(parsed.getArgs(increment)) + 1;
+        return 0;
+    });
+    const auto path = socketPath("command_parser_server_concurrent_test");
+    ASSERT_TRUE(server.start(path, 4));
+
+    constexpr int clients { 8 };
+    constexpr int requestsPerClient { 50 };
+    std::array<int, clients> served {};
+    std::vector<std::thread> threads {};
+    for (int client = 0; client < clients; ++client) {
+        threads.emplace_back([&path, &served, client] {
+            for (int i = 0; i < requestsPerClient; ++i) {
+                const auto number = std::to_string(client * requestsPerClient + i);
+                std::stringstream output {};
+                const auto exitCode = forward(path, std::array { "binary", "increment", number.c_str() }, output);
+                if (exitCode == 0 && output.str() == std::to_string(std::stoi(number) + 1)) {
+                    ++served.at(static_cast<std::size_t>(client));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto count : served) {
+        EXPECT_EQ(count, requestsPerClient);
+    }
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenMalformedFrame_WillCloseConnection)
+{
+    const auto list = UnparsedCommand::create("list"s, "List items"s);
+    UnparsedCommand::CommandServer server { std::tuple { list } };
+    const auto path = socketPath("command_parser_server_malformed_test");
+    ASSERT_TRUE(server.start(path, 1));
+
+    sockaddr_un address {};
+    ASSERT_TRUE(details::toSocketAddress(path, address));
+    const auto connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(connection, 0);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    ASSERT_EQ(::connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    const std::array<std::uint32_t, 2> oversizedFrame { 1, std::numeric_limits<std::uint32_t>::max() };
+    ASSERT_TRUE(details::sendAll(connection, oversizedFrame.data(), sizeof(oversizedFrame)));
+    char byte {};
+    EXPECT_FALSE(details::receiveAll(connection, &byte, sizeof(byte)));
+    ::close(connection);
+
+    // The server keeps serving other clients
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "binary", "unknown" }, output), 1);
+}
+
+TEST(CommandParserServerTest, Forward_WhenNoServer_WillReturnNullopt)
+{
+    std::stringstream output {};
+    EXPECT_EQ(forward(socketPath("command_parser_no_server_test"), std::array { "binary", "list" }, output),
+              std::nullopt);
+    EXPECT_TRUE(output.str().empty());
+}
+
+TEST(CommandParserServerTest, CommandServer_WhenStopped_WillRemoveSocket)
+{
+    const auto list = UnparsedCommand::create("list"s, "List items"s);
+    UnparsedCommand::CommandServer server { std::tuple { list } };
+    const auto path = socketPath("command_parser_server_stop_test");
+    ASSERT_TRUE(server.start(path, 2));
+    EXPECT_FALSE(server.start(path, 2));
+    server.stop();
+
+    std::stringstream output {};
+    EXPECT_EQ(forward(path, std::array { "binary", "list" }, output), std::nullopt);
+    // It can be started again
+    ASSERT_TRUE(server.start(path, 1));
+    EXPECT_EQ(forward(path, std::array { "binary", "list" }, output), 1);
+}
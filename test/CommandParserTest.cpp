@@ -2,20 +2,40 @@
 #include <gtest/gtest.h>
 
 #include "CommandParser.h"
+#include "TestUtils.h"
 
 #include <array>
+#include <charconv>
 
-namespace {
-template <std::size_t Size>
-std::vector<char*> toArgv(std::array<std::string, Size>& arguments)
+namespace units {
+// Only convertible through `parseValue`, found by argument-dependent lookup
+struct ByteSize {
+    std::size_t bytes {};
+    bool operator==(const ByteSize& other) const { return bytes == other.bytes; }
+};
+
+std::errc parseValue(std::string_view text, ByteSize& value)
 {
-    std::vector<char*> argv {};
-    for (auto& argument : arguments) {
-        argv.push_back(const_cast<char*>(argument.c_str()));
+    const auto multiplier = !text.empty() && text.back() == 'k' ? 1024U : 1U;
+    if (multiplier != 1U) {
+        text.remove_suffix(1);
     }
-    argv.push_back(nullptr);
+    std::size_t number {};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (error != std::errc {} || end != text.data() + text.size() || text.empty()) {
+        return std::errc::invalid_argument;
+    }
+    value.bytes = number * multiplier;
+    return {};
+}
+}
+
+namespace modes {
+enum class Mode { fast, safe, paranoid };
 
-    return argv;
+constexpr std::array<std::pair<std::string_view, Mode>, 3> argumentKeywords(Mode)
+{
+    return { { { "fast", Mode::fast }, { "safe", Mode::safe }, { "paranoid", Mode::paranoid } } };
 }
 }
 
@@ -855,6 +875,20 @@ TEST(CommandParserTest, ParsedCommandImpl_WhenInvalidNumericalArgument_WillCrash
     EXPECT_DEATH(shouldAbort(), "");
 }
 
+TEST(CommandParserTest, ParsedCommandImpl_WhenNumberHasTrailingCharacters_WillCrash)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withArgs<int, double>();
+    std::tuple commands { command };
+    // Rejected by validate as well, so that every parse accepts the same numbers
+    const auto parseOf = [&commands](std::array<std::string, 4> arguments) {
+        auto argv = toArgv(arguments);
+        return UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    };
+    EXPECT_EQ(parseOf({ "binary"s, "dummyCommand"s, "+12"s, "2.5"s }).getArgs(command), std::tuple(12, 2.5));
+    EXPECT_DEATH(static_cast<void>(parseOf({ "binary"s, "dummyCommand"s, "12abc"s, "2.5"s })), "");
+    EXPECT_DEATH(static_cast<void>(parseOf({ "binary"s, "dummyCommand"s, "12"s, "2.5x"s })), "");
+}
+
 TEST(CommandParserTest, ParsedCommandImpl_WhenOptionSuppliedWithDashes_WillForgiveAndParse)
 {
     std::string expectedCommand { "dummyCommand" };
@@ -1096,10 +1130,11 @@ TEST(CommandParserTest, ParsedCommandImpl_WhenArgumentStartingWithMoreThanTwoDas
 
     auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
                        .withArgs<std::string, std::string, std::string, std::string, std::string>();
-    constexpr int argc = 7;
+    constexpr int argc = 8;
     std::array<std::string, argc> arguments {
         "binary"s,         expectedCommand, firstArgument, startWithTripleDashArg, tooShortToBeAnOptionArg,
-        containsSpacesArg, justTwoDashesArg
+        containsSpacesArg, "--"s, // Ends the options, so that the next "--" is an argument
+        justTwoDashesArg
     };
 
     auto argv = toArgv(arguments);
@@ -1135,3 +1170,665 @@ TEST(CommandParserTest, ParsedCommandImpl_WhenArgumentStartsWithEscapedHyphen_Wi
     auto expectedParsedArgument = firstArgument.substr(1); // -bar
     EXPECT_EQ(firstParsedArgument, expectedParsedArgument);
 }
+
+TEST(CommandParserTest, EnvironmentIndex_WhenPrefixSupplied_WillOnlyIndexMatchingVariables)
+{
+    std::array<const char*, 5> environment { "TOOL_THREADS=4", "OTHER=1", "TOOL_THREADS=8", "TOOL_EMPTY=", nullptr };
+
+    details::EnvironmentIndex index { environment.data(), "TOOL_" };
+    EXPECT_EQ(index.find("TOOL_THREADS"), "4");
+    EXPECT_EQ(index.find("TOOL_EMPTY"), "");
+    EXPECT_FALSE(index.find("OTHER"));
+    EXPECT_FALSE(index.find("TOOL_"));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionalArgumentMissingAndEnvironmentSet_WillUseEnvironment)
+{
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
+                       .withArgs<std::string, std::optional<int>, std::optional<std::string>>()
+                       .withEnvArg<1>("TOOL_THREADS")
+                       .withEnvArg<2>("TOOL_UNSET");
+    constexpr int argc = 3;
+    std::array<std::string, argc> arguments { "binary"s, expectedCommand, "firstArgument"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+    std::array<const char*, 2> environment { "TOOL_THREADS=12", nullptr };
+
+    auto parsedCommand
+        = UnparsedCommand::parse(argc, argv.data(), commands, details::EnvironmentIndex { environment.data() });
+    ASSERT_TRUE(parsedCommand.is(command));
+    auto [firstArgument, threads, unset] = parsedCommand.getArgs(command);
+    EXPECT_EQ(firstArgument, "firstArgument");
+    EXPECT_EQ(threads, 12);
+    EXPECT_FALSE(unset);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionalArgumentSuppliedAndEnvironmentSet_WillPreferCommandLine)
+{
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
+                       .withArgs<std::optional<int>>()
+                       .withEnvArg<0>("TOOL_THREADS")
+                       .withAliases({ "alias" });
+    constexpr int argc = 3;
+    std::array<std::string, argc> arguments { "binary"s, "alias"s, "3"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+    std::array<const char*, 2> environment { "TOOL_THREADS=12", nullptr };
+
+    auto parsedCommand
+        = UnparsedCommand::parse(argc, argv.data(), commands, details::EnvironmentIndex { environment.data() });
+    ASSERT_TRUE(parsedCommand.is(command));
+    auto [threads] = parsedCommand.getArgs(command);
+    EXPECT_EQ(threads, 3);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionFallsBackToEnvironment_WillEnableOptionOnlyWhenTrue)
+{
+    std::string expectedCommand { "dummyCommand" };
+    auto command = UnparsedCommand::create(expectedCommand, "dummyDescription"s)
+                       .withEnvOption("--verbose", "TOOL_VERBOSE")
+                       .withEnvOption("dry-run", "TOOL_DRY_RUN")
+                       .withEnvOption("force", "TOOL_FORCE");
+    constexpr int argc = 3;
+    std::array<std::string, argc> arguments { "binary"s, expectedCommand, "--force"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+    std::array<const char*, 4> environment { "TOOL_VERBOSE=yes", "TOOL_DRY_RUN=off", "TOOL_FORCE=0", nullptr };
+
+    auto parsedCommand
+        = UnparsedCommand::parse(argc, argv.data(), commands, details::EnvironmentIndex { environment.data() });
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_TRUE(parsedCommand.hasOption("verbose"));
+    EXPECT_FALSE(parsedCommand.hasOption("dry-run"));
+    EXPECT_TRUE(parsedCommand.hasOption("force"));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionFallsBackToNonBoolean_WillReportItAndNotParse)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withEnvOption("force", "TOOL_FORCE");
+    constexpr int argc = 2;
+    std::array<std::string, argc> arguments { "binary"s, "dummyCommand"s };
+    auto argv = toArgv(arguments);
+    std::tuple commands { command };
+    std::array<const char*, 2> environment { "TOOL_FORCE=maybe", nullptr };
+
+    testing::internal::CaptureStderr();
+    auto parsedCommand
+        = UnparsedCommand::parse(argc, argv.data(), commands, details::EnvironmentIndex { environment.data() });
+    EXPECT_THAT(testing::internal::GetCapturedStderr(),
+                testing::HasSubstr("Invalid argument \"maybe\", the fallback of option \"force\" is not a boolean"));
+    EXPECT_FALSE(parsedCommand.commandIndex());
+    EXPECT_FALSE(parsedCommand.hasOption("force"));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenParsedWithCommandTable_WillMatchCommandsLikeWithoutTable)
+{
+    auto firstCommand = UnparsedCommand::create("first"s, "dummyDescription"s).withAliases({ "shared" });
+    auto secondCommand
+        = UnparsedCommand::create("second"s, "dummyDescription"s).withAliases({ "shared", "s" }).withArgs<int>();
+    std::tuple commands { firstCommand, secondCommand };
+    const details::CommandTable table { commands };
+
+    for (const auto& commandId : { "first"s, "shared"s, "s"s, "second"s, "unknown"s }) {
+        constexpr int argc = 3;
+        std::array<std::string, argc> arguments { "binary"s, commandId, "1"s };
+        auto argv = toArgv(arguments);
+        const auto withTable = UnparsedCommand::parse(argc, argv.data(), commands, table);
+        const auto withoutTable = UnparsedCommand::parse(argc, argv.data(), commands);
+        EXPECT_EQ(withTable.commandIndex(), withoutTable.commandIndex()) << commandId;
+        EXPECT_EQ(withTable.is(firstCommand), withoutTable.is(firstCommand)) << commandId;
+        EXPECT_EQ(withTable.is(secondCommand), withoutTable.is(secondCommand)) << commandId;
+        EXPECT_EQ(withTable.help(), withoutTable.help());
+    }
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenProgramNameIsCommand_WillParseMultiCall)
+{
+    auto add = UnparsedCommand::create("add"s, "dummyDescription"s).withArgs<int, int>().withOptions({ "v" });
+    auto list = UnparsedCommand::create("list"s, "dummyDescription"s).withAliases({ "ls" });
+    std::tuple commands { add, list };
+    const details::CommandTable table { commands };
+
+    constexpr int argc = 4;
+    std::array<std::string, argc> arguments { "/usr/local/bin/add"s, "-v"s, "1"s, "2"s };
+    auto argv = toArgv(arguments);
+    for (const auto& parsedCommand : { UnparsedCommand::parseMultiCall(argc, argv.data(), commands),
+                                       UnparsedCommand::parseMultiCall(argc, argv.data(), commands, table) }) {
+        ASSERT_TRUE(parsedCommand.is(add));
+        EXPECT_EQ(parsedCommand.getArgs(add), std::make_tuple(1, 2));
+        EXPECT_TRUE(parsedCommand.hasOption("v"));
+    }
+
+    std::array<std::string, 1> aliasArguments { "ls"s };
+    auto aliasArgv = toArgv(aliasArguments);
+    EXPECT_TRUE(UnparsedCommand::parseMultiCall(1, aliasArgv.data(), commands, table).is(list));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenProgramNameIsNotCommand_WillFallBackToFirstArgument)
+{
+    auto add = UnparsedCommand::create("add"s, "dummyDescription"s).withArgs<int, int>();
+    auto list = UnparsedCommand::create("list"s, "dummyDescription"s);
+    std::tuple commands { add, list };
+    const details::CommandTable table { commands };
+
+    constexpr int argc = 4;
+    std::array<std::string, argc> arguments { "./tool"s, "add"s, "1"s, "2"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parseMultiCall(argc, argv.data(), commands, table);
+    ASSERT_TRUE(parsedCommand.is(add));
+    EXPECT_EQ(parsedCommand.getArgs(add), std::make_tuple(1, 2));
+
+    // The usual parse never resolves the program name
+    std::array<std::string, 2> listArguments { "list"s, "-x"s };
+    auto listArgv = toArgv(listArguments);
+    EXPECT_FALSE(UnparsedCommand::parse(2, listArgv.data(), commands).is(list));
+    EXPECT_TRUE(UnparsedCommand::parseMultiCall(2, listArgv.data(), commands).is(list));
+
+    std::array<std::string, 1> toolArguments { "tool"s };
+    auto toolArgv = toArgv(toolArguments);
+    EXPECT_FALSE(UnparsedCommand::parseMultiCall(1, toolArgv.data(), commands).commandIndex());
+}
+
+TEST(CommandParserTest, Dispatch_WhenCommandParsed_WillCallItsHandlerWithMovedArguments)
+{
+    auto list = UnparsedCommand::create("list"s, "dummyDescription"s);
+    auto put = UnparsedCommand::create("put"s, "dummyDescription"s).withArgs<std::string, std::vector<std::string>>();
+    auto get = UnparsedCommand::create("get"s, "dummyDescription"s).withArgs<int>().withOptions({ "x" });
+    std::tuple commands { list, put, get };
+    const auto fallback = [](const auto&) { return -1; };
+    const auto onList = [] { return 0; };
+    const auto onPut = [](std::string key, std::vector<std::string>&& values) {
+        std::vector<std::string> stolen { std::move(values) };
+        return static_cast<int>(key.size() + stolen.size());
+    };
+    const auto onGet = [](const auto& parsedCommand, int value) { return parsedCommand.hasOption("x") ? value : 0; };
+
+    std::array<std::string, 5> putArguments { "binary"s, "put"s, "key"s, "first"s, "second"s };
+    auto putArgv = toArgv(putArguments);
+    EXPECT_EQ(
+        UnparsedCommand::dispatch(
+            UnparsedCommand::parse(5, putArgv.data(), commands), fallback, onList, onPut, onGet),
+        5);
+
+    std::array<std::string, 4> getArguments { "binary"s, "get"s, "-x"s, "42"s };
+    auto getArgv = toArgv(getArguments);
+    auto parsedGet = UnparsedCommand::parse(4, getArgv.data(), commands);
+    EXPECT_EQ(UnparsedCommand::dispatch(std::move(parsedGet), fallback, onList, onPut, onGet), 42);
+
+    std::array<std::string, 2> listArguments { "binary"s, "list"s };
+    auto listArgv = toArgv(listArguments);
+    EXPECT_EQ(
+        UnparsedCommand::dispatch(
+            UnparsedCommand::parse(2, listArgv.data(), commands), fallback, onList, onPut, onGet),
+        0);
+}
+
+TEST(CommandParserTest, Dispatch_WhenNoCommandParsed_WillCallFallback)
+{
+    auto list = UnparsedCommand::create("list"s, "dummyDescription"s);
+    std::tuple commands { list };
+    std::array<std::string, 2> arguments { "binary"s, "unknown"s };
+    auto argv = toArgv(arguments);
+
+    bool listCalled {};
+    std::string help {};
+    UnparsedCommand::dispatch(
+        UnparsedCommand::parse(2, argv.data(), commands),
+        [&help](const auto& parsedCommand) { help = parsedCommand.help(); },
+        [&listCalled] { listCalled = true; });
+    EXPECT_FALSE(listCalled);
+    EXPECT_THAT(help, testing::HasSubstr("list"));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenCustomTypeHasParseValue_WillParseThroughIt)
+{
+    using units::ByteSize;
+    static_assert(details::hasParseValue<ByteSize>::value && !details::hasParseValue<int>::value);
+    auto truncate = UnparsedCommand::create("truncate"s, "dummyDescription"s)
+                        .withArgs<ByteSize, std::optional<ByteSize>>()
+                        .withArgDefault<1>("1k");
+    auto split = UnparsedCommand::create("split"s, "dummyDescription"s).withArgs<std::vector<ByteSize>>();
+    std::tuple commands { truncate, split };
+
+    std::array arguments { "binary"s, "truncate"s, "2k"s };
+    auto argv = toArgv(arguments);
+    const auto truncated = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(truncated.is(truncate));
+    EXPECT_EQ(truncated.getArgs(truncate), std::make_tuple(ByteSize { 2048 }, std::optional { ByteSize { 1024 } }));
+
+    std::array splitArguments { "binary"s, "split"s, "1"s, "10k"s };
+    auto splitArgv = toArgv(splitArguments);
+    const auto splitted = UnparsedCommand::parse(static_cast<int>(splitArguments.size()), splitArgv.data(), commands);
+    ASSERT_TRUE(splitted.is(split));
+    EXPECT_EQ(std::get<0>(splitted.getArgs(split)), (std::vector { ByteSize { 1 }, ByteSize { 10240 } }));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenParseValueFails_WillNotParse)
+{
+    auto split = UnparsedCommand::create("split"s, "dummyDescription"s).withArgs<std::vector<units::ByteSize>>();
+    std::tuple commands { split };
+
+    std::array arguments { "binary"s, "split"s, "1k"s, "lots"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    EXPECT_FALSE(parsedCommand.is(split));
+    EXPECT_FALSE(parsedCommand.commandIndex());
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenArgumentIsKeyword_WillParseIgnoringCase)
+{
+    using modes::Mode;
+    auto run = UnparsedCommand::create("run"s, "dummyDescription"s).withArgs<Mode, std::vector<Mode>>();
+    std::tuple commands { run };
+
+    std::array arguments { "binary"s, "run"s, "fast"s, "SAFE"s, "Paranoid"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(run));
+    EXPECT_EQ(parsedCommand.getArgs(run), std::make_tuple(Mode::fast, std::vector { Mode::safe, Mode::paranoid }));
+
+    for (const auto& unknown : { "slow"s, "fas"s, "fastt"s, ""s }) {
+        std::array unknownArguments { "binary"s, "run"s, unknown };
+        auto unknownArgv = toArgv(unknownArguments);
+        EXPECT_FALSE(UnparsedCommand::parse(3, unknownArgv.data(), commands).is(run)) << unknown;
+    }
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenBooleanIsNotKeyword_WillNotParse)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withArgs<bool, bool, bool>();
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "N"s, "No"s, "FALSE"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_EQ(parsedCommand.getArgs(command), std::make_tuple(false, false, false));
+
+    for (const auto& invalid : { "maybe"s, "t"s, "ye"s, "2"s, "o"s }) {
+        std::array invalidArguments { "binary"s, "dummyCommand"s, "true"s, invalid, "false"s };
+        auto invalidArgv = toArgv(invalidArguments);
+        EXPECT_FALSE(UnparsedCommand::parse(5, invalidArgv.data(), commands).is(command)) << invalid;
+    }
+}
+
+TEST(CommandParserTest, KeywordTable_WhenConstructedAtCompileTime_WillFindEveryKeywordOnly)
+{
+    static constexpr details::KeywordTable table { argumentKeywords(modes::Mode {}) };
+    static_assert(table.isPerfect());
+    static_assert(table.find("PARANOID") == modes::Mode::paranoid);
+    static_assert(!table.find("paranoi"));
+
+    constexpr std::array<std::pair<std::string_view, int>, 2> duplicates { { { "same", 1 }, { "SAME", 2 } } };
+    static_assert(!details::KeywordTable { duplicates }.isPerfect());
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionConstraintsSatisfied_WillParse)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withConflictingOptions({ "force", "--dry-run" })
+                       .withRequiredOptions("x", { "y" })
+                       .withExactlyOneOption({ "json", "yaml" })
+                       .withAtLeastOneOption({ "a", "b" })
+                       .withOptions({ "v" });
+    std::tuple commands { command };
+
+    const auto parses = [&commands, &command](auto arguments) {
+        auto argv = toArgv(arguments);
+        const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+        return parsedCommand.is(command) && parsedCommand.getOptionViolations().empty();
+    };
+    EXPECT_TRUE(parses(std::array { "binary"s, "dummyCommand"s, "--json"s, "-a"s }));
+    EXPECT_TRUE(parses(std::array { "binary"s, "dummyCommand"s, "--yaml"s, "-abxy"s, "--force"s }));
+    EXPECT_TRUE(parses(std::array { "binary"s, "dummyCommand"s, "--json"s, "-b"s, "-y"s, "--dry-run"s }));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionConstraintsViolated_WillNotParseAndReportThem)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withConflictingOptions({ "force", "dry-run" })
+                       .withRequiredOptions("x", { "y", "z" })
+                       .withExactlyOneOption({ "json", "yaml" })
+                       .withAtLeastOneOption({ "a", "b" });
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "--force"s, "--dry-run"s, "-xy"s, "--json"s, "--yaml"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    EXPECT_FALSE(parsedCommand.is(command));
+    const auto& violations = parsedCommand.getOptionViolations();
+    ASSERT_EQ(violations.size(), 4U);
+    EXPECT_EQ(violations[0].constraint, OptionConstraint::conflicting);
+    EXPECT_THAT(violations[0].options, testing::ElementsAre("force", "dry-run"));
+    EXPECT_EQ(violations[1].constraint, OptionConstraint::requiring);
+    EXPECT_THAT(violations[1].options, testing::ElementsAre("x", "y", "z"));
+    EXPECT_EQ(violations[2].constraint, OptionConstraint::exactlyOne);
+    EXPECT_EQ(violations[3].constraint, OptionConstraint::atLeastOne);
+
+    std::array noneOfExactlyOne { "binary"s, "dummyCommand"s, "-a"s };
+    auto noneArgv = toArgv(noneOfExactlyOne);
+    const auto noneParsed = UnparsedCommand::parse(3, noneArgv.data(), commands);
+    ASSERT_EQ(noneParsed.getOptionViolations().size(), 1U);
+    EXPECT_EQ(noneParsed.getOptionViolations()[0].constraint, OptionConstraint::exactlyOne);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenConstrainedCommandHasMoreThan64Options_WillNotParse)
+{
+    std::unordered_set<std::string> options {};
+    for (int i = 0; i < 70; ++i) {
+        options.emplace("option" + std::to_string(i));
+    }
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions(options)
+                       .withConflictingOptions({ "option0", "option69" });
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "--option68"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    EXPECT_FALSE(parsedCommand.is(command));
+    ASSERT_EQ(parsedCommand.getOptionViolations().size(), 1U);
+    EXPECT_EQ(parsedCommand.getOptionViolations()[0].constraint, OptionConstraint::conflicting);
+
+    const auto validated = UnparsedCommand::validate(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_EQ(validated.getErrors().size(), 1U);
+    EXPECT_EQ(validated.getErrors()[0].kind, ParseErrorKind::unsatisfiedOptionConstraint);
+}
+
+TEST(CommandParserTest, UnparsedCommandImpl_WhenOptionsAddedAfterConstraints_WillKeepConstraintsOnTheSameOptions)
+{
+    // Adding options shifts the indices of the constrained ones
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withConflictingOptions({ "m", "n" })
+                       .withOptions({ "a", "b", "c" })
+                       .withEnvOption("d", "DUMMY_VARIABLE");
+    std::tuple commands { command };
+
+    std::array conflicting { "binary"s, "dummyCommand"s, "-mn"s };
+    auto conflictingArgv = toArgv(conflicting);
+    EXPECT_FALSE(UnparsedCommand::parse(3, conflictingArgv.data(), commands).is(command));
+    std::array unrelated { "binary"s, "dummyCommand"s, "-abcm"s };
+    auto unrelatedArgv = toArgv(unrelated);
+    EXPECT_TRUE(UnparsedCommand::parse(3, unrelatedArgv.data(), commands).is(command));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionRepeated_WillCountOccurrencesAndKeepPositions)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "v", "verbose", "x" })
+                       .withArgs<std::vector<std::string>>();
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "-vvx"s, "first"s, "--verbose"s, "--v"s, "second"s, "-v"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_EQ(parsedCommand.optionCount("v"), 4U);
+    EXPECT_EQ(parsedCommand.optionCount("--verbose"), 1U);
+    EXPECT_EQ(parsedCommand.optionCount("unknown"), 0U);
+    EXPECT_THAT(parsedCommand.optionPositions("v"), testing::ElementsAre(2, 2, 5, 7));
+    EXPECT_THAT(parsedCommand.optionPositions("x"), testing::ElementsAre(2));
+    EXPECT_TRUE(parsedCommand.optionPositions("unknown").empty());
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionRepeatedOften_WillKeepCountingPastKeptPositions)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withOptions({ "v" });
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "-vvvvvvvvvv"s, "-v"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    EXPECT_EQ(parsedCommand.optionCount("v"), 11U);
+    EXPECT_EQ(parsedCommand.optionPositions("v").size(), details::OptionOccurrences::maxPositions);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenCommandsGone_WillStillLookOptionsUp)
+{
+    std::array arguments { "binary"s, "dummyCommand"s, "-vv"s, "--force"s };
+    auto argv = toArgv(arguments);
+    // The tuple of commands is a temporary, only the sorted options are shared with the parsed command
+    const auto parsedCommand = UnparsedCommand::parse(
+        static_cast<int>(arguments.size()),
+        argv.data(),
+        std::tuple { UnparsedCommand::create("dummyCommand"s, "dummyDescription"s).withOptions({ "v", "force" }) });
+    constexpr std::string_view force { "--force" };
+    EXPECT_TRUE(parsedCommand.hasOption(force));
+    EXPECT_EQ(parsedCommand.optionCount("v"), 2U);
+    EXPECT_THAT(parsedCommand.optionPositions("v"), testing::ElementsAre(2U, 2U));
+    EXPECT_FALSE(parsedCommand.hasOption("unknown"));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenTypedDefaultsNotRead_WillNotComputeThem)
+{
+    int providerCalls {};
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withArgs<std::string, std::optional<int>, std::optional<std::string>>()
+                       .withArgDefault<1>(42)
+                       .withArgDefault<2>([&providerCalls] {
+                           ++providerCalls;
+                           return "computed"s;
+                       });
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "first"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_EQ(parsedCommand.getArg<0>(command), "first");
+    EXPECT_EQ(parsedCommand.getArg<1>(command), 42);
+    EXPECT_EQ(providerCalls, 0);
+
+    EXPECT_EQ(parsedCommand.getArg<2>(command), "computed");
+    EXPECT_EQ(providerCalls, 1);
+    EXPECT_EQ(
+        parsedCommand.getArgs(command), std::make_tuple("first"s, std::optional { 42 }, std::optional { "computed"s }));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenOptionalArgumentSupplied_WillNotComputeTypedDefault)
+{
+    int providerCalls {};
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withArgs<std::optional<int>>()
+                       .withArgDefault<0>([&providerCalls] { return ++providerCalls; })
+                       .withOptions({ "v" }); // Copying the command keeps the default
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "7"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    EXPECT_EQ(parsedCommand.getArgs(command), std::make_tuple(std::optional { 7 }));
+
+    std::array omitted { "binary"s, "dummyCommand"s };
+    auto omittedArgv = toArgv(omitted);
+    const auto omittedCommand = UnparsedCommand::parse(2, omittedArgv.data(), commands);
+    EXPECT_EQ(omittedCommand.getArg<0>(command), 1);
+    EXPECT_EQ(providerCalls, 1);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenTypedDefaultReadRepeatedly_WillComputeItOnce)
+{
+    int providerCalls {};
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withArgs<std::optional<int>, std::optional<std::string>>()
+                       .withArgDefault<0>([&providerCalls] { return ++providerCalls; })
+                       .withArgDefault<1>("constant"s);
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    const auto expected = std::make_tuple(std::optional { 1 }, std::optional { "constant"s });
+    EXPECT_EQ(parsedCommand.getArg<0>(command), 1);
+    EXPECT_EQ(parsedCommand.getArg<0>(command), 1);
+    EXPECT_EQ(parsedCommand.getArgs(command), expected);
+    EXPECT_EQ(parsedCommand.getArgs(command), expected);
+    // Copies share what was already computed
+    const auto copy = parsedCommand;
+    EXPECT_EQ(copy.getArgs(command), expected);
+    EXPECT_EQ(providerCalls, 1);
+
+    // Another parse computes it again, once
+    auto dispatched = UnparsedCommand::dispatch(
+        UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands),
+        [](const auto&) { return std::optional<int> {}; },
+        [](std::optional<int> first, const std::optional<std::string>& second) {
+            EXPECT_EQ(second, "constant");
+            return first;
+        });
+    EXPECT_EQ(dispatched, 2);
+    EXPECT_EQ(providerCalls, 2);
+}
+
+TEST(CommandParserTest, ArgumentDefault_WhenCopiedFromNonConst_WillCopyTheDefault)
+{
+    int providerCalls {};
+    details::ArgumentDefault<int> provided { [&providerCalls] { return ++providerCalls; } };
+    details::ArgumentDefault<int> copy { provided };
+    EXPECT_EQ(copy.get(), 1);
+    details::ArgumentDefault<std::string> constant { "constant" };
+    details::ArgumentDefault<std::string> constantCopy { constant };
+    EXPECT_EQ(constantCopy.get(), "constant");
+    EXPECT_FALSE(details::ArgumentDefault<int> {});
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenValidated_WillCollectEveryErrorWithItsPosition)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "v", "q" })
+                       .withExactlyOneOption({ "v", "q" })
+                       .withArgs<int, bool>();
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "12abc"s, "--bogus"s, "maybe"s, "extra"s, "-vq"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::validate(static_cast<int>(arguments.size()), argv.data(), commands);
+    EXPECT_FALSE(parsedCommand.commandIndex());
+    using Error = std::pair<ParseErrorKind, std::optional<std::size_t>>;
+    std::vector<Error> errors {};
+    for (const auto& error : parsedCommand.getErrors()) {
+        errors.emplace_back(error.kind, error.position);
+    }
+    EXPECT_THAT(errors,
+                testing::ElementsAre(Error { ParseErrorKind::wrongArgumentCount, 5 },
+                                     Error { ParseErrorKind::unknownOption, 3 },
+                                     Error { ParseErrorKind::unsatisfiedOptionConstraint, std::nullopt },
+                                     Error { ParseErrorKind::invalidArgument, 2 },
+                                     Error { ParseErrorKind::invalidArgument, 4 }));
+    EXPECT_EQ(parsedCommand.getErrors()[1].message, "Unknown option: bogus");
+
+    std::array missing { "binary"s, "dummyCommand"s, "-v"s };
+    auto missingArgv = toArgv(missing);
+    const auto missingCommand
+        = UnparsedCommand::validate(static_cast<int>(missing.size()), missingArgv.data(), commands);
+    ASSERT_EQ(missingCommand.getErrors().size(), 1U);
+    EXPECT_EQ(missingCommand.getErrors()[0].kind, ParseErrorKind::wrongArgumentCount);
+    EXPECT_EQ(missingCommand.getErrors()[0].position, 3U);
+
+    std::array unknown { "binary"s, "unknownCommand"s };
+    auto unknownArgv = toArgv(unknown);
+    const auto unknownCommand
+        = UnparsedCommand::validate(static_cast<int>(unknown.size()), unknownArgv.data(), commands);
+    ASSERT_EQ(unknownCommand.getErrors().size(), 1U);
+    EXPECT_EQ(unknownCommand.getErrors()[0].kind, ParseErrorKind::unknownCommand);
+    EXPECT_EQ(unknownCommand.getErrors()[0].position, 1U);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenValidatedWithoutErrors_WillParseAsUsual)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "v" })
+                       .withArgs<int, double, std::optional<unsigned long>>()
+                       .withArgDefault<2>("8");
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "+7"s, "-v"s, "-2.5"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::validate(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_TRUE(parsedCommand.getErrors().empty());
+    EXPECT_TRUE(parsedCommand.hasOption("v"));
+    EXPECT_EQ(parsedCommand.getArgs(command), std::make_tuple(7, -2.5, std::optional { 8UL }));
+
+    // Unlike a parse, which would throw, an out of range number is an error
+    std::array outOfRange { "binary"s, "dummyCommand"s, "99999999999"s, "1"s };
+    auto outOfRangeArgv = toArgv(outOfRange);
+    const auto outOfRangeCommand
+        = UnparsedCommand::validate(static_cast<int>(outOfRange.size()), outOfRangeArgv.data(), commands);
+    ASSERT_EQ(outOfRangeCommand.getErrors().size(), 1U);
+    EXPECT_EQ(outOfRangeCommand.getErrors()[0].kind, ParseErrorKind::invalidArgument);
+    EXPECT_EQ(outOfRangeCommand.getErrors()[0].position, 2U);
+}
+
+TEST(CommandParserTest, LexWord_WhenWordsLexed_WillClassifyThemInOnePass)
+{
+    using details::TokenKind;
+    const auto lexed = [](std::string_view word, bool optionsEnded = false) {
+        const auto token = details::lexWord(word, optionsEnded);
+        return std::pair { token.kind, std::string { token.text(word) } };
+    };
+    EXPECT_EQ(lexed("--"), std::pair(TokenKind::endOfOptions, "--"s));
+    EXPECT_EQ(lexed("-xyz"), std::pair(TokenKind::shortOptions, "xyz"s));
+    EXPECT_EQ(lexed("--dry-run"), std::pair(TokenKind::longOption, "dry-run"s));
+    EXPECT_EQ(lexed("--level=a b=c"), std::pair(TokenKind::longOptionWithValue, "level"s));
+    EXPECT_EQ(details::lexWord("--level=a b=c").value("--level=a b=c"), "a b=c");
+    EXPECT_EQ(lexed("--level="), std::pair(TokenKind::longOptionWithValue, "level"s));
+    EXPECT_EQ(lexed("-1"), std::pair(TokenKind::argument, "-1"s));
+    EXPECT_EQ(lexed("-.5"), std::pair(TokenKind::argument, "-.5"s));
+    EXPECT_EQ(lexed("-"), std::pair(TokenKind::argument, "-"s));
+    EXPECT_EQ(lexed("---x"), std::pair(TokenKind::argument, "---x"s));
+    EXPECT_EQ(lexed("--x y"), std::pair(TokenKind::argument, "--x y"s));
+    EXPECT_EQ(lexed("\\-x"), std::pair(TokenKind::argument, "-x"s));
+    EXPECT_EQ(lexed("\\\\x"), std::pair(TokenKind::argument, "\\x"s));
+    EXPECT_EQ(lexed("\\x"), std::pair(TokenKind::argument, "\\x"s));
+    EXPECT_EQ(lexed("-x", true), std::pair(TokenKind::argument, "-x"s));
+    static_assert(details::lexWord("--force").kind == TokenKind::longOption);
+    static_assert(sizeof(details::Token) <= 12);
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenDoubleDash_WillTreatRemainingWordsAsArgumentsAsTheyAre)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "f", "force" })
+                       .withArgs<std::vector<std::string>>();
+    std::tuple commands { command };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "-f"s, "\\\\x"s, "--"s, "--force"s, "\\-x"s, "--"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands);
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_TRUE(parsedCommand.hasOption("f"));
+    EXPECT_FALSE(parsedCommand.hasOption("force"));
+    EXPECT_THAT(std::get<0>(parsedCommand.getArgs(command)), testing::ElementsAre("\\x", "--force", "\\-x", "--"));
+}
+
+TEST(CommandParserTest, ParsedCommandImpl_WhenLongOptionHasValue_WillEnableItOnlyIfTrue)
+{
+    auto command = UnparsedCommand::create("dummyCommand"s, "dummyDescription"s)
+                       .withOptions({ "verbose", "color" })
+                       .withEnvOption("force", "TOOL_FORCE")
+                       .withArgs<std::optional<double>>();
+    std::tuple commands { command };
+    std::array<const char*, 2> environment { "TOOL_FORCE=1", nullptr };
+
+    std::array arguments { "binary"s, "dummyCommand"s, "--verbose=yes"s, "--force=no"s, "--color=off"s, "-.5"s,
+                           "--unknown=1"s };
+    auto argv = toArgv(arguments);
+    const auto parsedCommand = UnparsedCommand::parse(
+        static_cast<int>(arguments.size()), argv.data(), commands, details::EnvironmentIndex { environment.data() });
+    ASSERT_TRUE(parsedCommand.is(command));
+    EXPECT_TRUE(parsedCommand.hasOption("verbose"));
+    EXPECT_FALSE(parsedCommand.hasOption("force")); // Despite the environment
+    EXPECT_FALSE(parsedCommand.hasOption("color"));
+    EXPECT_EQ(parsedCommand.getUnknownOptions(), std::unordered_set { "unknown"s });
+    EXPECT_EQ(parsedCommand.getArgs(command), std::make_tuple(std::optional { -0.5 }));
+
+    std::array invalid { "binary"s, "dummyCommand"s, "--verbose=maybe"s };
+    auto invalidArgv = toArgv(invalid);
+    EXPECT_FALSE(UnparsedCommand::parse(static_cast<int>(invalid.size()), invalidArgv.data(), commands).commandIndex());
+    const auto validated = UnparsedCommand::validate(static_cast<int>(invalid.size()), invalidArgv.data(), commands);
+    ASSERT_EQ(validated.getErrors().size(), 1U);
+    EXPECT_EQ(validated.getErrors()[0].position, 2U);
+}
@@ -0,0 +1,109 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CommandParserTokenizer.h"
+
+#include <memory>
+#include <random>
+
+namespace {
+std::vector<std::string> wordsOf(std::string_view line)
+{
+    const UnparsedCommand::CommandLine commandLine { line };
+    return { commandLine.words().begin(), commandLine.words().end() };
+}
+}
+
+using std::string_literals::operator""s;
+using testing::ElementsAre;
+
+TEST(CommandParserTokenizerTest, CommandLine_WhenPlainWords_WillReferToLine)
+{
+    const std::string line { "  get\t--verbose \n key  " };
+    const UnparsedCommand::CommandLine commandLine { line };
+
+    ASSERT_THAT(commandLine.words(), ElementsAre("get", "--verbose", "key"));
+    for (const auto word : commandLine.words()) {
+        EXPECT_GE(word.data(), line.data());
+        EXPECT_LE(word.data() + word.size(), line.data() + line.size());
+    }
+    EXPECT_TRUE(wordsOf("").empty());
+    EXPECT_TRUE(wordsOf(" \t\n ").empty());
+}
+
+TEST(CommandParserTokenizerTest, CommandLine_WhenQuotedOrEscaped_WillUnquoteLikeShell)
+{
+    EXPECT_THAT(wordsOf("put 'my key' \"a \\\"b\\\" \\$c \\d\" x\\ y"),
+                ElementsAre("put", "my key", "a \"b\" $c \\d", "x y"));
+    EXPECT_THAT(wordsOf("a\"b c\"'d'e \"\" ''"), ElementsAre("ab cde", "", ""));
+    EXPECT_THAT(wordsOf("'single \\ \"keeps\" all'"), ElementsAre("single \\ \"keeps\" all"));
+    EXPECT_THAT(wordsOf("first \\\nsecond jo\\\nined \"quoted\\\nnewline\""),
+                ElementsAre("first", "second", "joined", "quotednewline"));
+}
+
+TEST(CommandParserTokenizerTest, CommandLine_WhenMoved_WillKeepItsUnquotedWords)
+{
+    static_assert(!std::is_copy_constructible_v<UnparsedCommand::CommandLine>);
+    static_assert(!std::is_copy_assignable_v<UnparsedCommand::CommandLine>);
+    auto source = std::make_unique<UnparsedCommand::CommandLine>("put 'my key' plain");
+    const UnparsedCommand::CommandLine moved { std::move(*source) };
+    source.reset();
+    EXPECT_THAT(moved.words(), ElementsAre("put", "my key", "plain"));
+}
+
+TEST(CommandParserTokenizerTest, CommandLine_WhenQuotesUnbalanced_WillHaveNoWords)
+{
+    for (const auto* line : { "get 'key", "get \"key", "get \"key\\\"", "get key\\" }) {
+        EXPECT_TRUE(wordsOf(line).empty()) << line;
+    }
+}
+
+TEST(CommandParserTokenizerTest, ParseLine_WhenDoubleDash_WillTreatRemainingWordsAsArguments)
+{
+    auto put = UnparsedCommand::create("put"s, "dummyDescription"s)
+                   .withOptions({ "f", "force" })
+                   .withArgs<std::vector<std::string>>();
+    std::tuple commands { put };
+
+    const auto parsedCommand = UnparsedCommand::parseLine("put -f -- -x --force '-- quoted' \"--\"", commands);
+    ASSERT_TRUE(parsedCommand.is(put));
+    EXPECT_TRUE(parsedCommand.hasOption("f"));
+    EXPECT_FALSE(parsedCommand.hasOption("force"));
+    EXPECT_THAT(std::get<0>(parsedCommand.getArgs(put)), ElementsAre("-x", "--force", "-- quoted", "--"));
+}
+
+TEST(CommandParserTokenizerTest, ParseLine_WhenCommandLine_WillParseLikeArgv)
+{
+    auto get = UnparsedCommand::create("get"s, "dummyDescription"s)
+                   .withOptions({ "x", "verbose" })
+                   .withArgs<std::string, int, std::optional<double>>();
+    auto list = UnparsedCommand::create("list"s, "dummyDescription"s);
+    std::tuple commands { list, get };
+
+    const auto parsedCommand = UnparsedCommand::parseLine("get --verbose 'my key' -42 \"2.5\"", commands);
+    ASSERT_TRUE(parsedCommand.is(get));
+    EXPECT_TRUE(parsedCommand.hasOption("verbose"));
+    EXPECT_EQ(parsedCommand.getArgs(get), std::make_tuple("my key"s, -42, std::optional { 2.5 }));
+
+    EXPECT_TRUE(UnparsedCommand::parseLine("  list ", commands).is(list));
+    EXPECT_FALSE(UnparsedCommand::parseLine("list 'unterminated", commands).commandIndex());
+    EXPECT_FALSE(UnparsedCommand::parseLine("", commands).commandIndex());
+}
+
+TEST(CommandParserTokenizerTest, FindSpecialCharacter_WhenRandomText_WillMatchCharacterByCharacterSearch)
+{
+    std::mt19937 generator { 7 };
+    constexpr std::string_view alphabet { "abcXYZ-_=. \t\n'\"\\" };
+    std::uniform_int_distribution<std::size_t> pick { 0, alphabet.size() - 1 };
+    std::bernoulli_distribution special { 0.05 };
+    for (int run = 0; run < 1000; ++run) {
+        std::string text(static_cast<std::size_t>(run % 40), 'a');
+        for (auto& c : text) {
+            c = special(generator) ? alphabet[pick(generator)] : 'a';
+        }
+        for (std::size_t from = 0; from <= text.size(); ++from) {
+            const auto expected = std::min(text.find_first_of(" \t\n'\"\\", from), text.size());
+            ASSERT_EQ(details::findSpecialCharacter(text, from), expected) << text << " from " << from;
+        }
+    }
+}
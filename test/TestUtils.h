@@ -0,0 +1,18 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+/// @brief Get a null-terminated argv that points into the supplied arguments, which must outlive it
+template <std::size_t Size>
+std::vector<char*> toArgv(std::array<std::string, Size>& arguments)
+{
+    std::vector<char*> argv {};
+    for (auto& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    return argv;
+}
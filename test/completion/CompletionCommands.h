@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CommandParser.h"
+
+namespace completion {
+/// @brief The commands of the `tool` program the completion scripts are generated for
+inline const auto& commands()
+{
+    static const std::tuple toolCommands {
+        UnparsedCommand::create("add", "Add an item", "[-f] <item> <count>")
+            .withOptions({ "f", "force" })
+            .withAliases({ "plus" })
+            .withArgs<std::string, int>(),
+        UnparsedCommand::create("list", "List all items"),
+        UnparsedCommand::create("remove", "Remove items", "[--dry-run] [item...]")
+            .withOptions({ "dry-run" })
+            .withArgs<std::vector<std::string>>(),
+    };
+    return toolCommands;
+}
+} // namespace completion
@@ -0,0 +1,4 @@
+#include "CommandParserCompletion.h"
+#include "CompletionCommands.h"
+
+int main(int argc, char* argv[]) { return UnparsedCommand::completionMain(argc, argv, "tool", completion::commands()); }
@@ -0,0 +1,11 @@
+#include "FuzzCommands.h"
+
+#include <cstdint>
+
+// libFuzzer entry point, see test/CMakeLists.txt for how to build it and test/fuzz/corpus for the seed inputs
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    static_cast<void>(fuzz::parse({ reinterpret_cast<const char*>(data), size }));
+    return 0;
+}
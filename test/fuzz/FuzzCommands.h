@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CommandParser.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fuzz {
+/**
+ * @brief The commands fuzzed inputs are parsed against, covering aliases, compound options, bools, optionals and
+ *        vectors. Numeric arguments are left out on purpose since invalid numbers abort by design.
+ */
+inline const auto& commands()
+{
+    static const std::tuple fuzzedCommands {
+        UnparsedCommand::create("get", "Get a key", "[-abc] [--verbose] <key> [enabled]")
+            .withOptions({ "a", "b", "c", "verbose" })
+            .withAliases({ "g", "get-key" })
+            .withArgs<std::string, std::optional<bool>>(),
+        UnparsedCommand::create("put", "Put values", "<key> [value...]")
+            .withOptions({ "force", "dry-run" })
+            .withArgs<std::string, std::vector<std::string>>(),
+        UnparsedCommand::create("flags", "Parse booleans", "[flag...]").withArgs<std::vector<bool>>(),
+    };
+    return fuzzedCommands;
+}
+
+/**
+ * @brief Split an input into command line arguments, one per line, prepending the binary name
+ * @param input The input, e.g. a corpus file
+ * @return The command line arguments
+ */
+inline std::vector<std::string> toArguments(std::string_view input)
+{
+    std::vector<std::string> arguments { "binary" };
+    while (!input.empty()) {
+        const auto lineEnd = std::min(input.find('\n'), input.size());
+        arguments.emplace_back(input.substr(0, lineEnd));
+        input.remove_prefix(std::min(lineEnd + 1, input.size()));
+    }
+    return arguments;
+}
+
+/**
+ * @brief Parse the supplied input against the fuzzed commands
+ * @param input The input, one argument per line
+ * @return Whether any command was parsed
+ */
+inline bool parse(std::string_view input)
+{
+    auto arguments = toArguments(input);
+    std::vector<char*> argv {};
+    for (auto& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    const auto parsedCommand = UnparsedCommand::parse(static_cast<int>(arguments.size()), argv.data(), commands());
+    return parsedCommand.is(std::get<0>(commands())) || parsedCommand.is(std::get<1>(commands()))
+        || parsedCommand.is(std::get<2>(commands()));
+}
+} // namespace fuzz
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CommandParser.h"
+
+namespace plugin {
+/// @brief The commands implemented by the test plugin, known to both the host and the plugin
+inline const auto& sum()
+{
+    static const auto command = UnparsedCommand::create("sum", "Sum numbers", "[-n] <number...>")
+                                    .withOptions({ "n" })
+                                    .withAliases({ "add" })
+                                    .withArgs<int, std::vector<int>>();
+    return command;
+}
+
+inline const auto& count()
+{
+    static const auto command = UnparsedCommand::create("count", "Count words", "<word...>")
+                                    .withArgs<std::string, std::vector<std::string>>();
+    return command;
+}
+} // namespace plugin
@@ -0,0 +1,27 @@
+#include "PluginCommands.h"
+
+#include <numeric>
+
+/// @brief Exit with the sum of the numbers, negated with `-n`
+extern "C" int command_parser_plugin_run(int argc, char* argv[])
+{
+    const auto parsedCommand = UnparsedCommand::parse(argc, argv, std::tuple { plugin::sum() });
+    if (!parsedCommand.is(plugin::sum())) {
+        return -1;
+    }
+    const auto [first, rest] = parsedCommand.getArgs(plugin::sum());
+    const auto total = std::accumulate(rest.begin(), rest.end(), first);
+    return parsedCommand.hasOption("n") ? -total : total;
+}
+
+/// @brief Exit with the number of words
+extern "C" int command_parser_plugin_count(int argc, char* argv[])
+{
+    const auto parsedCommand = UnparsedCommand::parse(argc, argv, std::tuple { plugin::count() });
+    if (!parsedCommand.is(plugin::count())) {
+        return -1;
+    }
+    const auto [first, rest] = parsedCommand.getArgs(plugin::count());
+    static_cast<void>(first);
+    return static_cast<int>(rest.size()) + 1;
+}